@@ -0,0 +1,153 @@
+#include "BenchmarkReport.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <istream>
+#include <ostream>
+#include <sstream>
+
+//------------------------------------------------------------------------------
+static double getPercentile(const std::vector<double>& sorted, const double fraction)
+{
+    //nearest rank
+    size_t rank = static_cast<size_t>(fraction * sorted.size() + 0.5);
+    rank = std::max<size_t>(1, std::min(rank, sorted.size()));
+    return sorted[rank - 1];
+}
+
+//------------------------------------------------------------------------------
+BenchmarkResult::BenchmarkResult() : nbWorkers(0), nbSamples(0), mean(0), p50(0), p90(0), p99(0), max(0)
+{
+
+}
+
+//------------------------------------------------------------------------------
+BenchmarkReport::BenchmarkReport()
+{
+
+}
+
+//------------------------------------------------------------------------------
+void BenchmarkReport::add(const std::string& name, const size_t nbWorkers, std::vector<double> samples)
+{
+    BenchmarkResult result;
+    result.name = name;
+    result.nbWorkers = nbWorkers;
+    result.nbSamples = samples.size();
+
+    if(!samples.empty())
+    {
+        std::sort(samples.begin(), samples.end());
+        double total = 0;
+        for(std::vector<double>::const_iterator sample = samples.begin(); sample != samples.end(); ++sample)
+        {
+            total += *sample;
+        }
+        result.mean = total / samples.size();
+        result.p50 = getPercentile(samples, 0.5);
+        result.p90 = getPercentile(samples, 0.9);
+        result.p99 = getPercentile(samples, 0.99);
+        result.max = samples.back();
+    }
+    mResults.push_back(result);
+}
+
+//------------------------------------------------------------------------------
+void BenchmarkReport::writeCsv(std::ostream& stream) const
+{
+    stream << "benchmark,workers,samples,mean_ns,p50_ns,p90_ns,p99_ns,max_ns" << std::endl;
+    stream << std::fixed << std::setprecision(1);
+    for(std::vector<BenchmarkResult>::const_iterator result = mResults.begin(); result != mResults.end(); ++result)
+    {
+        stream << result->name << "," << result->nbWorkers << "," << result->nbSamples << "," << result->mean << ","
+            << result->p50 << "," << result->p90 << "," << result->p99 << "," << result->max << std::endl;
+    }
+}
+
+//------------------------------------------------------------------------------
+void BenchmarkReport::writeJson(std::ostream& stream) const
+{
+    stream << "[" << std::endl << std::fixed << std::setprecision(1);
+    for(std::vector<BenchmarkResult>::const_iterator result = mResults.begin(); result != mResults.end(); ++result)
+    {
+        stream << "  {\"benchmark\": \"" << result->name << "\", \"workers\": " << result->nbWorkers << ", \"samples\": " << result->nbSamples
+            << ", \"mean_ns\": " << result->mean << ", \"p50_ns\": " << result->p50 << ", \"p90_ns\": " << result->p90
+            << ", \"p99_ns\": " << result->p99 << ", \"max_ns\": " << result->max << "}" << (result + 1 != mResults.end() ? "," : "") << std::endl;
+    }
+    stream << "]" << std::endl;
+}
+
+//------------------------------------------------------------------------------
+bool BenchmarkReport::readCsv(std::istream& stream)
+{
+    std::string line;
+    while(std::getline(stream, line))
+    {
+        std::vector<std::string> fields;
+        std::istringstream lineStream(line);
+        std::string field;
+        while(std::getline(lineStream, field, ','))
+        {
+            fields.push_back(field);
+        }
+
+        //the header, and anything else that is not a result, is skipped
+        if(fields.size() != 8 || "benchmark" == fields[0])
+        {
+            continue;
+        }
+
+        BenchmarkResult result;
+        result.name = fields[0];
+        result.nbWorkers = std::strtoul(fields[1].c_str(), 0, 10);
+        result.nbSamples = std::strtoul(fields[2].c_str(), 0, 10);
+        result.mean = std::strtod(fields[3].c_str(), 0);
+        result.p50 = std::strtod(fields[4].c_str(), 0);
+        result.p90 = std::strtod(fields[5].c_str(), 0);
+        result.p99 = std::strtod(fields[6].c_str(), 0);
+        result.max = std::strtod(fields[7].c_str(), 0);
+        mResults.push_back(result);
+    }
+    return !mResults.empty();
+}
+
+//------------------------------------------------------------------------------
+size_t BenchmarkReport::compare(const BenchmarkReport& baseline, const double threshold, std::ostream& stream) const
+{
+    size_t nbRegressions = 0;
+    stream << std::fixed << std::setprecision(1);
+    for(std::vector<BenchmarkResult>::const_iterator result = mResults.begin(); result != mResults.end(); ++result)
+    {
+        const BenchmarkResult* before = baseline.find(result->name, result->nbWorkers);
+        stream << result->name << " @" << result->nbWorkers << ": ";
+        if(0 == before || before->p50 <= 0)
+        {
+            stream << "not in baseline" << std::endl;
+            continue;
+        }
+
+        const double change = (result->p50 - before->p50) / before->p50;
+        const bool isRegression = change > threshold;
+        stream << "p50 " << before->p50 << " -> " << result->p50 << " ns (" << std::showpos << change * 100 << std::noshowpos << "%), p99 "
+            << before->p99 << " -> " << result->p99 << " ns" << (isRegression ? "  REGRESSION" : "") << std::endl;
+        if(isRegression)
+        {
+            ++nbRegressions;
+        }
+    }
+    return nbRegressions;
+}
+
+//------------------------------------------------------------------------------
+const BenchmarkResult* BenchmarkReport::find(const std::string& name, const size_t nbWorkers) const
+{
+    for(std::vector<BenchmarkResult>::const_iterator result = mResults.begin(); result != mResults.end(); ++result)
+    {
+        if(result->name == name && result->nbWorkers == nbWorkers)
+        {
+            return &(*result);
+        }
+    }
+    return 0;
+}
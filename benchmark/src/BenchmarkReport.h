@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+//Summary of one benchmark run at one number of workers. Every figure is in nanoseconds, lower is better
+struct BenchmarkResult {
+    BenchmarkResult();
+
+    std::string name;
+    size_t nbWorkers;
+    size_t nbSamples;
+    double mean;
+    double p50;
+    double p90;
+    double p99;
+    double max;
+};
+
+//Results of a whole run, written as CSV or JSON, and compared against a baseline saved from an earlier run
+class BenchmarkReport {
+public:
+    BenchmarkReport();
+
+    //Summarize samples, in nanoseconds, into a result
+    void add(const std::string& name, const size_t nbWorkers, std::vector<double> samples);
+    inline const std::vector<BenchmarkResult>& getResults() const;
+
+    void writeCsv(std::ostream& stream) const;
+    void writeJson(std::ostream& stream) const;
+    //Read results written by writeCsv, false if the stream does not hold any
+    bool readCsv(std::istream& stream);
+
+    //Print how each result moved against the same benchmark in the baseline. Returns how many got slower at the
+    //median by more than threshold, a fraction such as 0.1 for 10%
+    size_t compare(const BenchmarkReport& baseline, const double threshold, std::ostream& stream) const;
+private:
+    const BenchmarkResult* find(const std::string& name, const size_t nbWorkers) const;
+
+    std::vector<BenchmarkResult> mResults;
+};
+
+//inline implementations
+//------------------------------------------------------------------------------
+const std::vector<BenchmarkResult>& BenchmarkReport::getResults() const
+{
+    return mResults;
+}
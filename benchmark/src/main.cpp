@@ -0,0 +1,784 @@
+#include "BenchmarkReport.h"
+#include "Combinable.h"
+#include "Manager.h"
+#include "MultiThreading.h"
+#include "Parallel.h"
+#include "TaskGraph.h"
+#include "TaskGroup.h"
+#include "Worker.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace workers;
+
+//Measures the scheduler's hot paths, and the same jobs done with plain threads for comparison. Usage:
+//  BenchmarkWorkers [--format=csv|json] [--output=file] [--baseline=file.csv] [--threshold=0.1]
+//                   [--filter=name] [--max-workers=N] [--quick]
+//Results go to stdout or the output file, the comparison against a baseline saved from an earlier csv run goes
+//to stderr. Exits with 1 when any benchmark's median got slower than the baseline by more than threshold
+
+struct Options {
+    Options() : format("csv"), threshold(0.1), maxWorkers(std::max(1u, std::thread::hardware_concurrency())), scale(1) {}
+
+    std::string format;
+    std::string output;
+    std::string baseline;
+    double threshold;
+    std::string filter;
+    size_t maxWorkers;
+    //fraction of the full number of samples to take
+    double scale;
+};
+
+//task that runs two more of itself until depth reaches 0, the fan out pattern work stealing is meant for
+class FanOutTask : public Task
+{
+public:
+    FanOutTask(Manager& manager, const size_t depth, std::atomic<size_t>& nbPerformed) : mManager(manager), mDepth(depth), mNbPerformed(nbPerformed)
+    {
+
+    }
+
+    virtual ~FanOutTask()
+    {
+
+    }
+
+private:
+    virtual bool performSpecific()
+    {
+        if(mDepth > 0)
+        {
+            mManager.run(std::make_shared<FanOutTask>(mManager, mDepth - 1, mNbPerformed));
+            mManager.run(std::make_shared<FanOutTask>(mManager, mDepth - 1, mNbPerformed));
+        }
+        mNbPerformed.fetch_add(1, std::memory_order_release);
+        return true;
+    }
+
+    Manager& mManager;
+    size_t mDepth;
+    std::atomic<size_t>& mNbPerformed;
+};
+
+//------------------------------------------------------------------------------
+static double getNanoseconds(const std::chrono::steady_clock::duration duration)
+{
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+}
+
+//------------------------------------------------------------------------------
+static size_t getNbSamples(const Options& options, const size_t nbSamples)
+{
+    return std::max<size_t>(10, static_cast<size_t>(nbSamples * options.scale));
+}
+
+//------------------------------------------------------------------------------
+static void waitUntil(const std::atomic<size_t>& counter, const size_t value)
+{
+    while(counter.load(std::memory_order_acquire) < value)
+    {
+        std::this_thread::yield();
+    }
+}
+
+//------------------------------------------------------------------------------
+static std::vector<double> measureRunThroughput(const size_t nbWorkers, const size_t nbRounds, const size_t nbTasks)
+{
+    //each sample is the time per task of a burst of empty tasks, from the first run until the last one completed
+    Manager manager(nbWorkers);
+    std::vector<double> samples;
+    for(size_t roundIdx = 0; roundIdx < nbRounds; ++roundIdx)
+    {
+        std::atomic<size_t> nbDone(0);
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for(size_t taskIdx = 0; taskIdx < nbTasks; ++taskIdx)
+        {
+            manager.run(CallableTask::create([&nbDone]() { nbDone.fetch_add(1, std::memory_order_release); }));
+        }
+        waitUntil(nbDone, nbTasks);
+        samples.push_back(getNanoseconds(std::chrono::steady_clock::now() - start) / nbTasks);
+    }
+    return samples;
+}
+
+//------------------------------------------------------------------------------
+static std::vector<double> measureSubmitToStart(const size_t nbWorkers, const size_t nbSamples)
+{
+    //one task at a time, so every task finds the workers idle
+    Manager manager(nbWorkers);
+    std::vector<double> samples;
+    for(size_t sampleIdx = 0; sampleIdx < nbSamples; ++sampleIdx)
+    {
+        std::chrono::steady_clock::time_point started;
+        const std::chrono::steady_clock::time_point submitted = std::chrono::steady_clock::now();
+        TaskHandle task = manager.submit([&started]() { started = std::chrono::steady_clock::now(); });
+        task->waitForCompletion();
+        samples.push_back(getNanoseconds(started - submitted));
+    }
+    return samples;
+}
+
+//------------------------------------------------------------------------------
+static std::vector<double> measureWorkerHandoff(const size_t nbSamples)
+{
+    //a worker on its own, from runTask until the task starts on the worker's thread
+    Worker worker([](Worker*) {});
+    worker.waitUntilReady();
+    std::vector<double> samples;
+    for(size_t sampleIdx = 0; sampleIdx < nbSamples; ++sampleIdx)
+    {
+        std::chrono::steady_clock::time_point started;
+        TaskHandle task = CallableTask::create([&started]() { started = std::chrono::steady_clock::now(); });
+        const std::chrono::steady_clock::time_point handedOver = std::chrono::steady_clock::now();
+        worker.runTask(task);
+        task->waitForCompletion();
+        samples.push_back(getNanoseconds(started - handedOver));
+    }
+    return samples;
+}
+
+//------------------------------------------------------------------------------
+static std::vector<double> measureWaitForTasks(const size_t nbWorkers, const size_t nbSamples, const size_t nbTasks)
+{
+    //cost of the call itself, right after queuing a burst, or with nothing to wait for when nbTasks is 0
+    Manager manager(nbWorkers);
+    std::vector<double> samples;
+    for(size_t sampleIdx = 0; sampleIdx < nbSamples; ++sampleIdx)
+    {
+        for(size_t taskIdx = 0; taskIdx < nbTasks; ++taskIdx)
+        {
+            manager.run(CallableTask::create([]() {}));
+        }
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        manager.waitForTasksToComplete();
+        samples.push_back(getNanoseconds(std::chrono::steady_clock::now() - start));
+    }
+    return samples;
+}
+
+//------------------------------------------------------------------------------
+static std::vector<double> measureFanOut(const ManagerConfig& config, const size_t nbRounds, const size_t depth)
+{
+    //each sample is the time per task of a whole tree of tasks that each run two more, from the root until the
+    //last leaf completed
+    const size_t nbTasks = (size_t(1) << (depth + 1)) - 1;
+    Manager manager(config);
+    std::vector<double> samples;
+    for(size_t roundIdx = 0; roundIdx < nbRounds; ++roundIdx)
+    {
+        std::atomic<size_t> nbPerformed(0);
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        manager.run(std::make_shared<FanOutTask>(manager, depth, nbPerformed));
+        waitUntil(nbPerformed, nbTasks);
+        samples.push_back(getNanoseconds(std::chrono::steady_clock::now() - start) / nbTasks);
+    }
+    return samples;
+}
+
+//------------------------------------------------------------------------------
+static std::vector<double> measureContendedRun(const ManagerConfig& config, const size_t nbProducers, const size_t nbPerProducer)
+{
+    //several producers run empty tasks at once, each sample is how long one run call took
+    std::vector<double> samples(nbProducers * nbPerProducer);
+    {
+        Manager manager(config);
+        std::vector<std::thread> producers;
+        for(size_t producerIdx = 0; producerIdx < nbProducers; ++producerIdx)
+        {
+            producers.push_back(std::thread([&manager, &samples, producerIdx, nbPerProducer]() {
+                for(size_t sampleIdx = producerIdx * nbPerProducer; sampleIdx < (producerIdx + 1) * nbPerProducer; ++sampleIdx)
+                {
+                    TaskHandle task = CallableTask::create([]() {});
+                    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                    manager.run(task);
+                    samples[sampleIdx] = getNanoseconds(std::chrono::steady_clock::now() - start);
+                }
+            }));
+        }
+        for(std::vector<std::thread>::iterator producer = producers.begin(); producer != producers.end(); ++producer)
+        {
+            producer->join();
+        }
+        manager.waitForTasksToComplete();
+    }
+    return samples;
+}
+
+//------------------------------------------------------------------------------
+static std::vector<double> measureRunBatch(const ManagerConfig& config, const size_t nbRounds, const size_t nbTasks, const size_t batchSize)
+{
+    //each sample is the time per task of a burst handed over batchSize tasks at a time, until the last one completed
+    Manager manager(config);
+    std::vector<double> samples;
+    std::vector<TaskHandle> tasks(nbTasks);
+    for(size_t roundIdx = 0; roundIdx < nbRounds; ++roundIdx)
+    {
+        std::atomic<size_t> nbDone(0);
+        for(size_t taskIdx = 0; taskIdx < nbTasks; ++taskIdx)
+        {
+            tasks[taskIdx] = CallableTask::create([&nbDone]() { nbDone.fetch_add(1, std::memory_order_release); });
+        }
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for(size_t taskIdx = 0; taskIdx < nbTasks; taskIdx += batchSize)
+        {
+            manager.runBatch(&tasks[taskIdx], std::min(batchSize, nbTasks - taskIdx));
+        }
+        waitUntil(nbDone, nbTasks);
+        samples.push_back(getNanoseconds(std::chrono::steady_clock::now() - start) / nbTasks);
+    }
+    return samples;
+}
+
+//------------------------------------------------------------------------------
+static void spinFor(const std::chrono::microseconds duration)
+{
+    //busy wait, standing in for a short piece of real work
+    const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + duration;
+    while(std::chrono::steady_clock::now() < end)
+    {
+    }
+}
+
+//------------------------------------------------------------------------------
+static std::vector<double> measureQueueWait(const size_t nbWorkers, const Priority priority, const size_t nbSamples)
+{
+    //a low priority backlog builds while tasks of the given priority keep arriving, each sample is how long one
+    //of those waited in the queue
+    const size_t nbBacklog = 20 * nbSamples;
+    Manager manager(nbWorkers);
+    std::vector<TaskHandle> tasks;
+    for(size_t taskIdx = 0; taskIdx < nbBacklog; ++taskIdx)
+    {
+        tasks.push_back(manager.submit([]() { spinFor(std::chrono::microseconds(20)); }, Priority::LOW));
+    }
+    std::vector<double> samples(nbSamples);
+    for(size_t sampleIdx = 0; sampleIdx < nbSamples; ++sampleIdx)
+    {
+        double* sample = &samples[sampleIdx];
+        const std::chrono::steady_clock::time_point submitted = std::chrono::steady_clock::now();
+        tasks.push_back(manager.submit([sample, submitted]() {
+            *sample = getNanoseconds(std::chrono::steady_clock::now() - submitted);
+            spinFor(std::chrono::microseconds(20));
+        }, priority));
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    for(std::vector<TaskHandle>::iterator task = tasks.begin(); task != tasks.end(); ++task)
+    {
+        (*task)->waitForCompletion();
+    }
+    return samples;
+}
+
+//------------------------------------------------------------------------------
+static std::vector<double> measureWakeUp(const WaitStrategy& waitStrategy, const size_t nbSamples)
+{
+    //a lone worker gets one task every few microseconds, from submitting it until it starts
+    ManagerConfig config(1);
+    config.waitStrategy = waitStrategy;
+    Manager manager(config);
+    std::vector<double> samples;
+    for(size_t sampleIdx = 0; sampleIdx < nbSamples; ++sampleIdx)
+    {
+        std::chrono::steady_clock::time_point started;
+        const std::chrono::steady_clock::time_point submitted = std::chrono::steady_clock::now();
+        manager.submit([&started]() { started = std::chrono::steady_clock::now(); })->waitForCompletion();
+        samples.push_back(getNanoseconds(started - submitted));
+        spinFor(std::chrono::microseconds(5));
+    }
+    return samples;
+}
+
+//------------------------------------------------------------------------------
+static std::vector<double> measureLoop(const size_t nbWorkers, const size_t nbRounds, const size_t nbIndices, const size_t mode)
+{
+    //time per index of a small numeric loop, run with a task per index (mode 0), parallel_for with the static
+    //partitioner (mode 1) or parallel_for with the auto partitioner (mode 2)
+    Manager manager(ManagerConfig(nbWorkers, SchedulingMode::WORK_STEALING));
+    std::vector<double> values(nbIndices, 1.0);
+    double* data = &values[0];
+    std::vector<double> samples;
+    for(size_t roundIdx = 0; roundIdx < nbRounds; ++roundIdx)
+    {
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if(0 == mode)
+        {
+            std::vector<TaskHandle> tasks;
+            tasks.reserve(nbIndices);
+            for(size_t i = 0; i < nbIndices; ++i)
+            {
+                tasks.push_back(manager.submit([data, i]() { data[i] = data[i] * 0.5 + 0.5; }));
+            }
+            for(std::vector<TaskHandle>::iterator task = tasks.begin(); task != tasks.end(); ++task)
+            {
+                (*task)->waitForCompletion();
+            }
+        }
+        else if(1 == mode)
+        {
+            parallel_for(manager, size_t(0), nbIndices, [data](const size_t i) { data[i] = data[i] * 0.5 + 0.5; }, static_partitioner());
+        }
+        else
+        {
+            parallel_for(manager, size_t(0), nbIndices, [data](const size_t i) { data[i] = data[i] * 0.5 + 0.5; });
+        }
+        samples.push_back(getNanoseconds(std::chrono::steady_clock::now() - start) / nbIndices);
+    }
+    return samples;
+}
+
+//------------------------------------------------------------------------------
+static std::vector<double> measureCount(const size_t nbWorkers, const size_t nbRounds, const size_t nbIndices, const size_t mode)
+{
+    //time per index of counting across a loop, with one shared atomic (mode 0), per thread combinable counters
+    //(mode 1) or parallel_reduce (mode 2)
+    Manager manager(ManagerConfig(nbWorkers, SchedulingMode::WORK_STEALING));
+    std::vector<double> samples;
+    for(size_t roundIdx = 0; roundIdx < nbRounds; ++roundIdx)
+    {
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if(0 == mode)
+        {
+            std::atomic<uint64_t> shared(0);
+            parallel_for(manager, size_t(0), nbIndices, [&shared](const size_t i) { shared += i & 1; });
+        }
+        else if(1 == mode)
+        {
+            combinable<uint64_t> counts;
+            parallel_for(manager, size_t(0), nbIndices, [&counts](const size_t i) { counts.local() += i & 1; });
+            counts.combine(std::plus<uint64_t>());
+        }
+        else
+        {
+            parallel_reduce(manager, size_t(0), nbIndices, uint64_t(0), [](const uint64_t sum, const size_t i) { return sum + (i & 1); },
+                std::plus<uint64_t>());
+        }
+        samples.push_back(getNanoseconds(std::chrono::steady_clock::now() - start) / nbIndices);
+    }
+    return samples;
+}
+
+//------------------------------------------------------------------------------
+static std::vector<double> measureTaskGraph(const size_t nbWorkers, const size_t nbRuns, const size_t nbLayers, const size_t nbPerLayer)
+{
+    //layers of empty nodes where each waits on every node of the layer before, built once, each sample is one
+    //run of the whole graph
+    Manager manager(ManagerConfig(nbWorkers, SchedulingMode::WORK_STEALING));
+    TaskGraph graph;
+    std::vector<size_t> previousLayer;
+    for(size_t layerIdx = 0; layerIdx < nbLayers; ++layerIdx)
+    {
+        std::vector<size_t> layer;
+        for(size_t nodeIdx = 0; nodeIdx < nbPerLayer; ++nodeIdx)
+        {
+            const size_t node = graph.addNode([]() {});
+            for(std::vector<size_t>::const_iterator previous = previousLayer.begin(); previous != previousLayer.end(); ++previous)
+            {
+                graph.addEdge(*previous, node);
+            }
+            layer.push_back(node);
+        }
+        previousLayer.swap(layer);
+    }
+
+    std::vector<double> samples;
+    for(size_t runIdx = 0; runIdx < nbRuns; ++runIdx)
+    {
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        graph.run(manager);
+        graph.wait();
+        samples.push_back(getNanoseconds(std::chrono::steady_clock::now() - start));
+    }
+    return samples;
+}
+
+//------------------------------------------------------------------------------
+static std::vector<double> measureFanIn(const size_t nbWorkers, const size_t nbRounds, const size_t nbTasks, const size_t mode)
+{
+    //time per task of waiting for a burst of empty tasks, with a future per task (mode 0), waiting on each task
+    //(mode 1) or a task group (mode 2)
+    Manager manager(nbWorkers);
+    std::vector<double> samples;
+    for(size_t roundIdx = 0; roundIdx < nbRounds; ++roundIdx)
+    {
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if(0 == mode)
+        {
+            std::vector< std::future<bool> > futures;
+            futures.reserve(nbTasks);
+            for(size_t taskIdx = 0; taskIdx < nbTasks; ++taskIdx)
+            {
+                futures.push_back(manager.submit([]() {})->getCompletionFuture());
+            }
+            for(std::vector< std::future<bool> >::iterator future = futures.begin(); future != futures.end(); ++future)
+            {
+                future->wait();
+            }
+        }
+        else if(1 == mode)
+        {
+            std::vector<TaskHandle> tasks;
+            tasks.reserve(nbTasks);
+            for(size_t taskIdx = 0; taskIdx < nbTasks; ++taskIdx)
+            {
+                tasks.push_back(manager.submit([]() {}));
+            }
+            for(std::vector<TaskHandle>::iterator task = tasks.begin(); task != tasks.end(); ++task)
+            {
+                (*task)->waitForCompletion();
+            }
+        }
+        else
+        {
+            TaskGroup group(manager);
+            for(size_t taskIdx = 0; taskIdx < nbTasks; ++taskIdx)
+            {
+                group.submit([]() {});
+            }
+            group.wait();
+        }
+        samples.push_back(getNanoseconds(std::chrono::steady_clock::now() - start) / nbTasks);
+    }
+    return samples;
+}
+
+//------------------------------------------------------------------------------
+static std::vector<double> measureThreadPerTask(const size_t nbSamples)
+{
+    //a new thread for every task, from creating it until it was joined
+    std::vector<double> samples;
+    for(size_t sampleIdx = 0; sampleIdx < nbSamples; ++sampleIdx)
+    {
+        Runnable runner;
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::thread thread(&Runnable::run, &runner);
+        thread.join();
+        samples.push_back(getNanoseconds(std::chrono::steady_clock::now() - start));
+    }
+    return samples;
+}
+
+//------------------------------------------------------------------------------
+static std::vector<double> measureAsync(const size_t nbSamples)
+{
+    //std::async for every task, from the call until its future is ready
+    std::vector<double> samples;
+    for(size_t sampleIdx = 0; sampleIdx < nbSamples; ++sampleIdx)
+    {
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::async(std::launch::async, []() { return 1; }).get();
+        samples.push_back(getNanoseconds(std::chrono::steady_clock::now() - start));
+    }
+    return samples;
+}
+
+//------------------------------------------------------------------------------
+static std::vector<double> measureConditionHandoff(const size_t nbSamples)
+{
+    //a thread waiting on a condition variable for a flag, the way Runnable::conditionRun does, from setting
+    //the flag until the thread wakes up with it
+    std::mutex mutex;
+    std::condition_variable signal;
+    bool hasWork = false;
+    bool isDone = false;
+    size_t nbHandled = 0;
+    std::chrono::steady_clock::time_point woken;
+
+    std::thread thread([&]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while(true)
+        {
+            while(!hasWork && !isDone)
+            {
+                signal.wait(lock);
+            }
+            if(isDone)
+            {
+                break;
+            }
+            woken = std::chrono::steady_clock::now();
+            hasWork = false;
+            ++nbHandled;
+            signal.notify_all();
+        }
+    });
+
+    std::vector<double> samples;
+    for(size_t sampleIdx = 0; sampleIdx < nbSamples; ++sampleIdx)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        hasWork = true;
+        signal.notify_all();
+        while(nbHandled <= sampleIdx)
+        {
+            signal.wait(lock);
+        }
+        samples.push_back(getNanoseconds(woken - start));
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        isDone = true;
+        signal.notify_all();
+    }
+    thread.join();
+    return samples;
+}
+
+//------------------------------------------------------------------------------
+static bool parseOptions(const int argc, char** argv, Options& options)
+{
+    for(int argIdx = 1; argIdx < argc; ++argIdx)
+    {
+        const std::string arg(argv[argIdx]);
+        const size_t equals = arg.find('=');
+        const std::string name = arg.substr(0, equals);
+        const std::string value = (std::string::npos == equals) ? std::string() : arg.substr(equals + 1);
+
+        if("--format" == name && ("csv" == value || "json" == value))
+        {
+            options.format = value;
+        }
+        else if("--output" == name && !value.empty())
+        {
+            options.output = value;
+        }
+        else if("--baseline" == name && !value.empty())
+        {
+            options.baseline = value;
+        }
+        else if("--threshold" == name && std::atof(value.c_str()) > 0)
+        {
+            options.threshold = std::atof(value.c_str());
+        }
+        else if("--filter" == name)
+        {
+            options.filter = value;
+        }
+        else if("--max-workers" == name && std::atoi(value.c_str()) > 0)
+        {
+            options.maxWorkers = static_cast<size_t>(std::atoi(value.c_str()));
+        }
+        else if("--quick" == name)
+        {
+            options.scale = 0.1;
+        }
+        else
+        {
+            std::cerr << "unknown option " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+static std::string getName(const std::string& prefix, const size_t value, const std::string& suffix = std::string())
+{
+    std::ostringstream name;
+    name << prefix << value << suffix;
+    return name.str();
+}
+
+//------------------------------------------------------------------------------
+static bool isSelected(const Options& options, const std::string& name)
+{
+    return options.filter.empty() || std::string::npos != name.find(options.filter);
+}
+
+//------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    Options options;
+    if(!parseOptions(argc, argv, options))
+    {
+        return 2;
+    }
+
+    BenchmarkReport baseline;
+    if(!options.baseline.empty())
+    {
+        std::ifstream baselineFile(options.baseline.c_str());
+        if(!baselineFile || !baseline.readCsv(baselineFile))
+        {
+            std::cerr << "no results in baseline " << options.baseline << std::endl;
+            return 2;
+        }
+    }
+
+    //1, 2, 4... workers, and the most we were given
+    std::vector<size_t> workerCounts;
+    for(size_t nbWorkers = 1; nbWorkers < options.maxWorkers; nbWorkers *= 2)
+    {
+        workerCounts.push_back(nbWorkers);
+    }
+    workerCounts.push_back(options.maxWorkers);
+
+    BenchmarkReport report;
+    for(std::vector<size_t>::const_iterator nbWorkers = workerCounts.begin(); nbWorkers != workerCounts.end(); ++nbWorkers)
+    {
+        if(isSelected(options, "run_throughput"))
+        {
+            report.add("run_throughput", *nbWorkers, measureRunThroughput(*nbWorkers, getNbSamples(options, 50), 10000));
+        }
+        if(isSelected(options, "submit_to_start"))
+        {
+            report.add("submit_to_start", *nbWorkers, measureSubmitToStart(*nbWorkers, getNbSamples(options, 5000)));
+        }
+        if(isSelected(options, "wait_for_tasks_idle"))
+        {
+            report.add("wait_for_tasks_idle", *nbWorkers, measureWaitForTasks(*nbWorkers, getNbSamples(options, 5000), 0));
+        }
+        if(isSelected(options, "wait_for_tasks_burst"))
+        {
+            report.add("wait_for_tasks_burst", *nbWorkers, measureWaitForTasks(*nbWorkers, getNbSamples(options, 500), 100));
+        }
+        if(isSelected(options, "fan_out_fifo"))
+        {
+            report.add("fan_out_fifo", *nbWorkers, measureFanOut(ManagerConfig(*nbWorkers, SchedulingMode::FIFO), getNbSamples(options, 20), 14));
+        }
+        if(isSelected(options, "fan_out_work_stealing"))
+        {
+            report.add("fan_out_work_stealing", *nbWorkers,
+                measureFanOut(ManagerConfig(*nbWorkers, SchedulingMode::WORK_STEALING), getNbSamples(options, 20), 14));
+        }
+
+        //four producers running at once, into each kind of queue
+        const size_t nbPerProducer = getNbSamples(options, 5000);
+        if(isSelected(options, "run_contended_locked"))
+        {
+            report.add("run_contended_locked", *nbWorkers, measureContendedRun(ManagerConfig(*nbWorkers), 4, nbPerProducer));
+        }
+        if(isSelected(options, "run_contended_lock_free"))
+        {
+            ManagerConfig config(*nbWorkers);
+            config.queue = QueueMode::LOCK_FREE;
+            config.queueCapacity = 4 * nbPerProducer;
+            report.add("run_contended_lock_free", *nbWorkers, measureContendedRun(config, 4, nbPerProducer));
+        }
+
+        const size_t batchSizes[] = { 1, 16, 256, 4096 };
+        for(size_t sizeIdx = 0; sizeIdx < sizeof(batchSizes) / sizeof(batchSizes[0]); ++sizeIdx)
+        {
+            const std::string name = getName("run_batch_", batchSizes[sizeIdx]);
+            if(isSelected(options, name))
+            {
+                report.add(name, *nbWorkers, measureRunBatch(ManagerConfig(*nbWorkers), getNbSamples(options, 50), 10000, batchSizes[sizeIdx]));
+            }
+            const std::string claimingName = getName("run_batch_", batchSizes[sizeIdx], "_claiming_32");
+            if(isSelected(options, claimingName))
+            {
+                ManagerConfig config(*nbWorkers);
+                config.batchClaimSize = 32;
+                report.add(claimingName, *nbWorkers, measureRunBatch(config, getNbSamples(options, 50), 10000, batchSizes[sizeIdx]));
+            }
+        }
+
+        if(isSelected(options, "queue_wait_high"))
+        {
+            report.add("queue_wait_high", *nbWorkers, measureQueueWait(*nbWorkers, Priority::HIGH, getNbSamples(options, 200)));
+        }
+        if(isSelected(options, "queue_wait_low"))
+        {
+            report.add("queue_wait_low", *nbWorkers, measureQueueWait(*nbWorkers, Priority::LOW, getNbSamples(options, 200)));
+        }
+
+        const char* loopNames[] = { "loop_task_per_index", "parallel_for_static", "parallel_for_auto" };
+        for(size_t mode = 0; mode < 3; ++mode)
+        {
+            if(isSelected(options, loopNames[mode]))
+            {
+                report.add(loopNames[mode], *nbWorkers, measureLoop(*nbWorkers, getNbSamples(options, 20), 100000, mode));
+            }
+        }
+        const char* countNames[] = { "count_shared_atomic", "count_combinable", "count_parallel_reduce" };
+        for(size_t mode = 0; mode < 3; ++mode)
+        {
+            if(isSelected(options, countNames[mode]))
+            {
+                report.add(countNames[mode], *nbWorkers, measureCount(*nbWorkers, getNbSamples(options, 20), 2000000, mode));
+            }
+        }
+
+        if(isSelected(options, "task_graph_8x8"))
+        {
+            report.add("task_graph_8x8", *nbWorkers, measureTaskGraph(*nbWorkers, getNbSamples(options, 2000), 8, 8));
+        }
+
+        const char* fanInNames[] = { "fan_in_future_per_task", "fan_in_wait_per_task", "fan_in_task_group" };
+        for(size_t mode = 0; mode < 3; ++mode)
+        {
+            if(isSelected(options, fanInNames[mode]))
+            {
+                report.add(fanInNames[mode], *nbWorkers, measureFanIn(*nbWorkers, getNbSamples(options, 50), 10000, mode));
+            }
+        }
+    }
+
+    //the rest do not depend on a number of workers
+    if(isSelected(options, "worker_handoff"))
+    {
+        report.add("worker_handoff", 1, measureWorkerHandoff(getNbSamples(options, 5000)));
+    }
+    if(isSelected(options, "wake_up_sleep"))
+    {
+        report.add("wake_up_sleep", 1, measureWakeUp(WaitStrategy(), getNbSamples(options, 2000)));
+    }
+    if(isSelected(options, "wake_up_spin_then_sleep"))
+    {
+        report.add("wake_up_spin_then_sleep", 1, measureWakeUp(WaitStrategy(20000, 8), getNbSamples(options, 2000)));
+    }
+    if(isSelected(options, "std_thread_per_task"))
+    {
+        report.add("std_thread_per_task", 1, measureThreadPerTask(getNbSamples(options, 2000)));
+    }
+    if(isSelected(options, "std_async"))
+    {
+        report.add("std_async", 1, measureAsync(getNbSamples(options, 2000)));
+    }
+    if(isSelected(options, "condition_variable_handoff"))
+    {
+        report.add("condition_variable_handoff", 1, measureConditionHandoff(getNbSamples(options, 5000)));
+    }
+
+    std::ofstream outputFile;
+    if(!options.output.empty())
+    {
+        outputFile.open(options.output.c_str());
+        if(!outputFile)
+        {
+            std::cerr << "cannot write " << options.output << std::endl;
+            return 2;
+        }
+    }
+    std::ostream& output = options.output.empty() ? std::cout : outputFile;
+    if("json" == options.format)
+    {
+        report.writeJson(output);
+    }
+    else
+    {
+        report.writeCsv(output);
+    }
+
+    if(!options.baseline.empty() && report.compare(baseline, options.threshold, std::cerr) > 0)
+    {
+        return 1;
+    }
+    return 0;
+}
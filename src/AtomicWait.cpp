@@ -0,0 +1,71 @@
+#include "AtomicWait.h"
+
+#if defined(__linux__)
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#endif
+
+namespace workers {
+
+#if defined(__linux__)
+
+//------------------------------------------------------------------------------
+void atomicWait(std::atomic<int>& word, const int expected)
+{
+    //the kernel checks the word again before sleeping, so a change made just before cannot be missed
+    syscall(SYS_futex, reinterpret_cast<int*>(&word), FUTEX_WAIT_PRIVATE, expected, 0, 0, 0);
+}
+
+//------------------------------------------------------------------------------
+void atomicNotifyAll(std::atomic<int>& word)
+{
+    syscall(SYS_futex, reinterpret_cast<int*>(&word), FUTEX_WAKE_PRIVATE, INT_MAX, 0, 0, 0);
+}
+
+#else
+
+//words hash to one of these, waiters of different words sharing a bucket only cost spurious wakeups
+struct WaitBucket {
+    std::mutex mutex;
+    std::condition_variable signal;
+};
+
+static const size_t NB_WAIT_BUCKETS = 64;
+
+//------------------------------------------------------------------------------
+static WaitBucket& getWaitBucket(std::atomic<int>& word)
+{
+    static WaitBucket buckets[NB_WAIT_BUCKETS];
+    return buckets[(reinterpret_cast<uintptr_t>(&word) >> 4) % NB_WAIT_BUCKETS];
+}
+
+//------------------------------------------------------------------------------
+void atomicWait(std::atomic<int>& word, const int expected)
+{
+    WaitBucket& bucket = getWaitBucket(word);
+    std::unique_lock<std::mutex> lock(bucket.mutex);
+
+    //notifiers take the lock after changing the word, so checking under it cannot miss them
+    if(word.load() == expected)
+    {
+        bucket.signal.wait(lock);
+    }
+}
+
+//------------------------------------------------------------------------------
+void atomicNotifyAll(std::atomic<int>& word)
+{
+    WaitBucket& bucket = getWaitBucket(word);
+    std::unique_lock<std::mutex> lock(bucket.mutex);
+    bucket.signal.notify_all();
+}
+
+#endif
+
+}
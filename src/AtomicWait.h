@@ -0,0 +1,33 @@
+#pragma once
+#include "Platform.h"
+
+#include <atomic>
+
+#if defined(_M_IX86) || defined(_M_X64)
+#include <intrin.h>
+#endif
+
+namespace workers {
+
+//Block while word still holds expected. May return spuriously, so callers check the word again in a loop.
+//Uses a futex on linux, a small table of condition variables shared by all words elsewhere
+EXAMPLES_LIB_API void atomicWait(std::atomic<int>& word, const int expected);
+//Wake every thread blocked in atomicWait on word, call after changing it
+EXAMPLES_LIB_API void atomicNotifyAll(std::atomic<int>& word);
+//Tell the processor we are spinning, easing off the memory bus and leaving more to a sibling hyperthread
+inline void cpuRelax();
+
+//inline implementations
+//------------------------------------------------------------------------------
+void cpuRelax()
+{
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#elif defined(_M_IX86) || defined(_M_X64)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace workers {
+
+//Lock free bounded multi producer/multi consumer queue. Every slot carries a sequence number
+//saying whether it is ready to be written or read, so producers and consumers only contend on
+//the position they claim. Capacity is rounded up to a power of 2
+template<typename T>
+class BoundedQueue {
+public:
+    BoundedQueue(const size_t capacity);
+    ~BoundedQueue();
+
+    //Add a value, false if the queue is full
+    bool tryPush(T value);
+    //Take the oldest value, false if the queue is empty
+    bool tryPop(T& value);
+
+    inline size_t capacity() const;
+    //Approximate number of values in the queue
+    inline size_t size() const;
+    inline bool empty() const;
+private:
+    BoundedQueue(const BoundedQueue&);
+    BoundedQueue& operator=(const BoundedQueue&);
+
+    struct Slot {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    Slot* mSlots;
+    size_t mMask;
+    //producers and consumers each hammer their own position, keep them on separate cache lines
+    char mSlotsPadding[64 - sizeof(Slot*) - sizeof(size_t)];
+    std::atomic<size_t> mEnqueuePos;
+    char mEnqueuePadding[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> mDequeuePos;
+    char mDequeuePadding[64 - sizeof(std::atomic<size_t>)];
+};
+
+//template implementations
+//------------------------------------------------------------------------------
+template<typename T>
+BoundedQueue<T>::BoundedQueue(const size_t capacity) : mEnqueuePos(0), mDequeuePos(0)
+{
+    size_t roundedCapacity = 2;
+    while(roundedCapacity < capacity)
+    {
+        roundedCapacity <<= 1;
+    }
+
+    mMask = roundedCapacity - 1;
+    mSlots = new Slot[roundedCapacity];
+    for(size_t slotIdx = 0; slotIdx < roundedCapacity; ++slotIdx)
+    {
+        mSlots[slotIdx].sequence.store(slotIdx, std::memory_order_relaxed);
+    }
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+BoundedQueue<T>::~BoundedQueue()
+{
+    delete[] mSlots;
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+bool BoundedQueue<T>::tryPush(T value)
+{
+    Slot* slot = 0;
+    size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+
+    while(true)
+    {
+        slot = &mSlots[pos & mMask];
+        const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+
+        if(0 == diff)
+        {
+            //slot is free for this position, claim it
+            if(mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if(diff < 0)
+        {
+            //slot still holds a value from the previous lap, full
+            return false;
+        }
+        else
+        {
+            pos = mEnqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->value = value;
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+bool BoundedQueue<T>::tryPop(T& value)
+{
+    Slot* slot = 0;
+    size_t pos = mDequeuePos.load(std::memory_order_relaxed);
+
+    while(true)
+    {
+        slot = &mSlots[pos & mMask];
+        const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos + 1);
+
+        if(0 == diff)
+        {
+            //slot has been written for this position, claim it
+            if(mDequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if(diff < 0)
+        {
+            //nothing written here yet, empty
+            return false;
+        }
+        else
+        {
+            pos = mDequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    value = slot->value;
+    //free the slot for the producer one lap ahead
+    slot->sequence.store(pos + mMask + 1, std::memory_order_release);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+size_t BoundedQueue<T>::capacity() const
+{
+    return mMask + 1;
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+size_t BoundedQueue<T>::size() const
+{
+    const size_t enqueuePos = mEnqueuePos.load(std::memory_order_relaxed);
+    const size_t dequeuePos = mDequeuePos.load(std::memory_order_relaxed);
+    return (enqueuePos > dequeuePos) ? enqueuePos - dequeuePos : 0;
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+bool BoundedQueue<T>::empty() const
+{
+    return 0 == size();
+}
+
+}
@@ -0,0 +1,31 @@
+#include "CallableTask.h"
+
+namespace workers {
+
+//------------------------------------------------------------------------------
+CallableTask::~CallableTask()
+{
+    mDestroy(&mStorage);
+}
+
+//------------------------------------------------------------------------------
+bool CallableTask::performSpecific()
+{
+    return mInvoke(&mStorage);
+}
+
+//------------------------------------------------------------------------------
+void CallableTask::destroy()
+{
+    this->~CallableTask();
+    getPool().deallocate(this, sizeof(CallableTask));
+}
+
+//------------------------------------------------------------------------------
+TaskPool& CallableTask::getPool()
+{
+    static TaskPool* pool = new TaskPool(sizeof(CallableTask));
+    return *pool;
+}
+
+}
@@ -0,0 +1,170 @@
+#pragma once
+#include "Platform.h"
+#include "Task.h"
+#include "TaskPool.h"
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace workers {
+
+//Call a callable, which may return bool to report success, otherwise it succeeded once it returns
+template<typename Function>
+inline bool invokeForStatus(Function& function);
+template<typename Function>
+inline bool invokeForStatus(Function& function, std::true_type);
+template<typename Function>
+inline bool invokeForStatus(Function& function, std::false_type);
+
+//Task running any callable, stored inside the task itself when it is small enough so that no extra allocation is needed.
+//Tasks come from a pool shared by the whole process and go back to it once their last handle is gone.
+//The callable may return bool to report success, otherwise it is considered successful once it returns
+class EXAMPLES_LIB_API CallableTask : public Task {
+public:
+    //callables up to this size are stored inline, bigger ones are allocated
+    static const size_t INLINE_SIZE = 64;
+
+    //Make a pooled task running the callable
+    template<typename F>
+    static TaskHandle create(F&& function);
+    virtual ~CallableTask();
+
+protected:
+    virtual bool performSpecific();
+    //back to the pool
+    virtual void destroy();
+
+private:
+    template<typename F>
+    explicit CallableTask(F&& function);
+    CallableTask(const CallableTask&);
+    CallableTask& operator=(const CallableTask&);
+
+    //pool for every callable task, never destroyed so that tasks and thread caches can outlive anything else
+    static TaskPool& getPool();
+
+    typedef bool (*InvokeFunction)(void*);
+    typedef void (*DestroyFunction)(void*);
+
+    //stored inline or allocated, whether it fits
+    template<typename Function, typename F>
+    void store(F&& function, std::true_type);
+    template<typename Function, typename F>
+    void store(F&& function, std::false_type);
+    template<typename Function>
+    static bool invokeInline(void* storage);
+    template<typename Function>
+    static void destroyInline(void* storage);
+    template<typename Function>
+    static bool invokeAllocated(void* storage);
+    template<typename Function>
+    static void destroyAllocated(void* storage);
+
+    //the callable, or a pointer to it when it did not fit
+    typename std::aligned_storage<INLINE_SIZE, sizeof(long double)>::type mStorage;
+    InvokeFunction mInvoke;
+    DestroyFunction mDestroy;
+};
+
+//template implementations
+//------------------------------------------------------------------------------
+template<typename Function>
+bool invokeForStatus(Function& function)
+{
+    return invokeForStatus(function, typename std::is_void<decltype(function())>::type());
+}
+
+//------------------------------------------------------------------------------
+template<typename Function>
+bool invokeForStatus(Function& function, std::true_type)
+{
+    function();
+    return true;
+}
+
+//------------------------------------------------------------------------------
+template<typename Function>
+bool invokeForStatus(Function& function, std::false_type)
+{
+    return static_cast<bool>(function());
+}
+
+//------------------------------------------------------------------------------
+template<typename F>
+TaskHandle CallableTask::create(F&& function)
+{
+    TaskPool& pool = getPool();
+    void* block = pool.allocate(sizeof(CallableTask));
+
+    try
+    {
+        return TaskHandle(new (block) CallableTask(std::forward<F>(function)));
+    }
+    catch(...)
+    {
+        pool.deallocate(block, sizeof(CallableTask));
+        throw;
+    }
+}
+
+//------------------------------------------------------------------------------
+template<typename F>
+CallableTask::CallableTask(F&& function)
+{
+    typedef typename std::decay<F>::type Function;
+    typedef std::integral_constant<bool, sizeof(Function) <= INLINE_SIZE && std::alignment_of<Function>::value <= std::alignment_of<decltype(mStorage)>::value> FitsInline;
+
+    store<Function>(std::forward<F>(function), FitsInline());
+}
+
+//------------------------------------------------------------------------------
+template<typename Function, typename F>
+void CallableTask::store(F&& function, std::true_type)
+{
+    new (&mStorage) Function(std::forward<F>(function));
+    mInvoke = &invokeInline<Function>;
+    mDestroy = &destroyInline<Function>;
+}
+
+//------------------------------------------------------------------------------
+template<typename Function, typename F>
+void CallableTask::store(F&& function, std::false_type)
+{
+    *reinterpret_cast<Function**>(&mStorage) = new Function(std::forward<F>(function));
+    mInvoke = &invokeAllocated<Function>;
+    mDestroy = &destroyAllocated<Function>;
+}
+
+//------------------------------------------------------------------------------
+template<typename Function>
+bool CallableTask::invokeInline(void* storage)
+{
+    Function& function = *static_cast<Function*>(storage);
+    return invokeForStatus(function);
+}
+
+//------------------------------------------------------------------------------
+template<typename Function>
+void CallableTask::destroyInline(void* storage)
+{
+    static_cast<Function*>(storage)->~Function();
+}
+
+//------------------------------------------------------------------------------
+template<typename Function>
+bool CallableTask::invokeAllocated(void* storage)
+{
+    Function& function = **static_cast<Function**>(storage);
+    return invokeForStatus(function);
+}
+
+//------------------------------------------------------------------------------
+template<typename Function>
+void CallableTask::destroyAllocated(void* storage)
+{
+    delete *static_cast<Function**>(storage);
+}
+
+}
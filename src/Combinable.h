@@ -0,0 +1,213 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <utility>
+
+namespace workers {
+
+//One T per thread that touches it, each on its own cache lines, to accumulate into from many tasks without
+//them contending, then merge once at the end. A thread's value is created from the init function the first time
+//that thread calls local. combine and combine_each read every thread's value, so call them once the threads
+//using local are known to be done, for instance once their tasks have completed
+template<typename T>
+class combinable {
+public:
+    //values start as T()
+    combinable();
+    //values start as init()
+    template<typename Init>
+    explicit combinable(Init init);
+    ~combinable();
+
+    //Value for the calling thread, created if needed. Lock free
+    T& local();
+    //Same, exists tells whether it had to be created
+    T& local(bool& exists);
+    //Drop every thread's value, not safe alongside anything else
+    void clear();
+
+    //Merge every thread's value with function(T, T) -> T in no particular order, T() if there are none
+    template<typename Function>
+    T combine(Function function) const;
+    //Call function(const T&) on every thread's value
+    template<typename Function>
+    void combine_each(Function function) const;
+private:
+    combinable(const combinable&);
+    combinable& operator=(const combinable&);
+
+    static const size_t NB_BUCKETS = 64;
+
+    //slots are allocated one by one, the padding keeps the links other threads walk and whatever gets
+    //allocated next off the cache lines the value is written on
+    struct Slot {
+        Slot(const std::thread::id& owner, T&& value) : owner(owner), next(0), value(std::move(value)) {}
+
+        std::thread::id owner;
+        Slot* next;
+        char linkPadding[64];
+        T value;
+        char valuePadding[64];
+    };
+
+    //slot a thread used last, so repeated calls to local skip the lookup. Every combinable gets a new id
+    //when created or cleared, a slot is only reused while the id it was cached for still matches
+    struct LocalCache {
+        uint64_t id;
+        Slot* slot;
+    };
+
+    static uint64_t nextId();
+
+    //each bucket is a list only ever pushed to, and only by the thread the new slot belongs to
+    std::atomic<Slot*> mBuckets[NB_BUCKETS];
+    std::function<T ()> mInit;
+    uint64_t mId;
+};
+
+//template implementations
+//------------------------------------------------------------------------------
+template<typename T>
+combinable<T>::combinable() : mInit([]() { return T(); }), mId(nextId())
+{
+    for(size_t bucketIdx = 0; bucketIdx < NB_BUCKETS; ++bucketIdx)
+    {
+        mBuckets[bucketIdx] = 0;
+    }
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+template<typename Init>
+combinable<T>::combinable(Init init) : mInit(init), mId(nextId())
+{
+    for(size_t bucketIdx = 0; bucketIdx < NB_BUCKETS; ++bucketIdx)
+    {
+        mBuckets[bucketIdx] = 0;
+    }
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+combinable<T>::~combinable()
+{
+    clear();
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+T& combinable<T>::local()
+{
+    bool exists = false;
+    return local(exists);
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+T& combinable<T>::local(bool& exists)
+{
+    static thread_local LocalCache cache = { 0, 0 };
+    if(cache.id == mId)
+    {
+        exists = true;
+        return cache.slot->value;
+    }
+
+    const std::thread::id owner = std::this_thread::get_id();
+    std::atomic<Slot*>& bucket = mBuckets[std::hash<std::thread::id>()(owner) % NB_BUCKETS];
+
+    Slot* head = bucket.load(std::memory_order_acquire);
+    for(Slot* slot = head; 0 != slot; slot = slot->next)
+    {
+        if(slot->owner == owner)
+        {
+            cache.id = mId;
+            cache.slot = slot;
+            exists = true;
+            return slot->value;
+        }
+    }
+
+    //nobody else adds a slot for us, so whatever others push meanwhile we only need to link in front of it
+    exists = false;
+    Slot* slot = new Slot(owner, mInit());
+    slot->next = head;
+    while(!bucket.compare_exchange_weak(slot->next, slot, std::memory_order_release, std::memory_order_relaxed))
+    {
+    }
+
+    cache.id = mId;
+    cache.slot = slot;
+    return slot->value;
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+void combinable<T>::clear()
+{
+    mId = nextId();
+    for(size_t bucketIdx = 0; bucketIdx < NB_BUCKETS; ++bucketIdx)
+    {
+        Slot* slot = mBuckets[bucketIdx].exchange(0);
+        while(0 != slot)
+        {
+            Slot* next = slot->next;
+            delete slot;
+            slot = next;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+template<typename Function>
+T combinable<T>::combine(Function function) const
+{
+    bool isEmpty = true;
+    T result = T();
+    for(size_t bucketIdx = 0; bucketIdx < NB_BUCKETS; ++bucketIdx)
+    {
+        for(Slot* slot = mBuckets[bucketIdx].load(std::memory_order_acquire); 0 != slot; slot = slot->next)
+        {
+            if(isEmpty)
+            {
+                isEmpty = false;
+                result = slot->value;
+            }
+            else
+            {
+                result = function(result, slot->value);
+            }
+        }
+    }
+    return result;
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+template<typename Function>
+void combinable<T>::combine_each(Function function) const
+{
+    for(size_t bucketIdx = 0; bucketIdx < NB_BUCKETS; ++bucketIdx)
+    {
+        for(const Slot* slot = mBuckets[bucketIdx].load(std::memory_order_acquire); 0 != slot; slot = slot->next)
+        {
+            function(slot->value);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+uint64_t combinable<T>::nextId()
+{
+    //0 is never used, it is what an empty cache holds
+    static std::atomic<uint64_t> sLastId(0);
+    return ++sLastId;
+}
+
+}
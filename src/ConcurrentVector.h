@@ -0,0 +1,558 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace workers {
+
+//Vector that any number of threads can push_back to at once without a lock. Elements live in segments doubling
+//in size that are never moved, so references to elements stay valid as it grows, and reading needs no lock.
+//push_back is a fetch_add, plus allocating a segment every time the size doubles.
+//An element pushed by another thread can only be read once that thread is known to be done pushing it,
+//for instance once its task has completed. Constructing elements must not throw
+template<typename T>
+class concurrent_vector {
+public:
+    //first segment holds 2^FIRST_SEGMENT_BITS elements, each one after holds twice as many as the one before
+    static const size_t FIRST_SEGMENT_BITS = 3;
+    static const size_t NB_SEGMENTS = sizeof(size_t) * 8 - FIRST_SEGMENT_BITS;
+
+    template<typename Vector, typename Value>
+    class Iterator {
+    public:
+        typedef std::random_access_iterator_tag iterator_category;
+        typedef typename std::remove_const<Value>::type value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef Value* pointer;
+        typedef Value& reference;
+
+        inline Iterator();
+        inline Iterator(Vector* vector, const size_t index);
+        //const iterators from non const ones
+        template<typename OtherVector, typename OtherValue>
+        inline Iterator(const Iterator<OtherVector, OtherValue>& other);
+
+        inline Value& operator*() const;
+        inline Value* operator->() const;
+        inline Value& operator[](const std::ptrdiff_t offset) const;
+        inline Iterator& operator++();
+        inline Iterator operator++(int);
+        inline Iterator& operator--();
+        inline Iterator operator--(int);
+        inline Iterator& operator+=(const std::ptrdiff_t offset);
+        inline Iterator& operator-=(const std::ptrdiff_t offset);
+        inline Iterator operator+(const std::ptrdiff_t offset) const;
+        inline Iterator operator-(const std::ptrdiff_t offset) const;
+        inline std::ptrdiff_t operator-(const Iterator& other) const;
+        inline bool operator==(const Iterator& other) const;
+        inline bool operator!=(const Iterator& other) const;
+        inline bool operator<(const Iterator& other) const;
+        inline bool operator>(const Iterator& other) const;
+        inline bool operator<=(const Iterator& other) const;
+        inline bool operator>=(const Iterator& other) const;
+    private:
+        template<typename OtherVector, typename OtherValue>
+        friend class Iterator;
+
+        Vector* mVector;
+        size_t mIndex;
+    };
+
+    typedef T value_type;
+    typedef size_t size_type;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef Iterator<concurrent_vector, T> iterator;
+    typedef Iterator<const concurrent_vector, const T> const_iterator;
+
+    concurrent_vector();
+    explicit concurrent_vector(const size_t size, const T& value = T());
+    ~concurrent_vector();
+
+    //Add an element at the end, safe to call from any number of threads at once. Returns an iterator to it
+    iterator push_back(const T& value);
+    iterator push_back(T&& value);
+    template<typename... Args>
+    iterator emplace_back(Args&&... args);
+    //Allocate segments for at least capacity elements up front, safe alongside push_back
+    void reserve(const size_t capacity);
+    //Destroy every element, keeping the segments. Not safe alongside anything else
+    void clear();
+
+    inline T& operator[](const size_t index);
+    inline const T& operator[](const size_t index) const;
+    //Same, throwing std::out_of_range past the end
+    T& at(const size_t index);
+    const T& at(const size_t index) const;
+
+    //Elements pushed so far, including any still being constructed by other threads
+    inline size_t size() const;
+    inline bool empty() const;
+    //Elements the segments allocated so far can hold
+    size_t capacity() const;
+
+    inline iterator begin();
+    inline iterator end();
+    inline const_iterator begin() const;
+    inline const_iterator end() const;
+private:
+    concurrent_vector(const concurrent_vector&);
+    concurrent_vector& operator=(const concurrent_vector&);
+
+    //segment an element is in, and where in the segment
+    inline static size_t getSegment(const size_t index);
+    inline static size_t getSegmentStart(const size_t segment);
+    inline static size_t getSegmentSize(const size_t segment);
+    //storage for an element, allocating its segment if nobody has yet
+    T* getSlot(const size_t index);
+    //segment storage aligned for T, which plain operator new only guarantees up to alignof(std::max_align_t).
+    //What was allocated is kept just before the storage, to free it
+    static T* allocateSegment(const size_t segment);
+    static void freeSegment(T* storage);
+
+    std::atomic<size_t> mSize;
+    std::atomic<T*> mSegments[NB_SEGMENTS];
+};
+
+//template implementations
+//------------------------------------------------------------------------------
+template<typename T>
+concurrent_vector<T>::concurrent_vector() : mSize(0)
+{
+    for(size_t segment = 0; segment < NB_SEGMENTS; ++segment)
+    {
+        mSegments[segment] = 0;
+    }
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+concurrent_vector<T>::concurrent_vector(const size_t size, const T& value) : mSize(0)
+{
+    for(size_t segment = 0; segment < NB_SEGMENTS; ++segment)
+    {
+        mSegments[segment] = 0;
+    }
+
+    reserve(size);
+    for(size_t index = 0; index < size; ++index)
+    {
+        push_back(value);
+    }
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+concurrent_vector<T>::~concurrent_vector()
+{
+    clear();
+    for(size_t segment = 0; segment < NB_SEGMENTS; ++segment)
+    {
+        freeSegment(mSegments[segment].load());
+    }
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+typename concurrent_vector<T>::iterator concurrent_vector<T>::push_back(const T& value)
+{
+    return emplace_back(value);
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+typename concurrent_vector<T>::iterator concurrent_vector<T>::push_back(T&& value)
+{
+    return emplace_back(std::move(value));
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+template<typename... Args>
+typename concurrent_vector<T>::iterator concurrent_vector<T>::emplace_back(Args&&... args)
+{
+    const size_t index = mSize.fetch_add(1);
+    new (getSlot(index)) T(std::forward<Args>(args)...);
+    return iterator(this, index);
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+void concurrent_vector<T>::reserve(const size_t capacity)
+{
+    if(capacity > 0)
+    {
+        const size_t lastSegment = getSegment(capacity - 1);
+        for(size_t segment = 0; segment <= lastSegment; ++segment)
+        {
+            getSlot(getSegmentStart(segment));
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+void concurrent_vector<T>::clear()
+{
+    const size_t size = mSize;
+    for(size_t index = 0; index < size; ++index)
+    {
+        (*this)[index].~T();
+    }
+    mSize = 0;
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+T& concurrent_vector<T>::at(const size_t index)
+{
+    if(index >= size())
+    {
+        throw std::out_of_range("concurrent_vector index out of range");
+    }
+    return (*this)[index];
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+const T& concurrent_vector<T>::at(const size_t index) const
+{
+    if(index >= size())
+    {
+        throw std::out_of_range("concurrent_vector index out of range");
+    }
+    return (*this)[index];
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+size_t concurrent_vector<T>::capacity() const
+{
+    size_t capacity = 0;
+    for(size_t segment = 0; segment < NB_SEGMENTS && 0 != mSegments[segment].load(std::memory_order_acquire); ++segment)
+    {
+        capacity += getSegmentSize(segment);
+    }
+    return capacity;
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+T* concurrent_vector<T>::getSlot(const size_t index)
+{
+    const size_t segment = getSegment(index);
+    T* storage = mSegments[segment].load(std::memory_order_acquire);
+
+    if(0 == storage)
+    {
+        //whoever gets there first allocates, the others free theirs and use it
+        T* allocated = allocateSegment(segment);
+        if(mSegments[segment].compare_exchange_strong(storage, allocated, std::memory_order_acq_rel))
+        {
+            storage = allocated;
+        }
+        else
+        {
+            freeSegment(allocated);
+        }
+    }
+    return storage + (index - getSegmentStart(segment));
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+T* concurrent_vector<T>::allocateSegment(const size_t segment)
+{
+    const size_t alignment = alignof(T) > alignof(void*) ? alignof(T) : alignof(void*);
+    char* allocated = static_cast<char*>(::operator new(getSegmentSize(segment) * sizeof(T) + sizeof(void*) + alignment - 1));
+
+    const uintptr_t first = reinterpret_cast<uintptr_t>(allocated + sizeof(void*));
+    char* storage = allocated + sizeof(void*) + (alignment - first % alignment) % alignment;
+    reinterpret_cast<void**>(storage)[-1] = allocated;
+    return reinterpret_cast<T*>(storage);
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+void concurrent_vector<T>::freeSegment(T* storage)
+{
+    if(0 != storage)
+    {
+        ::operator delete(reinterpret_cast<void**>(storage)[-1]);
+    }
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+T& concurrent_vector<T>::operator[](const size_t index)
+{
+    const size_t segment = getSegment(index);
+    return mSegments[segment].load(std::memory_order_acquire)[index - getSegmentStart(segment)];
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+const T& concurrent_vector<T>::operator[](const size_t index) const
+{
+    const size_t segment = getSegment(index);
+    return mSegments[segment].load(std::memory_order_acquire)[index - getSegmentStart(segment)];
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+size_t concurrent_vector<T>::size() const
+{
+    return mSize.load(std::memory_order_acquire);
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+bool concurrent_vector<T>::empty() const
+{
+    return 0 == size();
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+typename concurrent_vector<T>::iterator concurrent_vector<T>::begin()
+{
+    return iterator(this, 0);
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+typename concurrent_vector<T>::iterator concurrent_vector<T>::end()
+{
+    return iterator(this, size());
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+typename concurrent_vector<T>::const_iterator concurrent_vector<T>::begin() const
+{
+    return const_iterator(this, 0);
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+typename concurrent_vector<T>::const_iterator concurrent_vector<T>::end() const
+{
+    return const_iterator(this, size());
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+size_t concurrent_vector<T>::getSegment(const size_t index)
+{
+    //segment k starts at 2^FIRST_SEGMENT_BITS * (2^k - 1), so it is the highest bit of index / 2^FIRST_SEGMENT_BITS + 1
+    const size_t position = (index >> FIRST_SEGMENT_BITS) + 1;
+#if defined(__GNUC__)
+    return sizeof(unsigned long long) * 8 - 1 - __builtin_clzll(position);
+#else
+    size_t segment = 0;
+    while(position >> (segment + 1))
+    {
+        ++segment;
+    }
+    return segment;
+#endif
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+size_t concurrent_vector<T>::getSegmentStart(const size_t segment)
+{
+    return ((size_t(1) << segment) - 1) << FIRST_SEGMENT_BITS;
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+size_t concurrent_vector<T>::getSegmentSize(const size_t segment)
+{
+    return size_t(1) << (segment + FIRST_SEGMENT_BITS);
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+template<typename Vector, typename Value>
+concurrent_vector<T>::Iterator<Vector, Value>::Iterator() : mVector(0), mIndex(0)
+{
+
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+template<typename Vector, typename Value>
+concurrent_vector<T>::Iterator<Vector, Value>::Iterator(Vector* vector, const size_t index) : mVector(vector), mIndex(index)
+{
+
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+template<typename Vector, typename Value>
+template<typename OtherVector, typename OtherValue>
+concurrent_vector<T>::Iterator<Vector, Value>::Iterator(const Iterator<OtherVector, OtherValue>& other) : mVector(other.mVector), mIndex(other.mIndex)
+{
+
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+template<typename Vector, typename Value>
+Value& concurrent_vector<T>::Iterator<Vector, Value>::operator*() const
+{
+    return (*mVector)[mIndex];
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+template<typename Vector, typename Value>
+Value* concurrent_vector<T>::Iterator<Vector, Value>::operator->() const
+{
+    return &(*mVector)[mIndex];
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+template<typename Vector, typename Value>
+Value& concurrent_vector<T>::Iterator<Vector, Value>::operator[](const std::ptrdiff_t offset) const
+{
+    return (*mVector)[mIndex + offset];
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+template<typename Vector, typename Value>
+typename concurrent_vector<T>::template Iterator<Vector, Value>& concurrent_vector<T>::Iterator<Vector, Value>::operator++()
+{
+    ++mIndex;
+    return *this;
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+template<typename Vector, typename Value>
+typename concurrent_vector<T>::template Iterator<Vector, Value> concurrent_vector<T>::Iterator<Vector, Value>::operator++(int)
+{
+    Iterator previous = *this;
+    ++mIndex;
+    return previous;
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+template<typename Vector, typename Value>
+typename concurrent_vector<T>::template Iterator<Vector, Value>& concurrent_vector<T>::Iterator<Vector, Value>::operator--()
+{
+    --mIndex;
+    return *this;
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+template<typename Vector, typename Value>
+typename concurrent_vector<T>::template Iterator<Vector, Value> concurrent_vector<T>::Iterator<Vector, Value>::operator--(int)
+{
+    Iterator previous = *this;
+    --mIndex;
+    return previous;
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+template<typename Vector, typename Value>
+typename concurrent_vector<T>::template Iterator<Vector, Value>& concurrent_vector<T>::Iterator<Vector, Value>::operator+=(const std::ptrdiff_t offset)
+{
+    mIndex += offset;
+    return *this;
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+template<typename Vector, typename Value>
+typename concurrent_vector<T>::template Iterator<Vector, Value>& concurrent_vector<T>::Iterator<Vector, Value>::operator-=(const std::ptrdiff_t offset)
+{
+    mIndex -= offset;
+    return *this;
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+template<typename Vector, typename Value>
+typename concurrent_vector<T>::template Iterator<Vector, Value> concurrent_vector<T>::Iterator<Vector, Value>::operator+(const std::ptrdiff_t offset) const
+{
+    return Iterator(mVector, mIndex + offset);
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+template<typename Vector, typename Value>
+typename concurrent_vector<T>::template Iterator<Vector, Value> concurrent_vector<T>::Iterator<Vector, Value>::operator-(const std::ptrdiff_t offset) const
+{
+    return Iterator(mVector, mIndex - offset);
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+template<typename Vector, typename Value>
+std::ptrdiff_t concurrent_vector<T>::Iterator<Vector, Value>::operator-(const Iterator& other) const
+{
+    return static_cast<std::ptrdiff_t>(mIndex) - static_cast<std::ptrdiff_t>(other.mIndex);
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+template<typename Vector, typename Value>
+bool concurrent_vector<T>::Iterator<Vector, Value>::operator==(const Iterator& other) const
+{
+    return mIndex == other.mIndex && mVector == other.mVector;
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+template<typename Vector, typename Value>
+bool concurrent_vector<T>::Iterator<Vector, Value>::operator!=(const Iterator& other) const
+{
+    return !(*this == other);
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+template<typename Vector, typename Value>
+bool concurrent_vector<T>::Iterator<Vector, Value>::operator<(const Iterator& other) const
+{
+    return mIndex < other.mIndex;
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+template<typename Vector, typename Value>
+bool concurrent_vector<T>::Iterator<Vector, Value>::operator>(const Iterator& other) const
+{
+    return mIndex > other.mIndex;
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+template<typename Vector, typename Value>
+bool concurrent_vector<T>::Iterator<Vector, Value>::operator<=(const Iterator& other) const
+{
+    return mIndex <= other.mIndex;
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+template<typename Vector, typename Value>
+bool concurrent_vector<T>::Iterator<Vector, Value>::operator>=(const Iterator& other) const
+{
+    return mIndex >= other.mIndex;
+}
+
+}
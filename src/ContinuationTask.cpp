@@ -0,0 +1,29 @@
+#include "ContinuationTask.h"
+
+namespace workers {
+
+//------------------------------------------------------------------------------
+ContinuationTask::ContinuationTask(std::function<bool (bool)> continuation) : mContinuation(continuation), mAntecedentStatus(false)
+{
+
+}
+
+//------------------------------------------------------------------------------
+ContinuationTask::~ContinuationTask()
+{
+
+}
+
+//------------------------------------------------------------------------------
+bool ContinuationTask::performSpecific()
+{
+    return mContinuation(mAntecedentStatus);
+}
+
+//------------------------------------------------------------------------------
+void ContinuationTask::onAntecedentComplete(const bool status)
+{
+    mAntecedentStatus = status;
+}
+
+}
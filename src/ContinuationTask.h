@@ -0,0 +1,26 @@
+#pragma once
+#include "Platform.h"
+#include "Task.h"
+
+#include <functional>
+
+namespace workers {
+
+//Task running a function once the task it was attached to with Task::then completes, given that task's result
+class EXAMPLES_LIB_API ContinuationTask : public Task {
+public:
+    ContinuationTask(std::function<bool (bool)> continuation);
+    virtual ~ContinuationTask();
+
+protected:
+    virtual bool performSpecific();
+
+private:
+    virtual void onAntecedentComplete(const bool status);
+
+    std::function<bool (bool)> mContinuation;
+    //result of the task we were waiting on
+    bool mAntecedentStatus;
+};
+
+}
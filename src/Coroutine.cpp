@@ -0,0 +1,58 @@
+#include "Coroutine.h"
+#include "TaskPool.h"
+
+#include <mutex>
+#include <new>
+
+namespace workers {
+
+//frames of up to 128 << i bytes come from pool i
+static const size_t NB_FRAME_POOLS = 6;
+static const size_t SMALLEST_FRAME_SIZE = 128;
+
+//------------------------------------------------------------------------------
+static TaskPool* getFramePool(const size_t size)
+{
+    //never destroyed, like the task pool, so frames can outlive anything else
+    static TaskPool** pools = 0;
+    static std::once_flag poolsCreated;
+    std::call_once(poolsCreated, []() {
+        pools = new TaskPool*[NB_FRAME_POOLS];
+        for(size_t poolIdx = 0; poolIdx < NB_FRAME_POOLS; ++poolIdx)
+        {
+            pools[poolIdx] = new TaskPool(SMALLEST_FRAME_SIZE << poolIdx);
+        }
+    });
+
+    for(size_t poolIdx = 0; poolIdx < NB_FRAME_POOLS; ++poolIdx)
+    {
+        if(size <= (SMALLEST_FRAME_SIZE << poolIdx))
+        {
+            return pools[poolIdx];
+        }
+    }
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+void* CoroutineFramePool::allocate(const size_t size)
+{
+    TaskPool* pool = getFramePool(size);
+    return (0 != pool) ? pool->allocate(size) : ::operator new(size);
+}
+
+//------------------------------------------------------------------------------
+void CoroutineFramePool::deallocate(void* frame, const size_t size)
+{
+    TaskPool* pool = getFramePool(size);
+    if(0 != pool)
+    {
+        pool->deallocate(frame, size);
+    }
+    else
+    {
+        ::operator delete(frame);
+    }
+}
+
+}
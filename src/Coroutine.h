@@ -0,0 +1,393 @@
+#pragma once
+#include "Platform.h"
+#include "Manager.h"
+
+#include <cstddef>
+
+namespace workers {
+
+//Pools coroutine frames are allocated from, one per block size from 128 to 4096 bytes, bigger frames going to the
+//heap. Built into the library whether or not coroutines are, so the same library serves both
+class EXAMPLES_LIB_API CoroutineFramePool {
+public:
+    static void* allocate(const size_t size);
+    static void deallocate(void* frame, const size_t size);
+};
+
+}
+
+//coroutine types need C++20, enabled with the WORKERS_COROUTINES cmake option
+#if defined(WORKERS_COROUTINES)
+
+#include "AtomicWait.h"
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <thread>
+#include <utility>
+
+namespace workers {
+
+template<typename T>
+class co_task;
+
+//What the promises of every co_task share, whatever they return
+class CoTaskPromiseBase {
+public:
+    //what a finished coroutine suspends on, handing over to whoever awaits it or waking whoever waits on it
+    struct FinalAwaiter {
+        inline bool await_ready() const noexcept;
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> coroutine) noexcept;
+        inline void await_resume() const noexcept;
+    };
+
+    inline CoTaskPromiseBase();
+
+    //frames come from our pools
+    inline static void* operator new(const size_t size);
+    inline static void operator delete(void* frame, const size_t size);
+
+    //nothing runs until the task is awaited or started
+    inline std::suspend_always initial_suspend() const noexcept;
+    inline FinalAwaiter final_suspend() const noexcept;
+    inline void unhandled_exception();
+
+    inline void setContinuation(const std::coroutine_handle<> continuation);
+    //Block until the coroutine finished, when it was started rather than awaited
+    inline void wait();
+    inline bool isDone() const;
+protected:
+    inline void rethrowException() const;
+private:
+    //resume whoever awaits us, or wake whoever waits on us
+    inline std::coroutine_handle<> onFinished() noexcept;
+
+    //values of mState
+    enum State {
+        RUNNING,
+        //a thread sleeps in wait
+        WAITING,
+        //finished, still waking waiters, so the frame may not be destroyed yet
+        NOTIFYING,
+        DONE
+    };
+
+    std::coroutine_handle<> mContinuation;
+    std::atomic<int> mState;
+    std::exception_ptr mException;
+};
+
+//Promise of a co_task, keeping the result
+template<typename T>
+class CoTaskPromise : public CoTaskPromiseBase {
+public:
+    co_task<T> get_return_object();
+    template<typename U>
+    void return_value(U&& value);
+    //the result, or what the coroutine threw
+    T takeResult();
+private:
+    std::optional<T> mValue;
+};
+
+template<>
+class CoTaskPromise<void> : public CoTaskPromiseBase {
+public:
+    inline co_task<void> get_return_object();
+    inline void return_void() const;
+    inline void takeResult() const;
+};
+
+//Coroutine returning a T, run on a manager's workers. It starts suspended, and runs either once another coroutine
+//co_awaits it, resuming that coroutine where it finishes, or once started on a manager from code that is not a coroutine.
+//Inside, co_await manager.schedule() moves it onto one of the manager's workers and co_await manager.whenComplete(task)
+//suspends it until a task completed. A suspended coroutine holds no thread, only its frame, which comes from a pool
+template<typename T>
+class co_task {
+public:
+    typedef CoTaskPromise<T> promise_type;
+
+    co_task();
+    explicit co_task(const std::coroutine_handle<promise_type> coroutine);
+    co_task(co_task&& other);
+    co_task& operator=(co_task&& other);
+    //Waits for a started coroutine to finish
+    ~co_task();
+
+    //Run the coroutine on one of the manager's workers, or here if the manager would not take it
+    void start(Manager& manager, const Priority priority = Priority::NORMAL);
+    //Block until a started coroutine finished and return its result, rethrowing what it threw
+    T get();
+    bool isValid() const;
+
+    //awaiting runs the coroutine right away on the same thread, the awaiting one carries on where it finishes
+    bool await_ready() const noexcept;
+    std::coroutine_handle<> await_suspend(const std::coroutine_handle<> awaiting);
+    T await_resume();
+private:
+    co_task(const co_task&);
+    co_task& operator=(const co_task&);
+
+    std::coroutine_handle<promise_type> mCoroutine;
+    bool mIsStarted;
+};
+
+//inline implementations
+//------------------------------------------------------------------------------
+bool CoTaskPromiseBase::FinalAwaiter::await_ready() const noexcept
+{
+    return false;
+}
+
+//------------------------------------------------------------------------------
+void CoTaskPromiseBase::FinalAwaiter::await_resume() const noexcept
+{
+
+}
+
+//------------------------------------------------------------------------------
+CoTaskPromiseBase::CoTaskPromiseBase() : mState(RUNNING)
+{
+
+}
+
+//------------------------------------------------------------------------------
+void* CoTaskPromiseBase::operator new(const size_t size)
+{
+    return CoroutineFramePool::allocate(size);
+}
+
+//------------------------------------------------------------------------------
+void CoTaskPromiseBase::operator delete(void* frame, const size_t size)
+{
+    CoroutineFramePool::deallocate(frame, size);
+}
+
+//------------------------------------------------------------------------------
+std::suspend_always CoTaskPromiseBase::initial_suspend() const noexcept
+{
+    return std::suspend_always();
+}
+
+//------------------------------------------------------------------------------
+CoTaskPromiseBase::FinalAwaiter CoTaskPromiseBase::final_suspend() const noexcept
+{
+    return FinalAwaiter();
+}
+
+//------------------------------------------------------------------------------
+void CoTaskPromiseBase::unhandled_exception()
+{
+    mException = std::current_exception();
+}
+
+//------------------------------------------------------------------------------
+void CoTaskPromiseBase::setContinuation(const std::coroutine_handle<> continuation)
+{
+    mContinuation = continuation;
+}
+
+//------------------------------------------------------------------------------
+void CoTaskPromiseBase::wait()
+{
+    for(;;)
+    {
+        int state = mState.load(std::memory_order_acquire);
+        if(DONE == state)
+        {
+            return;
+        }
+
+        if(NOTIFYING == state)
+        {
+            //finished, the frame is ours once it is done waking us
+            std::this_thread::yield();
+        }
+        else if(RUNNING == state)
+        {
+            mState.compare_exchange_strong(state, WAITING);
+        }
+        else
+        {
+            atomicWait(mState, WAITING);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+bool CoTaskPromiseBase::isDone() const
+{
+    return DONE == mState.load(std::memory_order_acquire);
+}
+
+//------------------------------------------------------------------------------
+void CoTaskPromiseBase::rethrowException() const
+{
+    if(mException)
+    {
+        std::rethrow_exception(mException);
+    }
+}
+
+//------------------------------------------------------------------------------
+std::coroutine_handle<> CoTaskPromiseBase::onFinished() noexcept
+{
+    if(mContinuation)
+    {
+        return mContinuation;
+    }
+
+    if(WAITING == mState.exchange(NOTIFYING))
+    {
+        atomicNotifyAll(mState);
+    }
+    mState.store(DONE, std::memory_order_release);
+    return std::noop_coroutine();
+}
+
+//------------------------------------------------------------------------------
+co_task<void> CoTaskPromise<void>::get_return_object()
+{
+    return co_task<void>(std::coroutine_handle< CoTaskPromise<void> >::from_promise(*this));
+}
+
+//------------------------------------------------------------------------------
+void CoTaskPromise<void>::return_void() const
+{
+
+}
+
+//------------------------------------------------------------------------------
+void CoTaskPromise<void>::takeResult() const
+{
+    rethrowException();
+}
+
+//template implementations
+//------------------------------------------------------------------------------
+template<typename Promise>
+std::coroutine_handle<> CoTaskPromiseBase::FinalAwaiter::await_suspend(std::coroutine_handle<Promise> coroutine) noexcept
+{
+    return coroutine.promise().onFinished();
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+co_task<T> CoTaskPromise<T>::get_return_object()
+{
+    return co_task<T>(std::coroutine_handle< CoTaskPromise<T> >::from_promise(*this));
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+template<typename U>
+void CoTaskPromise<T>::return_value(U&& value)
+{
+    mValue.emplace(std::forward<U>(value));
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+T CoTaskPromise<T>::takeResult()
+{
+    rethrowException();
+    return std::move(*mValue);
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+co_task<T>::co_task() : mIsStarted(false)
+{
+
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+co_task<T>::co_task(const std::coroutine_handle<promise_type> coroutine) : mCoroutine(coroutine), mIsStarted(false)
+{
+
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+co_task<T>::co_task(co_task&& other) : mCoroutine(other.mCoroutine), mIsStarted(other.mIsStarted)
+{
+    other.mCoroutine = std::coroutine_handle<promise_type>();
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+co_task<T>& co_task<T>::operator=(co_task&& other)
+{
+    co_task moved(std::move(other));
+    std::swap(mCoroutine, moved.mCoroutine);
+    std::swap(mIsStarted, moved.mIsStarted);
+    return *this;
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+co_task<T>::~co_task()
+{
+    if(mCoroutine)
+    {
+        if(mIsStarted)
+        {
+            mCoroutine.promise().wait();
+        }
+        mCoroutine.destroy();
+    }
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+void co_task<T>::start(Manager& manager, const Priority priority)
+{
+    mIsStarted = true;
+    manager.run(CallableTask::create(CoroutineResumer< std::coroutine_handle<promise_type> >(mCoroutine)), priority);
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+bool co_task<T>::isValid() const
+{
+    return static_cast<bool>(mCoroutine);
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+T co_task<T>::get()
+{
+    mCoroutine.promise().wait();
+    return mCoroutine.promise().takeResult();
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+bool co_task<T>::await_ready() const noexcept
+{
+    return false;
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+std::coroutine_handle<> co_task<T>::await_suspend(const std::coroutine_handle<> awaiting)
+{
+    //symmetric transfer, so chains of awaits neither block nor grow the stack
+    mCoroutine.promise().setContinuation(awaiting);
+    return mCoroutine;
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+T co_task<T>::await_resume()
+{
+    return mCoroutine.promise().takeResult();
+}
+
+}
+
+#endif
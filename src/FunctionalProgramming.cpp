@@ -1,10 +1,337 @@
 #include "FunctionalProgramming.h"
+#include "IoEngine.h"
+#include "ResourceArchive.h"
+
+#include <atomic>
+#include <future>
+#include <sstream>
+
+//What the reads of a map's assets share
+struct MapLoad {
+    MapLoad(const size_t nbAssets, std::function<void (bool)> onLoaded) : nbRemaining(nbAssets), hasFailed(false), onLoaded(onLoaded)
+    {
+
+    }
+
+    std::atomic<size_t> nbRemaining;
+    std::atomic<bool> hasFailed;
+    std::function<void (bool)> onLoaded;
+};
 
 bool nonMemberFunction(int arg)
 {
     return true;
 }
 
+Resource::Resource() : mData(0), mSize(0)
+{
+
+}
+
+Resource::Resource(std::shared_ptr<const void> owner, const char* data, const size_t size) : mOwner(owner), mData(data), mSize(size)
+{
+
+}
+
+Resource::Resource(std::vector<char>& data) : mData(0), mSize(data.size())
+{
+    std::shared_ptr< std::vector<char> > buffer(new std::vector<char>(std::move(data)));
+    mData = buffer->empty() ? "" : &(*buffer)[0];
+    mOwner = buffer;
+}
+
+const char* Resource::getData() const
+{
+    return mData;
+}
+
+size_t Resource::getSize() const
+{
+    return mSize;
+}
+
+bool Resource::isValid() const
+{
+    return 0 != mData;
+}
+
+ResourceManager::Slot::Slot() : isReferenced(false), isUsed(false)
+{
+
+}
+
+ResourceManager::Shard::Shard() : hand(0)
+{
+
+}
+
+ResourceManager::ResourceManager(const size_t byteBudget, const size_t nbShards) : mByteBudget(byteBudget), mShardMask(0), mShards(0), mNbBytes(0), mEvictionShardIdx(0)
+{
+    size_t nbRoundedShards = 1;
+    while(nbRoundedShards < nbShards)
+    {
+        nbRoundedShards *= 2;
+    }
+    mShardMask = nbRoundedShards - 1;
+    mShards = new Shard[nbRoundedShards];
+}
+
+ResourceManager::~ResourceManager()
+{
+    delete[] mShards;
+}
+
+void ResourceManager::addResource(const std::string& name, const Resource& resource)
+{
+    Shard& shard = getShard(name);
+    Resource replaced;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        replaced = insert(shard, name, resource);
+    }
+    evictIfNeeded();
+}
+
+void ResourceManager::addResource(const std::string& name, std::vector<char>& data)
+{
+    addResource(name, Resource(data));
+}
+
+Resource ResourceManager::getResource(const std::string& name) const
+{
+    Shard& shard = getShard(name);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    std::unordered_map<std::string, size_t>::const_iterator slotIdx = shard.slotIdxs.find(name);
+    if(shard.slotIdxs.end() == slotIdx)
+    {
+        return Resource();
+    }
+
+    Slot& slot = shard.slots[slotIdx->second];
+    slot.isReferenced = true;
+    return slot.resource;
+}
+
+bool ResourceManager::removeResource(const std::string& name)
+{
+    Shard& shard = getShard(name);
+    Resource removed;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        std::unordered_map<std::string, size_t>::const_iterator slotIdx = shard.slotIdxs.find(name);
+        if(shard.slotIdxs.end() == slotIdx)
+        {
+            return false;
+        }
+        removed = erase(shard, slotIdx->second);
+    }
+    return true;
+}
+
+bool ResourceManager::beginLoad(const std::string& name, std::function<void (const Resource&)> onLoaded)
+{
+    Shard& shard = getShard(name);
+    Resource cached;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        std::unordered_map<std::string, size_t>::const_iterator slotIdx = shard.slotIdxs.find(name);
+        if(shard.slotIdxs.end() == slotIdx)
+        {
+            //first to ask loads it, the others wait on it
+            std::unordered_map< std::string, std::vector< std::function<void (const Resource&)> > >::iterator load = shard.loads.find(name);
+            const bool isLoader = (shard.loads.end() == load);
+            shard.loads[name].push_back(onLoaded);
+            return isLoader;
+        }
+
+        Slot& slot = shard.slots[slotIdx->second];
+        slot.isReferenced = true;
+        cached = slot.resource;
+    }
+
+    onLoaded(cached);
+    return false;
+}
+
+void ResourceManager::finishLoad(const std::string& name, const Resource& resource)
+{
+    Shard& shard = getShard(name);
+    std::vector< std::function<void (const Resource&)> > waiting;
+    Resource replaced;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        std::unordered_map< std::string, std::vector< std::function<void (const Resource&)> > >::iterator load = shard.loads.find(name);
+        if(shard.loads.end() != load)
+        {
+            waiting.swap(load->second);
+            shard.loads.erase(load);
+        }
+        if(resource.isValid())
+        {
+            replaced = insert(shard, name, resource);
+        }
+    }
+    evictIfNeeded();
+
+    //outside the lock, callbacks may well ask for more
+    for(std::vector< std::function<void (const Resource&)> >::const_iterator onLoaded = waiting.begin(); onLoaded != waiting.end(); ++onLoaded)
+    {
+        (*onLoaded)(resource);
+    }
+}
+
+Resource ResourceManager::load(const std::string& name, std::function<Resource ()> loader)
+{
+    //shared, as the loading thread may still be setting it as we return
+    std::shared_ptr< std::promise<Resource> > loaded(new std::promise<Resource>());
+    std::future<Resource> result = loaded->get_future();
+    if(beginLoad(name, [loaded](const Resource& resource) { loaded->set_value(resource); }))
+    {
+        Resource resource;
+        try
+        {
+            resource = loader();
+        }
+        catch(...)
+        {
+            finishLoad(name, Resource());
+            throw;
+        }
+        finishLoad(name, resource);
+    }
+    return result.get();
+}
+
+size_t ResourceManager::getNbResources() const
+{
+    size_t nbResources = 0;
+    for(size_t shardIdx = 0; shardIdx <= mShardMask; ++shardIdx)
+    {
+        std::lock_guard<std::mutex> lock(mShards[shardIdx].mutex);
+        nbResources += mShards[shardIdx].slotIdxs.size();
+    }
+    return nbResources;
+}
+
+size_t ResourceManager::getNbBytes() const
+{
+    return mNbBytes.load(std::memory_order_relaxed);
+}
+
+size_t ResourceManager::getByteBudget() const
+{
+    return mByteBudget;
+}
+
+ResourceManager::Shard& ResourceManager::getShard(const std::string& name) const
+{
+    return mShards[std::hash<std::string>()(name) & mShardMask];
+}
+
+Resource ResourceManager::insert(Shard& shard, const std::string& name, const Resource& resource)
+{
+    std::unordered_map<std::string, size_t>::const_iterator slotIdx = shard.slotIdxs.find(name);
+    if(shard.slotIdxs.end() != slotIdx)
+    {
+        Slot& slot = shard.slots[slotIdx->second];
+        Resource replaced = slot.resource;
+        mNbBytes -= replaced.getSize();
+        mNbBytes += resource.getSize();
+        slot.resource = resource;
+        return replaced;
+    }
+
+    size_t newSlotIdx = shard.slots.size();
+    if(shard.freeSlotIdxs.empty())
+    {
+        shard.slots.push_back(Slot());
+    }
+    else
+    {
+        newSlotIdx = shard.freeSlotIdxs.back();
+        shard.freeSlotIdxs.pop_back();
+    }
+
+    //not referenced until looked up, so a resource nobody asks for again is the first to go
+    Slot& slot = shard.slots[newSlotIdx];
+    slot.name = name;
+    slot.resource = resource;
+    slot.isReferenced = false;
+    slot.isUsed = true;
+    shard.slotIdxs[name] = newSlotIdx;
+    mNbBytes += resource.getSize();
+    return Resource();
+}
+
+Resource ResourceManager::erase(Shard& shard, const size_t slotIdx)
+{
+    Slot& slot = shard.slots[slotIdx];
+    Resource erased = slot.resource;
+    mNbBytes -= erased.getSize();
+    shard.slotIdxs.erase(slot.name);
+    slot.name.clear();
+    slot.resource = Resource();
+    slot.isUsed = false;
+    shard.freeSlotIdxs.push_back(slotIdx);
+    return erased;
+}
+
+bool ResourceManager::evict(Shard& shard, Resource& evicted)
+{
+    if(shard.slotIdxs.empty())
+    {
+        return false;
+    }
+
+    //some slot is used, so within two turns of the clock one is found unreferenced
+    for(;;)
+    {
+        const size_t slotIdx = shard.hand;
+        shard.hand = (shard.hand + 1) % shard.slots.size();
+
+        Slot& slot = shard.slots[slotIdx];
+        if(!slot.isUsed)
+        {
+            continue;
+        }
+        if(slot.isReferenced)
+        {
+            slot.isReferenced = false;
+            continue;
+        }
+
+        evicted = erase(shard, slotIdx);
+        return true;
+    }
+}
+
+void ResourceManager::evictIfNeeded()
+{
+    if(0 == mByteBudget)
+    {
+        return;
+    }
+
+    //shards take turns, giving up once a whole round of them had nothing left
+    size_t nbEmptyShards = 0;
+    while(mNbBytes.load(std::memory_order_relaxed) > mByteBudget && nbEmptyShards <= mShardMask)
+    {
+        Shard& shard = mShards[mEvictionShardIdx.fetch_add(1, std::memory_order_relaxed) & mShardMask];
+
+        //released once unlocked, which may unmap a whole archive
+        Resource evicted;
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if(evict(shard, evicted))
+        {
+            nbEmptyShards = 0;
+        }
+        else
+        {
+            ++nbEmptyShards;
+        }
+    }
+}
+
 std::string SomeClass::memberFunction(double arg)
 {
     return "TRUE";
@@ -13,4 +340,88 @@ std::string SomeClass::memberFunction(double arg)
 bool MapLoader::loadResources(const ResourceManager& mgr, const std::string& path)
 {
     return true;
-}
\ No newline at end of file
+}
+
+void MapLoader::loadResourcesAsync(ResourceManager& mgr, const std::string& path, workers::IoEngine& io, std::function<void (bool)> onLoaded)
+{
+    const size_t separator = path.find_last_of("/\\");
+    const std::string directory = (std::string::npos == separator) ? std::string() : path.substr(0, separator + 1);
+    ResourceManager* resources = &mgr;
+    workers::IoEngine* engine = &io;
+
+    io.readFile(path, [resources, engine, directory, onLoaded](bool succeeded, std::vector<char>& data) {
+        if(!succeeded)
+        {
+            onLoaded(false);
+            return;
+        }
+
+        const std::vector<std::string> assets = MapLoader::parseMap(std::string(data.begin(), data.end()));
+        if(assets.empty())
+        {
+            onLoaded(true);
+            return;
+        }
+
+        //every asset is counted before any can finish the load, whichever order they come in
+        std::shared_ptr<MapLoad> load(new MapLoad(assets.size(), onLoaded));
+        std::function<void (const Resource&)> onAssetLoaded = [load](const Resource& resource) {
+            if(!resource.isValid())
+            {
+                load->hasFailed = true;
+            }
+
+            if(1 == load->nbRemaining.fetch_sub(1))
+            {
+                load->onLoaded(!load->hasFailed);
+            }
+        };
+
+        for(std::vector<std::string>::const_iterator asset = assets.begin(); asset != assets.end(); ++asset)
+        {
+            //only read what is neither cached nor being read for another map
+            const std::string name = *asset;
+            if(resources->beginLoad(name, onAssetLoaded))
+            {
+                engine->readFile(directory + name, [resources, name](bool succeeded, std::vector<char>& data) {
+                    resources->finishLoad(name, succeeded ? Resource(data) : Resource());
+                });
+            }
+        }
+    });
+}
+
+bool MapLoader::loadArchive(ResourceManager& mgr, const std::string& path)
+{
+    std::shared_ptr<ResourceArchive> archive = ResourceArchive::open(path);
+    if(!archive)
+    {
+        return false;
+    }
+
+    //every view shares the archive, which stays mapped until the last of them is gone
+    for(size_t entryIdx = 0; entryIdx < archive->getNbEntries(); ++entryIdx)
+    {
+        mgr.addResource(archive->getName(entryIdx), Resource(archive, archive->getData(entryIdx), archive->getSize(entryIdx)));
+    }
+    return true;
+}
+
+std::vector<std::string> MapLoader::parseMap(const std::string& content)
+{
+    std::vector<std::string> assets;
+    std::istringstream lines(content);
+    std::string line;
+    while(std::getline(lines, line))
+    {
+        if(!line.empty() && '\r' == line[line.size() - 1])
+        {
+            line.erase(line.size() - 1);
+        }
+        if(!line.empty() && '#' != line[0])
+        {
+            assets.push_back(line);
+        }
+    }
+    return assets;
+}
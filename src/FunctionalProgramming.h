@@ -1,13 +1,121 @@
 #include "Platform.h"
 
+#include <atomic>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace workers {
+class IoEngine;
+}
 
 EXAMPLES_LIB_API bool nonMemberFunction(int arg);
 
+//Bytes of a loaded resource. A view, kept valid by sharing whatever holds the bytes: a buffer of its own,
+//or an archive mapped once for all of its resources
+class EXAMPLES_LIB_API Resource {
+public:
+    Resource();
+    Resource(std::shared_ptr<const void> owner, const char* data, const size_t size);
+    //Take the bytes over
+    explicit Resource(std::vector<char>& data);
+
+    const char* getData() const;
+    size_t getSize() const;
+    //false for a resource that was not found
+    bool isValid() const;
+private:
+    std::shared_ptr<const void> mOwner;
+    const char* mData;
+    size_t mSize;
+};
+
+//Concurrent cache of loaded resources by name. Names are spread over shards by hash, each with a lock of its own,
+//so threads after different resources rarely contend. With a byte budget, adding past it evicts resources in
+//CLOCK order: each shard sweeps its resources, sparing once those looked up since its last sweep, shards taking
+//turns. Evicting only drops the cache's share of a resource, views already handed out stay valid.
+//Loads are coalesced: while a resource is being loaded, whoever else asks for it waits on that load rather than
+//starting another
 class EXAMPLES_LIB_API ResourceManager {
 public:
-    
+    static const size_t DEFAULT_NB_SHARDS = 16;
+
+    //Constructor, taking the most bytes cached resources may add up to, 0 for no limit, and how many shards,
+    //rounded up to a power of 2
+    ResourceManager(const size_t byteBudget = 0, const size_t nbShards = DEFAULT_NB_SHARDS);
+    ~ResourceManager();
+
+    //Keep a loaded resource under its name, replacing any of the same name, then evict down to the budget.
+    //Safe from several threads at once, as is everything else
+    void addResource(const std::string& name, const Resource& resource);
+    void addResource(const std::string& name, std::vector<char>& data);
+    //The resource of that name, invalid if it is not cached
+    Resource getResource(const std::string& name) const;
+    //Drop a resource from the cache, false if it was not cached
+    bool removeResource(const std::string& name);
+
+    //Ask for a resource, onLoaded being called with it once there is one: straight away if cached, or once whoever
+    //loads it is done. True if the caller is the one to load it, and must then hand it to finishLoad, even failed
+    bool beginLoad(const std::string& name, std::function<void (const Resource&)> onLoaded);
+    //Hand over a resource claimed with beginLoad, invalid if it could not be loaded, in which case it is not
+    //cached and everyone who asked gets the invalid resource
+    void finishLoad(const std::string& name, const Resource& resource);
+    //Get a resource, calling loader on this thread if it is not cached and nobody is loading it yet,
+    //waiting for whoever is otherwise
+    Resource load(const std::string& name, std::function<Resource ()> loader);
+
+    size_t getNbResources() const;
+    //bytes of the cached resources
+    size_t getNbBytes() const;
+    size_t getByteBudget() const;
+private:
+    ResourceManager(const ResourceManager&);
+    ResourceManager& operator=(const ResourceManager&);
+
+    //a resource on a shard's clock
+    struct Slot {
+        Slot();
+
+        std::string name;
+        Resource resource;
+        //looked up since the clock last swept past it
+        bool isReferenced;
+        bool isUsed;
+    };
+
+    struct Shard {
+        Shard();
+
+        std::mutex mutex;
+        std::unordered_map<std::string, size_t> slotIdxs;
+        std::vector<Slot> slots;
+        std::vector<size_t> freeSlotIdxs;
+        size_t hand;
+        //loads in progress, with whoever waits on each
+        std::unordered_map< std::string, std::vector< std::function<void (const Resource&)> > > loads;
+        //keeps shards locked by different threads off each other's cache lines
+        char padding[64];
+    };
+
+    Shard& getShard(const std::string& name) const;
+    //cache a resource, with the shard locked, handing back any it replaces to be released once unlocked
+    Resource insert(Shard& shard, const std::string& name, const Resource& resource);
+    //forget a slot's resource, with the shard locked, handing it back to be released once unlocked
+    Resource erase(Shard& shard, const size_t slotIdx);
+    //evict one resource from the shard, with it locked, false if it holds none
+    bool evict(Shard& shard, Resource& evicted);
+    //evict until back under the budget
+    void evictIfNeeded();
+
+    size_t mByteBudget;
+    size_t mShardMask;
+    Shard* mShards;
+    std::atomic<size_t> mNbBytes;
+    //next shard to evict from
+    std::atomic<size_t> mEvictionShardIdx;
 };
 
 class EXAMPLES_LIB_API SomeClass {
@@ -18,4 +126,16 @@ public:
 class EXAMPLES_LIB_API MapLoader {
 public:
     bool loadResources(const ResourceManager& mgr, const std::string& path);
+    //Load a map without blocking: the map file lists one asset per line, relative to its own directory, lines
+    //starting with # skipped. Every asset not cached yet is read at once through the engine and added to the
+    //resource manager on one of the engine's workers as its read completes, then onLoaded is called with whether
+    //they all loaded. Assets another load is already reading are waited on rather than read again.
+    //The resource manager must outlive the load, which the engine's wait covers
+    void loadResourcesAsync(ResourceManager& mgr, const std::string& path, workers::IoEngine& io, std::function<void (bool)> onLoaded);
+    //Load a map packed into a ResourceArchive: the archive is mapped and every resource added as a view into it,
+    //so nothing is copied and nothing read until used. False if it is not a valid archive
+    bool loadArchive(ResourceManager& mgr, const std::string& path);
+
+    //The assets a map file lists, in order
+    static std::vector<std::string> parseMap(const std::string& content);
 };
\ No newline at end of file
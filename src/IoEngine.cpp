@@ -0,0 +1,561 @@
+#include "IoEngine.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace workers {
+
+//most reads a ring holds, the kernel's own limit being higher than any drive's queue
+static const unsigned MAX_RING_ENTRIES = 4096;
+//what helper threads read at once
+static const size_t READ_CHUNK_SIZE = 64 * 1024;
+
+//A file being read
+struct IoEngine::Read {
+    Read(const std::string& path, ReadCallback callback) : path(path), callback(callback), succeeded(false), file(-1), offset(0)
+    {
+
+    }
+
+    std::string path;
+    ReadCallback callback;
+    std::vector<char> data;
+    bool succeeded;
+    //io_uring only, the open file and how much of it was read
+    int file;
+    size_t offset;
+#if defined(__linux__)
+    iovec buffer;
+#endif
+};
+
+//What a pooled task runs to call back for a read. A task the manager drops without running still calls back,
+//from wherever it is destroyed, so that nobody waits on the read forever
+struct ReadCallbackTask {
+    ReadCallbackTask(IoEngine* engine, IoEngine::Read* read) : engine(engine), read(read)
+    {
+
+    }
+
+    ReadCallbackTask(ReadCallbackTask&& other) : engine(other.engine), read(other.read)
+    {
+        other.read = 0;
+    }
+
+    ~ReadCallbackTask()
+    {
+        if(0 != read)
+        {
+            engine->callBack(read);
+        }
+    }
+
+    void operator()()
+    {
+        IoEngine::Read* runRead = read;
+        read = 0;
+        engine->callBack(runRead);
+    }
+
+    IoEngine* engine;
+    IoEngine::Read* read;
+};
+
+#if defined(__linux__)
+
+//The rings an io_uring instance shares with the kernel. We are the only thread writing the submission queue's
+//tail, under mSubmitMutex, and the only one reading the completion queue, on mCompletionThread
+struct IoEngine::Ring {
+    Ring() : file(-1), submissionMap(MAP_FAILED), submissionMapSize(0), completionMap(MAP_FAILED), completionMapSize(0), entries(static_cast<io_uring_sqe*>(MAP_FAILED)), entriesSize(0), nbEntries(0)
+    {
+
+    }
+
+    ~Ring()
+    {
+        if(MAP_FAILED != static_cast<void*>(entries))
+        {
+            munmap(entries, entriesSize);
+        }
+        if(MAP_FAILED != completionMap && completionMap != submissionMap)
+        {
+            munmap(completionMap, completionMapSize);
+        }
+        if(MAP_FAILED != submissionMap)
+        {
+            munmap(submissionMap, submissionMapSize);
+        }
+        if(file >= 0)
+        {
+            close(file);
+        }
+    }
+
+    bool create(const unsigned depth)
+    {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        file = static_cast<int>(syscall(__NR_io_uring_setup, depth, &params));
+        if(file < 0)
+        {
+            return false;
+        }
+
+        submissionMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        completionMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool isSingleMap = 0 != (params.features & IORING_FEAT_SINGLE_MMAP);
+        if(isSingleMap)
+        {
+            submissionMapSize = std::max(submissionMapSize, completionMapSize);
+        }
+
+        submissionMap = mmap(0, submissionMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, file, IORING_OFF_SQ_RING);
+        if(MAP_FAILED == submissionMap)
+        {
+            return false;
+        }
+        completionMap = isSingleMap ? submissionMap : mmap(0, completionMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, file, IORING_OFF_CQ_RING);
+        if(MAP_FAILED == completionMap)
+        {
+            return false;
+        }
+        entriesSize = params.sq_entries * sizeof(io_uring_sqe);
+        entries = static_cast<io_uring_sqe*>(mmap(0, entriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, file, IORING_OFF_SQES));
+        if(MAP_FAILED == static_cast<void*>(entries))
+        {
+            return false;
+        }
+
+        char* submission = static_cast<char*>(submissionMap);
+        submissionHead = reinterpret_cast<unsigned*>(submission + params.sq_off.head);
+        submissionTail = reinterpret_cast<unsigned*>(submission + params.sq_off.tail);
+        submissionMask = *reinterpret_cast<unsigned*>(submission + params.sq_off.ring_mask);
+        submissionArray = reinterpret_cast<unsigned*>(submission + params.sq_off.array);
+        char* completion = static_cast<char*>(completionMap);
+        completionHead = reinterpret_cast<unsigned*>(completion + params.cq_off.head);
+        completionTail = reinterpret_cast<unsigned*>(completion + params.cq_off.tail);
+        completionMask = *reinterpret_cast<unsigned*>(completion + params.cq_off.ring_mask);
+        completions = reinterpret_cast<io_uring_cqe*>(completion + params.cq_off.cqes);
+        nbEntries = params.sq_entries;
+        return true;
+    }
+
+    //put an entry on the submission queue, seen by the kernel once submitted
+    void push(const io_uring_sqe& entry)
+    {
+        const unsigned tail = *submissionTail;
+        const unsigned index = tail & submissionMask;
+        entries[index] = entry;
+        submissionArray[index] = index;
+        __atomic_store_n(submissionTail, tail + 1, __ATOMIC_RELEASE);
+    }
+
+    //hand the kernel every entry pushed that it has not taken yet, anything it refuses now goes with the next call
+    void submit()
+    {
+        const unsigned nbPending = *submissionTail - __atomic_load_n(submissionHead, __ATOMIC_ACQUIRE);
+        if(nbPending > 0)
+        {
+            syscall(__NR_io_uring_enter, file, nbPending, 0, 0, 0, 0);
+        }
+    }
+
+    int file;
+    void* submissionMap;
+    size_t submissionMapSize;
+    void* completionMap;
+    size_t completionMapSize;
+    io_uring_sqe* entries;
+    size_t entriesSize;
+    unsigned nbEntries;
+
+    unsigned* submissionHead;
+    unsigned* submissionTail;
+    unsigned submissionMask;
+    unsigned* submissionArray;
+    unsigned* completionHead;
+    unsigned* completionTail;
+    unsigned completionMask;
+    io_uring_cqe* completions;
+};
+
+#else
+
+struct IoEngine::Ring {
+
+};
+
+#endif
+
+//------------------------------------------------------------------------------
+IoEngine::IoEngine(Manager& manager, const IoEngineConfig& config) :
+    mManager(manager),
+    mConfig(config),
+    mBackend(config.backend),
+    mNbInFlight(0),
+    mRing(0),
+    mNbSubmitted(0),
+    mIsStopping(false)
+{
+    if(IoBackend::IO_URING == mBackend && !startRing())
+    {
+        mBackend = IoBackend::THREADS;
+    }
+
+    if(IoBackend::THREADS == mBackend)
+    {
+        startThreads();
+    }
+}
+
+//------------------------------------------------------------------------------
+IoEngine::~IoEngine()
+{
+    wait();
+
+    if(IoBackend::IO_URING == mBackend)
+    {
+        stopRing();
+    }
+    else
+    {
+        stopThreads();
+    }
+}
+
+//------------------------------------------------------------------------------
+void IoEngine::readFile(const std::string& path, ReadCallback callback)
+{
+    Read* read = new Read(path, callback);
+    {
+        std::lock_guard<std::mutex> lock(mInFlightMutex);
+        ++mNbInFlight;
+    }
+
+    if(IoBackend::THREADS == mBackend)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mQueueMutex);
+            mQueue.push_back(read);
+        }
+        mQueueSignal.notify_one();
+        return;
+    }
+
+#if defined(__linux__)
+    //opening only reads metadata, which is usually cached, the kernel reads the content while we carry on
+    read->file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat status;
+    if(read->file < 0 || 0 != fstat(read->file, &status))
+    {
+        finishRead(read, false);
+        return;
+    }
+
+    read->data.resize(static_cast<size_t>(status.st_size));
+    if(read->data.empty())
+    {
+        finishRead(read, true);
+        return;
+    }
+
+    submitRead(read);
+#endif
+}
+
+//------------------------------------------------------------------------------
+void IoEngine::wait()
+{
+    std::unique_lock<std::mutex> lock(mInFlightMutex);
+    while(mNbInFlight > 0)
+    {
+        mInFlightSignal.wait(lock);
+    }
+}
+
+//------------------------------------------------------------------------------
+size_t IoEngine::getNbInFlight() const
+{
+    std::lock_guard<std::mutex> lock(mInFlightMutex);
+    return mNbInFlight;
+}
+
+//------------------------------------------------------------------------------
+bool IoEngine::startRing()
+{
+#if defined(__linux__)
+    mRing = new Ring();
+    const unsigned depth = static_cast<unsigned>(std::min(std::max(mConfig.queueDepth, static_cast<size_t>(1)), static_cast<size_t>(MAX_RING_ENTRIES)));
+    if(!mRing->create(depth))
+    {
+        //no io_uring in this kernel, or a seccomp filter refusing it
+        delete mRing;
+        mRing = 0;
+        return false;
+    }
+
+    mCompletionThread = std::thread(&IoEngine::completeReads, this);
+    return true;
+#else
+    return false;
+#endif
+}
+
+//------------------------------------------------------------------------------
+void IoEngine::stopRing()
+{
+#if defined(__linux__)
+    //nothing is in flight, so there is room for an empty entry telling the completion thread to stop
+    {
+        std::lock_guard<std::mutex> lock(mSubmitMutex);
+        io_uring_sqe entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.opcode = IORING_OP_NOP;
+        entry.user_data = 0;
+        mRing->push(entry);
+        mRing->submit();
+    }
+    mCompletionThread.join();
+
+    delete mRing;
+    mRing = 0;
+#endif
+}
+
+//------------------------------------------------------------------------------
+void IoEngine::submitRead(Read* read)
+{
+#if defined(__linux__)
+    std::lock_guard<std::mutex> lock(mSubmitMutex);
+    if(!mBacklog.empty() || mNbSubmitted >= mRing->nbEntries)
+    {
+        mBacklog.push_back(read);
+        return;
+    }
+
+    pushRead(read);
+    mRing->submit();
+#endif
+}
+
+//------------------------------------------------------------------------------
+void IoEngine::pushRead(Read* read)
+{
+#if defined(__linux__)
+    read->buffer.iov_base = &read->data[read->offset];
+    read->buffer.iov_len = read->data.size() - read->offset;
+
+    io_uring_sqe entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.opcode = IORING_OP_READV;
+    entry.fd = read->file;
+    entry.addr = reinterpret_cast<unsigned long long>(&read->buffer);
+    entry.len = 1;
+    entry.off = read->offset;
+    entry.user_data = reinterpret_cast<unsigned long long>(read);
+    mRing->push(entry);
+    ++mNbSubmitted;
+#endif
+}
+
+//------------------------------------------------------------------------------
+void IoEngine::completeReads()
+{
+#if defined(__linux__)
+    std::vector<Read*> finished;
+    bool isStopping = false;
+    while(!isStopping)
+    {
+        syscall(__NR_io_uring_enter, mRing->file, 0, 1, IORING_ENTER_GETEVENTS, 0, 0);
+
+        {
+            //reads were pushed under the lock, taking it orders what their submitters wrote before what we read here
+            std::lock_guard<std::mutex> lock(mSubmitMutex);
+            unsigned head = *mRing->completionHead;
+            const unsigned tail = __atomic_load_n(mRing->completionTail, __ATOMIC_ACQUIRE);
+            for(; head != tail; ++head)
+            {
+                const io_uring_cqe& completion = mRing->completions[head & mRing->completionMask];
+                Read* read = reinterpret_cast<Read*>(completion.user_data);
+                const int result = completion.res;
+                if(0 == read)
+                {
+                    isStopping = true;
+                    continue;
+                }
+
+                --mNbSubmitted;
+                if(-EINTR == result || -EAGAIN == result)
+                {
+                    mBacklog.push_front(read);
+                }
+                else if(result < 0)
+                {
+                    read->succeeded = false;
+                    finished.push_back(read);
+                }
+                else if(0 == result)
+                {
+                    //the file got shorter since we opened it
+                    read->data.resize(read->offset);
+                    read->succeeded = true;
+                    finished.push_back(read);
+                }
+                else
+                {
+                    read->offset += static_cast<size_t>(result);
+                    read->succeeded = (read->offset >= read->data.size());
+                    if(read->succeeded)
+                    {
+                        finished.push_back(read);
+                    }
+                    else
+                    {
+                        //short read, ask for the rest
+                        mBacklog.push_front(read);
+                    }
+                }
+            }
+            __atomic_store_n(mRing->completionHead, head, __ATOMIC_RELEASE);
+
+            //what completed made room for what was waiting
+            while(!mBacklog.empty() && mNbSubmitted < mRing->nbEntries)
+            {
+                pushRead(mBacklog.front());
+                mBacklog.pop_front();
+            }
+            mRing->submit();
+        }
+
+        //the manager may block us on a full queue, which must not keep others from submitting
+        for(std::vector<Read*>::const_iterator read = finished.begin(); read != finished.end(); ++read)
+        {
+            finishRead(*read, (*read)->succeeded);
+        }
+        finished.clear();
+    }
+#endif
+}
+
+//------------------------------------------------------------------------------
+void IoEngine::startThreads()
+{
+    const size_t nbThreads = std::max(mConfig.nbThreads, static_cast<size_t>(1));
+    for(size_t threadIdx = 0; threadIdx < nbThreads; ++threadIdx)
+    {
+        mThreads.push_back(std::thread(&IoEngine::readFiles, this));
+    }
+}
+
+//------------------------------------------------------------------------------
+void IoEngine::stopThreads()
+{
+    {
+        std::lock_guard<std::mutex> lock(mQueueMutex);
+        mIsStopping = true;
+    }
+    mQueueSignal.notify_all();
+
+    for(std::vector<std::thread>::iterator thread = mThreads.begin(); thread != mThreads.end(); ++thread)
+    {
+        thread->join();
+    }
+    mThreads.clear();
+}
+
+//------------------------------------------------------------------------------
+void IoEngine::readFiles()
+{
+    for(;;)
+    {
+        Read* read = 0;
+        {
+            std::unique_lock<std::mutex> lock(mQueueMutex);
+            while(mQueue.empty() && !mIsStopping)
+            {
+                mQueueSignal.wait(lock);
+            }
+            if(mQueue.empty())
+            {
+                return;
+            }
+            read = mQueue.front();
+            mQueue.pop_front();
+        }
+
+        std::FILE* file = std::fopen(read->path.c_str(), "rb");
+        if(0 == file)
+        {
+            finishRead(read, false);
+            continue;
+        }
+
+        //read until the end rather than trusting a size, which some files do not have
+        std::vector<char>& data = read->data;
+        size_t size = 0;
+        for(;;)
+        {
+            data.resize(size + READ_CHUNK_SIZE);
+            const size_t nbRead = std::fread(&data[size], 1, READ_CHUNK_SIZE, file);
+            size += nbRead;
+            if(nbRead < READ_CHUNK_SIZE)
+            {
+                break;
+            }
+        }
+        data.resize(size);
+
+        const bool succeeded = (0 == std::ferror(file));
+        std::fclose(file);
+        finishRead(read, succeeded);
+    }
+}
+
+//------------------------------------------------------------------------------
+void IoEngine::finishRead(Read* read, const bool succeeded)
+{
+#if defined(__linux__)
+    if(read->file >= 0)
+    {
+        close(read->file);
+        read->file = -1;
+    }
+#endif
+
+    read->succeeded = succeeded;
+    if(!succeeded)
+    {
+        read->data.clear();
+    }
+
+    mManager.run(CallableTask::create(ReadCallbackTask(this, read)), mConfig.priority);
+}
+
+//------------------------------------------------------------------------------
+void IoEngine::callBack(Read* read)
+{
+    read->callback(read->succeeded, read->data);
+    delete read;
+
+    //notify under the lock, so that a waiter cannot return, and destroy us, before we are done with our members
+    std::lock_guard<std::mutex> lock(mInFlightMutex);
+    --mNbInFlight;
+    if(0 == mNbInFlight)
+    {
+        mInFlightSignal.notify_all();
+    }
+}
+
+}
@@ -0,0 +1,132 @@
+#pragma once
+#include "Platform.h"
+#include "Manager.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace workers {
+
+//How an engine reads files
+enum class IoBackend {
+    //reads are queued to the kernel through io_uring and a single thread collects their completions,
+    //so the number of reads in flight is the queue depth rather than the number of threads
+    IO_URING,
+    //a few helper threads do blocking reads, one file at a time each
+    THREADS
+};
+
+//Settings used to construct an io engine
+struct IoEngineConfig {
+    inline IoEngineConfig();
+
+    //backend wanted, io_uring falls back to threads where the kernel lacks it or forbids it
+    IoBackend backend;
+    //most reads in flight at once with io_uring, others wait their turn
+    size_t queueDepth;
+    //helper threads without it
+    size_t nbThreads;
+    //priority read callbacks run at on the manager
+    Priority priority;
+};
+
+//Called with whether the whole file was read and its content
+typedef std::function<void (bool, std::vector<char>&)> ReadCallback;
+
+//Reads files without blocking the threads asking for them, running each read's callback on one of a manager's
+//workers once it completed, so a worker never waits on the disk. Many reads may be issued at once, keeping a
+//fast drive's queue full whatever the number of workers
+class EXAMPLES_LIB_API IoEngine {
+public:
+    IoEngine(Manager& manager, const IoEngineConfig& config = IoEngineConfig());
+    //Waits for the reads in flight, and their callbacks
+    ~IoEngine();
+
+    //Read a whole file, then call back on one of the manager's workers, or on whichever thread completed the read
+    //if the manager would not take it. A file that cannot be opened or read fails in the callback too
+    void readFile(const std::string& path, ReadCallback callback);
+    //Block until every read issued has completed and its callback returned. Never call from a callback
+    void wait();
+    size_t getNbInFlight() const;
+    //backend in use, which may not be the one asked for
+    inline IoBackend getBackend() const;
+    inline Manager& getManager() const;
+private:
+    IoEngine(const IoEngine&);
+    IoEngine& operator=(const IoEngine&);
+
+    friend struct ReadCallbackTask;
+    struct Read;
+    struct Ring;
+
+    //io_uring backend, false if the kernel does not let us have a ring
+    bool startRing();
+    void stopRing();
+    //queue the rest of a read to the kernel, or keep it for later if the ring is full
+    void submitRead(Read* read);
+    //write a read's entry on the submission queue, with mSubmitMutex held
+    void pushRead(Read* read);
+    //collect completions, on mCompletionThread
+    void completeReads();
+
+    //thread backend
+    void startThreads();
+    void stopThreads();
+    void readFiles();
+
+    //hand a finished read to the manager to call back
+    void finishRead(Read* read, const bool succeeded);
+    //call back and forget the read
+    void callBack(Read* read);
+
+    Manager& mManager;
+    IoEngineConfig mConfig;
+    IoBackend mBackend;
+
+    //reads issued whose callback has not returned yet, waited on by wait
+    size_t mNbInFlight;
+    mutable std::mutex mInFlightMutex;
+    std::condition_variable mInFlightSignal;
+
+    //io_uring, what is shared with the kernel
+    Ring* mRing;
+    std::mutex mSubmitMutex;
+    //reads kept while the ring is full, and how many the ring has
+    std::deque<Read*> mBacklog;
+    size_t mNbSubmitted;
+    std::thread mCompletionThread;
+
+    //threads, reads waiting for one of them
+    std::vector<std::thread> mThreads;
+    std::deque<Read*> mQueue;
+    std::mutex mQueueMutex;
+    std::condition_variable mQueueSignal;
+    bool mIsStopping;
+};
+
+//inline implementations
+//------------------------------------------------------------------------------
+IoEngineConfig::IoEngineConfig() : backend(IoBackend::IO_URING), queueDepth(256), nbThreads(4), priority(Priority::NORMAL)
+{
+
+}
+
+//------------------------------------------------------------------------------
+IoBackend IoEngine::getBackend() const
+{
+    return mBackend;
+}
+
+//------------------------------------------------------------------------------
+Manager& IoEngine::getManager() const
+{
+    return mManager;
+}
+
+}
@@ -0,0 +1,147 @@
+#include "LatencyHistogram.h"
+
+namespace workers {
+
+//------------------------------------------------------------------------------
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+//------------------------------------------------------------------------------
+LatencyHistogram::LatencyHistogram(const LatencyHistogram& other)
+{
+    reset();
+    merge(other);
+}
+
+//------------------------------------------------------------------------------
+LatencyHistogram& LatencyHistogram::operator=(const LatencyHistogram& other)
+{
+    if(this != &other)
+    {
+        reset();
+        merge(other);
+    }
+    return *this;
+}
+
+//------------------------------------------------------------------------------
+void LatencyHistogram::record(const std::chrono::steady_clock::duration duration)
+{
+    const uint64_t microseconds = getMicroseconds(duration);
+    const size_t bucketIdx = getBucket(microseconds);
+
+    mBuckets[bucketIdx].fetch_add(1, std::memory_order_relaxed);
+    mCount.fetch_add(1, std::memory_order_relaxed);
+    mTotal.fetch_add(microseconds, std::memory_order_relaxed);
+
+    uint64_t max = mMax.load(std::memory_order_relaxed);
+    while(microseconds > max && !mMax.compare_exchange_weak(max, microseconds, std::memory_order_relaxed))
+    {
+    }
+}
+
+//------------------------------------------------------------------------------
+void LatencyHistogram::recordFromOwner(const std::chrono::steady_clock::duration duration)
+{
+    const uint64_t microseconds = getMicroseconds(duration);
+    std::atomic<uint64_t>& bucket = mBuckets[getBucket(microseconds)];
+
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    mCount.store(mCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    mTotal.store(mTotal.load(std::memory_order_relaxed) + microseconds, std::memory_order_relaxed);
+    if(microseconds > mMax.load(std::memory_order_relaxed))
+    {
+        mMax.store(microseconds, std::memory_order_relaxed);
+    }
+}
+
+//------------------------------------------------------------------------------
+uint64_t LatencyHistogram::getMicroseconds(const std::chrono::steady_clock::duration duration)
+{
+    const long long signedMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    return signedMicroseconds > 0 ? static_cast<uint64_t>(signedMicroseconds) : 0;
+}
+
+//------------------------------------------------------------------------------
+size_t LatencyHistogram::getBucket(const uint64_t microseconds)
+{
+    size_t bucketIdx = 0;
+    while(bucketIdx < NB_BUCKETS - 1 && (uint64_t(1) << bucketIdx) <= microseconds)
+    {
+        ++bucketIdx;
+    }
+    return bucketIdx;
+}
+
+//------------------------------------------------------------------------------
+void LatencyHistogram::reset()
+{
+    for(size_t bucketIdx = 0; bucketIdx < NB_BUCKETS; ++bucketIdx)
+    {
+        mBuckets[bucketIdx].store(0, std::memory_order_relaxed);
+    }
+    mCount.store(0, std::memory_order_relaxed);
+    mTotal.store(0, std::memory_order_relaxed);
+    mMax.store(0, std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+void LatencyHistogram::merge(const LatencyHistogram& other)
+{
+    for(size_t bucketIdx = 0; bucketIdx < NB_BUCKETS; ++bucketIdx)
+    {
+        mBuckets[bucketIdx].fetch_add(other.getBucketCount(bucketIdx), std::memory_order_relaxed);
+    }
+    mCount.fetch_add(other.getCount(), std::memory_order_relaxed);
+    mTotal.fetch_add(other.mTotal.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+    const uint64_t otherMax = other.mMax.load(std::memory_order_relaxed);
+    uint64_t max = mMax.load(std::memory_order_relaxed);
+    while(otherMax > max && !mMax.compare_exchange_weak(max, otherMax, std::memory_order_relaxed))
+    {
+    }
+}
+
+//------------------------------------------------------------------------------
+std::chrono::microseconds LatencyHistogram::getMax() const
+{
+    return std::chrono::microseconds(mMax.load(std::memory_order_relaxed));
+}
+
+//------------------------------------------------------------------------------
+std::chrono::microseconds LatencyHistogram::getMean() const
+{
+    const uint64_t count = getCount();
+    return std::chrono::microseconds(0 == count ? 0 : mTotal.load(std::memory_order_relaxed) / count);
+}
+
+//------------------------------------------------------------------------------
+std::chrono::microseconds LatencyHistogram::getPercentile(const double fraction) const
+{
+    const uint64_t count = getCount();
+    if(0 == count)
+    {
+        return std::chrono::microseconds(0);
+    }
+
+    //rank of the duration we are after, counting from 1
+    uint64_t rank = static_cast<uint64_t>(fraction * count + 0.5);
+    rank = rank < 1 ? 1 : (rank > count ? count : rank);
+
+    uint64_t nbSeen = 0;
+    for(size_t bucketIdx = 0; bucketIdx < NB_BUCKETS; ++bucketIdx)
+    {
+        nbSeen += getBucketCount(bucketIdx);
+        if(nbSeen >= rank)
+        {
+            //never report more than what was actually recorded
+            const std::chrono::microseconds upperBound(uint64_t(1) << bucketIdx);
+            return upperBound < getMax() ? upperBound : getMax();
+        }
+    }
+    return getMax();
+}
+
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "Platform.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace workers {
+
+//Histogram of durations bucketed by powers of 2 of microseconds, so percentiles are accurate to within a factor of 2.
+//Recording is lock free and can be done from any number of threads. Copying takes a snapshot
+class EXAMPLES_LIB_API LatencyHistogram {
+public:
+    //bucket 0 holds durations under 1us, bucket i those under 2^i us, the last one everything longer
+    static const size_t NB_BUCKETS = 40;
+
+    LatencyHistogram();
+    LatencyHistogram(const LatencyHistogram& other);
+    LatencyHistogram& operator=(const LatencyHistogram& other);
+
+    void record(const std::chrono::steady_clock::duration duration);
+    //Same for a histogram a single thread records into, with relaxed loads and stores rather than read modify writes.
+    //Others may still read and copy it meanwhile, but two threads recording this way would lose durations
+    void recordFromOwner(const std::chrono::steady_clock::duration duration);
+    void reset();
+    //Add everything recorded in another histogram, to sum up several recorded apart
+    void merge(const LatencyHistogram& other);
+
+    inline const uint64_t getCount() const;
+    inline const uint64_t getBucketCount(const size_t bucketIdx) const;
+    std::chrono::microseconds getMax() const;
+    std::chrono::microseconds getMean() const;
+    //Upper bound of the bucket holding the given fraction (0 to 1) of recorded durations, 0 if nothing was recorded
+    std::chrono::microseconds getPercentile(const double fraction) const;
+private:
+    //duration in whole microseconds, and the bucket holding it
+    static uint64_t getMicroseconds(const std::chrono::steady_clock::duration duration);
+    static size_t getBucket(const uint64_t microseconds);
+
+    std::atomic<uint64_t> mBuckets[NB_BUCKETS];
+    std::atomic<uint64_t> mCount;
+    //in microseconds
+    std::atomic<uint64_t> mTotal;
+    std::atomic<uint64_t> mMax;
+};
+
+//inline implementations
+//------------------------------------------------------------------------------
+const uint64_t LatencyHistogram::getCount() const
+{
+    return mCount.load(std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+const uint64_t LatencyHistogram::getBucketCount(const size_t bucketIdx) const
+{
+    return mBuckets[bucketIdx].load(std::memory_order_relaxed);
+}
+
+}
@@ -1,58 +1,92 @@
 #include "Manager.h"
 #include "Worker.h"
 #include "Task.h"
+#include "TaskTrace.h"
 
+#include <algorithm>
 #include <functional>
 
 namespace workers {
 
+//manager whose timer thread we are, if any
+static thread_local const Manager* tlsTimerManager = 0;
+
+//------------------------------------------------------------------------------
+Manager::Manager(const size_t nbWorkers) : mConfig(nbWorkers), mNbWorkers(0), mIsQueueSlow(false), mNbBlockedProducers(0), mNbLockFreeTasks(0), mTimerEpoch(std::chrono::steady_clock::now()), mTimerWakeTick(UINT64_MAX), mNbAvailableWorkers(0), mNbLocalTasks(0), mNbCallerRunTasks(0), mNbWaiting(0), mShutdown(false)
+{
+    start();
+}
+
+//------------------------------------------------------------------------------
+Manager::Manager(const ManagerConfig& config) : mConfig(config), mNbWorkers(0), mIsQueueSlow(false), mNbBlockedProducers(0), mNbLockFreeTasks(0), mTimerEpoch(std::chrono::steady_clock::now()), mTimerWakeTick(UINT64_MAX), mNbAvailableWorkers(0), mNbLocalTasks(0), mNbCallerRunTasks(0), mNbWaiting(0), mShutdown(false)
+{
+    start();
+}
+
+//------------------------------------------------------------------------------
+Manager::~Manager()
+{
+    shutdown();
+}
+
 //------------------------------------------------------------------------------
-Manager::Manager(const size_t nbWorkers) : mShutdown(false)
+void Manager::start()
 {
-    mWorkers.reserve(nbWorkers);
+    const size_t nbWorkers = mConfig.nbWorkers;
+    const size_t maxWorkers = std::max(nbWorkers, mConfig.maxWorkers);
+    std::vector< std::atomic<Worker*> > workers(maxWorkers);
+    mWorkers.swap(workers);
+    mAvailableWorkers.reserve(maxWorkers);
+    mIdleTimes.resize(maxWorkers, std::chrono::steady_clock::now());
+    placeWorkers(maxWorkers);
+
+    const std::chrono::steady_clock::rep now = std::chrono::steady_clock::now().time_since_epoch().count();
+    for(size_t priority = 0; priority < NB_PRIORITIES; ++priority)
+    {
+        mNbQueuedTasks[priority] = 0;
+        mPriorityServedTimes[priority] = now;
+
+        if(QueueMode::LOCK_FREE == mConfig.queue)
+        {
+            mLockFreeTasks[priority].reset(new BoundedQueue<Task*>(mConfig.queueCapacity));
+        }
+    }
+
+    if(SchedulingMode::WORK_STEALING == mConfig.scheduling || mConfig.batchClaimSize > 1)
+    {
+        //placed workers make their own as they start, later ones need theirs now since thieves look at every deque
+        mWorkerQueues.resize(maxWorkers);
+        for(size_t workerIdx = mWorkerCpus.empty() ? 0 : nbWorkers; workerIdx < maxWorkers; ++workerIdx)
+        {
+            mWorkerQueues[workerIdx].reset(new WorkStealingDeque<Task*>());
+        }
+    }
 
     for(size_t workerIdx = 0; workerIdx < nbWorkers; ++workerIdx)
     {
         Worker* worker = new Worker([this](Worker* worker) -> void {
             //grab the next task if available, otherwise add our worker to a wait list
-            if(!this->isShutdown())
-            {
-                std::shared_ptr<Task> task;
-                {
-                    std::unique_lock<std::mutex> lock(mMutex);
-
-                    if(this->mTasks.empty())
-                    {
-                        this->mAvailableWorkers.push(worker);
-                    }
-                    else
-                    {
-                        //task available, run it
-                        task.swap(mTasks.front());
-                        this->mTasks.pop();
-                        this->mTasksRemovedSignal.notify_all();
-                    }
-                }
-                if(0 != task)
-                {
-                    worker->runTask(task);
-                }
-            }
-        } );
-        mWorkers.push_back(worker);
-        mAvailableWorkers.push(worker);
+            this->onWorkerAvailable(worker);
+        }, workerIdx, [this](Worker* worker) -> void {
+            this->onWorkerStart(worker);
+        }, mConfig.waitStrategy);
+        mWorkers[workerIdx] = worker;
+        mAvailableWorkers.push_back(worker);
     }
+    mNbWorkers = nbWorkers;
+    mNbAvailableWorkers = nbWorkers;
 
-    for(std::vector< Worker* >::iterator worker = mWorkers.begin(); worker != mWorkers.end(); ++worker)
+    for(std::vector< Worker* >::iterator worker = mAvailableWorkers.begin(); worker != mAvailableWorkers.end(); ++worker)
     {
         (*worker)->waitUntilReady();
     }
-}
 
-//------------------------------------------------------------------------------
-Manager::~Manager()
-{
-    shutdown();
+    if(maxWorkers > nbWorkers)
+    {
+        //look for idle workers often enough that none outstays its keep alive by much
+        const std::chrono::steady_clock::duration period = std::max<std::chrono::steady_clock::duration>(mConfig.keepAlive / 4, std::chrono::milliseconds(1));
+        runEvery(period, [this]() { this->retireIdleWorkers(); }, Priority::LOW);
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -62,27 +96,40 @@ void Manager::shutdown()
 
     if(wasShutdown)
     {
+        cancelTimers();
+
         {
             std::unique_lock<std::mutex> lock(mMutex);
-            {
-                std::queue<Worker*> empty;
-                std::swap(empty, mAvailableWorkers);
-            }
+            mAvailableWorkers.clear();
+            mNbAvailableWorkers = 0;
+        }
 
+        cancelQueuedTasks();
+
+        //waits for a retirement in progress, after which no worker can be added or removed
+        std::vector<Worker*> workers;
+        {
+            std::unique_lock<std::mutex> workersLock(mWorkersMutex);
+            for(size_t workerIdx = 0; workerIdx < mWorkers.size(); ++workerIdx)
             {
-                std::queue< std::shared_ptr<Task> > empty;
-                std::swap(empty, mTasks);
-                mTasksRemovedSignal.notify_all();
+                Worker* worker = mWorkers[workerIdx].exchange(0);
+                if(0 != worker)
+                {
+                    workers.push_back(worker);
+                }
             }
         }
 
-        for(std::vector< Worker* >::iterator worker = mWorkers.begin(); worker != mWorkers.end(); ++worker)
+        for(std::vector< Worker* >::iterator worker = workers.begin(); worker != workers.end(); ++worker)
         {
             (*worker)->shutdown();
             delete (*worker);
         }
 
-        mWorkers.clear();
+        mNbWorkers = 0;
+
+        //worker threads are gone, catch anything they queued while stopping
+        cancelQueuedTasks();
     }
 }
 
@@ -90,42 +137,1204 @@ void Manager::shutdown()
 void Manager::waitForTasksToComplete()
 {
     std::unique_lock<std::mutex> lock(mMutex);
+    ++mNbWaiting;
 
-    while(!mTasks.empty())
+    while(hasQueuedTasks() || hasUnlockedTasks())
     {
         mTasksRemovedSignal.wait(lock);
     }
+
+    --mNbWaiting;
+}
+
+//------------------------------------------------------------------------------
+bool Manager::run(std::shared_ptr<Task> task, const Priority priority)
+{
+    return run(TaskHandle(task), priority);
+}
+
+//------------------------------------------------------------------------------
+bool Manager::run(TaskHandle task, const Priority priority)
+{
+    return dispatchTask(task, priority, false);
+}
+
+//------------------------------------------------------------------------------
+bool Manager::tryRun(TaskHandle task, const Priority priority)
+{
+    return dispatchTask(task, priority, true);
+}
+
+//------------------------------------------------------------------------------
+bool Manager::tryRun(std::shared_ptr<Task> task, const Priority priority)
+{
+    return tryRun(TaskHandle(task), priority);
 }
 
 //------------------------------------------------------------------------------
-void Manager::run(std::shared_ptr<Task> task)
+bool Manager::dispatchTask(TaskHandle& task, const Priority priority, const bool isTry)
 {
+    const size_t band = static_cast<size_t>(priority);
+
+    //nothing to run, nor to hand a worker taken off the available list
+    if(!task)
+    {
+        return false;
+    }
+
+    if(TaskTrace::isEnabled())
+    {
+        TaskTrace::record(TraceEvent::SUBMIT, task.get(), TaskTrace::NO_WORKER, std::chrono::steady_clock::now());
+    }
+
     //we want to run this task in a worker if one is available, else, add it to a queue
-    if(!isShutdown())
+    Worker* current = isShutdown() ? 0 : getCurrentWorker();
+    if(0 != current && SchedulingMode::WORK_STEALING == mConfig.scheduling && Priority::NORMAL == priority)
     {
-        Worker* worker = 0;
+        //run from one of our tasks, keep it on this worker's deque, where no lock is needed.
+        //Other priorities go through the queue, where they are ordered
+        pushLocalTask(current->getId(), std::move(task));
+        if(mNbAvailableWorkers > 0)
         {
-            std::unique_lock<std::mutex> lock(mMutex);
-            if(mAvailableWorkers.empty())
+            wakeAvailableWorker();
+        }
+        return true;
+    }
+
+    //a worker waiting for room could leave none to make it, and our timer thread waiting would hold up every timer
+    const bool isOwnThread = 0 != current || this == tlsTimerManager;
+    const OverflowPolicy policy = (OverflowPolicy::BLOCK == mConfig.overflowPolicy && isOwnThread) ? OverflowPolicy::CALLER_RUNS : mConfig.overflowPolicy;
+
+    for(;;)
+    {
+        if(isShutdown())
+        {
+            if(task)
             {
-                //no workers available, queue the task
-                mTasks.push(task);
+                task->setCompletionStatus(false);
             }
-            else
+            return false;
+        }
+
+        if(QueueMode::LOCK_FREE == mConfig.queue)
+        {
+            //no lock between producers, only an idle worker needs the mutex to be woken
+            if(pushQueuedTask(task, band))
             {
-                //worker available, grab it, and run task
-                worker = mAvailableWorkers.front();
-                mAvailableWorkers.pop();
+                if(mNbAvailableWorkers > 0)
+                {
+                    wakeAvailableWorker();
+                }
+                else
+                {
+                    growIfNeeded();
+                }
+                return true;
             }
         }
-        if(0 != worker)
+        else
+        {
+            Worker* worker = 0;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                if(!mAvailableWorkers.empty())
+                {
+                    //worker available, grab it, and run task
+                    worker = takeAvailableWorker(task->getNodeHint());
+                }
+                else if(!isQueueFull())
+                {
+                    //no workers available, queue the task
+                    queueTask(std::move(task), band);
+                }
+                else if(OverflowPolicy::BLOCK == policy && !isTry)
+                {
+                    //shutdown takes the mutex before waking us, so checking under it means we cannot miss that
+                    if(!isShutdown())
+                    {
+                        ++mNbBlockedProducers;
+                        mQueueSpaceSignal.wait(lock);
+                        --mNbBlockedProducers;
+                    }
+                    continue;
+                }
+            }
+
+            if(0 != worker)
+            {
+                worker->onTaskDequeued(band, std::chrono::steady_clock::duration::zero());
+                worker->runTask(std::move(task));
+                return true;
+            }
+            if(!task)
+            {
+                growIfNeeded();
+                return true;
+            }
+        }
+
+        //the queue is full
+        if(isTry)
+        {
+            return false;
+        }
+        switch(policy)
         {
-            worker->runTask(task);
+        case OverflowPolicy::BLOCK:
+            //only the lock free queue gets here, which has nothing to wait on
+            std::this_thread::yield();
+            break;
+        case OverflowPolicy::REJECT:
+            task->setCompletionStatus(false);
+            return false;
+        case OverflowPolicy::CALLER_RUNS:
+            runOnCaller(task);
+            return true;
+        case OverflowPolicy::DROP_OLDEST:
+            dropOldestTask();
+            break;
         }
     }
-    else if(task != 0)
+}
+
+//------------------------------------------------------------------------------
+void Manager::runBatch(const std::shared_ptr<Task>* tasks, const size_t nbTasks, const Priority priority)
+{
+    std::vector<TaskHandle> handles;
+    handles.reserve(nbTasks);
+    for(size_t taskIdx = 0; taskIdx < nbTasks; ++taskIdx)
     {
-        task->setCompletionStatus(false);
+        handles.push_back(TaskHandle(tasks[taskIdx]));
+    }
+    runBatch(handles, priority);
+}
+
+//------------------------------------------------------------------------------
+void Manager::runBatch(const TaskHandle* tasks, const size_t nbTasks, const Priority priority)
+{
+    const size_t band = static_cast<size_t>(priority);
+
+    if(isShutdown())
+    {
+        for(size_t taskIdx = 0; taskIdx < nbTasks; ++taskIdx)
+        {
+            if(tasks[taskIdx])
+            {
+                tasks[taskIdx]->setCompletionStatus(false);
+            }
+        }
+        return;
+    }
+
+    bool hasNullTask = false;
+    for(size_t taskIdx = 0; taskIdx < nbTasks && !hasNullTask; ++taskIdx)
+    {
+        hasNullTask = !tasks[taskIdx];
+    }
+
+    Worker* current = (SchedulingMode::WORK_STEALING == mConfig.scheduling && Priority::NORMAL == priority) ? getCurrentWorker() : 0;
+    if((0 == current && mConfig.maxQueuedTasks > 0) || hasNullTask)
+    {
+        //the queue may fill up part way through, let run deal with it task by task. Run also skips null tasks
+        for(size_t taskIdx = 0; taskIdx < nbTasks; ++taskIdx)
+        {
+            run(tasks[taskIdx], priority);
+        }
+        return;
+    }
+
+    if(TaskTrace::isEnabled())
+    {
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        for(size_t taskIdx = 0; taskIdx < nbTasks; ++taskIdx)
+        {
+            TaskTrace::record(TraceEvent::SUBMIT, tasks[taskIdx].get(), TaskTrace::NO_WORKER, now);
+        }
+    }
+
+    if(0 != current || QueueMode::LOCK_FREE == mConfig.queue)
+    {
+        for(size_t taskIdx = 0; taskIdx < nbTasks; ++taskIdx)
+        {
+            if(0 != current)
+            {
+                pushLocalTask(current->getId(), tasks[taskIdx]);
+                continue;
+            }
+
+            //a full ring waits for room, whatever the policy, as it always has
+            TaskHandle task = tasks[taskIdx];
+            while(!pushQueuedTask(task, band))
+            {
+                if(isShutdown())
+                {
+                    task->setCompletionStatus(false);
+                    break;
+                }
+                std::this_thread::yield();
+            }
+        }
+        wakeAvailableWorkers(nbTasks);
+        growIfNeeded();
+        return;
+    }
+
+    //hand the first tasks straight to available workers, queue the rest, all under one lock
+    std::vector<Worker*> workers;
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+
+        workers.reserve(std::min(nbTasks, mAvailableWorkers.size()));
+        while(workers.size() < nbTasks && !mAvailableWorkers.empty())
+        {
+            workers.push_back(takeAvailableWorker(tasks[workers.size()]->getNodeHint()));
+        }
+
+        for(size_t taskIdx = workers.size(); taskIdx < nbTasks; ++taskIdx)
+        {
+            queueTask(tasks[taskIdx], band);
+        }
+    }
+
+    for(size_t workerIdx = 0; workerIdx < workers.size(); ++workerIdx)
+    {
+        workers[workerIdx]->onTaskDequeued(band, std::chrono::steady_clock::duration::zero());
+        workers[workerIdx]->runTask(tasks[workerIdx]);
+    }
+    if(workers.size() < nbTasks)
+    {
+        growIfNeeded();
+    }
+}
+
+//------------------------------------------------------------------------------
+std::shared_ptr<Task> Manager::runThen(std::shared_ptr<Task> task, std::function<bool (bool)> continuation)
+{
+    //attach before running, so the continuation cannot miss the completion
+    std::shared_ptr<Task> continuationTask = task->then(*this, continuation);
+    run(task);
+    return continuationTask;
+}
+
+//------------------------------------------------------------------------------
+TimerId Manager::runAfter(const std::chrono::steady_clock::duration delay, TaskHandle task, const Priority priority)
+{
+    return addTimer(std::chrono::steady_clock::now() + delay, std::chrono::steady_clock::duration::zero(), std::move(task), std::function<void (void)>(), priority);
+}
+
+//------------------------------------------------------------------------------
+TimerId Manager::runAfter(const std::chrono::steady_clock::duration delay, std::shared_ptr<Task> task, const Priority priority)
+{
+    return runAfter(delay, TaskHandle(task), priority);
+}
+
+//------------------------------------------------------------------------------
+TimerId Manager::runAt(const std::chrono::steady_clock::time_point time, TaskHandle task, const Priority priority)
+{
+    return addTimer(time, std::chrono::steady_clock::duration::zero(), std::move(task), std::function<void (void)>(), priority);
+}
+
+//------------------------------------------------------------------------------
+TimerId Manager::runAt(const std::chrono::steady_clock::time_point time, std::shared_ptr<Task> task, const Priority priority)
+{
+    return runAt(time, TaskHandle(task), priority);
+}
+
+//------------------------------------------------------------------------------
+TimerId Manager::runEvery(const std::chrono::steady_clock::duration period, std::function<void (void)> function, const Priority priority)
+{
+    //a period of no ticks would make the timer a one shot one
+    const std::chrono::steady_clock::duration tick = std::chrono::milliseconds(1);
+    const std::chrono::steady_clock::duration everyTick = (period < tick) ? tick : period;
+    return addTimer(std::chrono::steady_clock::now() + everyTick, everyTick, TaskHandle(), std::move(function), priority);
+}
+
+//------------------------------------------------------------------------------
+bool Manager::cancelTimer(const TimerId timer)
+{
+    TimedTask timed;
+    {
+        std::unique_lock<std::mutex> lock(mTimerMutex);
+        if(!mTimers.cancel(timer, timed))
+        {
+            return false;
+        }
+    }
+
+    if(timed.task)
+    {
+        timed.task->setCompletionStatus(false);
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+TimerId Manager::addTimer(const std::chrono::steady_clock::time_point time, const std::chrono::steady_clock::duration period, TaskHandle task,
+    std::function<void (void)> function, const Priority priority)
+{
+    TimedTask timed;
+    timed.task = std::move(task);
+    if(function)
+    {
+        timed.function = std::make_shared< std::function<void (void)> >(std::move(function));
+    }
+    timed.priority = priority;
+
+    //round up to whole ticks, so that timers never fire early
+    const long long sinceEpoch = std::chrono::duration_cast<std::chrono::nanoseconds>(time - mTimerEpoch).count();
+    const uint64_t tick = (sinceEpoch > 0) ? static_cast<uint64_t>((sinceEpoch + 999999) / 1000000) : 0;
+    const long long periodNs = std::chrono::duration_cast<std::chrono::nanoseconds>(period).count();
+    const uint64_t periodTicks = (periodNs > 0) ? static_cast<uint64_t>((periodNs + 999999) / 1000000) : 0;
+
+    std::unique_lock<std::mutex> lock(mTimerMutex);
+
+    if(isShutdown())
+    {
+        lock.unlock();
+        if(timed.task)
+        {
+            timed.task->setCompletionStatus(false);
+        }
+        return TimerId();
+    }
+
+    const TimerId id = mTimers.add(tick, std::move(timed), periodTicks);
+    if(0 == mTimerThread)
+    {
+        mTimerThread.reset(new std::thread(std::bind(&Manager::runTimers, this)));
+    }
+    else if(tick < mTimerWakeTick)
+    {
+        mTimerSignal.notify_one();
+    }
+    return id;
+}
+
+//------------------------------------------------------------------------------
+void Manager::runTimers()
+{
+    tlsTimerManager = this;
+    std::vector<TimedTask> expired;
+    std::unique_lock<std::mutex> lock(mTimerMutex);
+
+    while(!isShutdown())
+    {
+        const std::chrono::steady_clock::duration sinceEpoch = std::chrono::steady_clock::now() - mTimerEpoch;
+        mTimers.advance(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(sinceEpoch).count()), expired);
+
+        if(!expired.empty())
+        {
+            //run them without holding up anyone adding or cancelling timers
+            lock.unlock();
+            for(std::vector<TimedTask>::iterator timed = expired.begin(); timed != expired.end(); ++timed)
+            {
+                if(timed->task)
+                {
+                    run(std::move(timed->task), timed->priority);
+                }
+                else
+                {
+                    std::shared_ptr< std::function<void (void)> > function = timed->function;
+                    submit([function]() { (*function)(); }, timed->priority);
+                }
+            }
+            expired.clear();
+            lock.lock();
+            continue;
+        }
+
+        mTimerWakeTick = mTimers.getNextTick();
+        if(UINT64_MAX == mTimerWakeTick)
+        {
+            mTimerSignal.wait(lock);
+        }
+        else
+        {
+            mTimerSignal.wait_until(lock, mTimerEpoch + std::chrono::milliseconds(mTimerWakeTick));
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void Manager::cancelTimers()
+{
+    std::unique_ptr<std::thread> thread;
+    {
+        std::unique_lock<std::mutex> lock(mTimerMutex);
+        thread.swap(mTimerThread);
+        mTimerSignal.notify_all();
+    }
+    if(0 != thread)
+    {
+        thread->join();
+    }
+
+    std::vector<TimedTask> timers;
+    {
+        std::unique_lock<std::mutex> lock(mTimerMutex);
+        mTimers.clear(timers);
+    }
+    for(std::vector<TimedTask>::iterator timed = timers.begin(); timed != timers.end(); ++timed)
+    {
+        if(timed->task)
+        {
+            timed->task->setCompletionStatus(false);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+ManagerStats Manager::getStats()
+{
+    ManagerStats stats;
+    for(size_t priority = 0; priority < NB_PRIORITIES; ++priority)
+    {
+        stats.nbQueuedTasks[priority] = mNbQueuedTasks[priority];
+    }
+    stats.nbLocalTasks = mNbLocalTasks;
+    stats.nbIdleWorkers = mNbAvailableWorkers;
+    stats.nbCallerRunTasks = mNbCallerRunTasks;
+    stats.runTimes.merge(mCallerRunTimes);
+
+    //keeps workers from being retired while we read them
+    std::unique_lock<std::mutex> workersLock(mWorkersMutex);
+    for(size_t workerIdx = 0; workerIdx < mWorkers.size(); ++workerIdx)
+    {
+        Worker* worker = mWorkers[workerIdx];
+        if(0 != worker)
+        {
+            stats.workers.push_back(worker->getStats());
+            stats.runTimes.merge(stats.workers.back().runTimes);
+            for(size_t priority = 0; priority < NB_PRIORITIES; ++priority)
+            {
+                stats.queueWaitTimes[priority].merge(stats.workers.back().queueWaitTimes[priority]);
+            }
+        }
+    }
+    stats.nbWorkers = stats.workers.size();
+    return stats;
+}
+
+//------------------------------------------------------------------------------
+LatencyHistogram Manager::getQueueWaitTimes(const Priority priority)
+{
+    LatencyHistogram queueWaitTimes;
+    std::unique_lock<std::mutex> workersLock(mWorkersMutex);
+    for(size_t workerIdx = 0; workerIdx < mWorkers.size(); ++workerIdx)
+    {
+        Worker* worker = mWorkers[workerIdx];
+        if(0 != worker)
+        {
+            queueWaitTimes.merge(worker->getStats().queueWaitTimes[static_cast<size_t>(priority)]);
+        }
+    }
+    return queueWaitTimes;
+}
+
+//------------------------------------------------------------------------------
+void Manager::onWorkerAvailable(Worker* worker)
+{
+    if(isShutdown())
+    {
+        return;
+    }
+
+    TaskHandle task;
+    bool hasTask = false;
+
+    if(!mWorkerQueues.empty())
+    {
+        const size_t workerIdx = worker->getId();
+
+        //urgent tasks first, then our own deque, then tasks run from outside the pool, then other workers
+        hasTask = (hasUrgentTasks() && popQueuedTask(task, worker, false)) || popLocalTask(workerIdx, task) || claimQueuedTasks(worker, task) || stealTask(workerIdx, task) || popQueuedTask(task, worker, true);
+
+        if(hasTask && mNbAvailableWorkers > 0 && !mWorkerQueues[workerIdx]->empty())
+        {
+            //we have more work than we can use, share it
+            wakeAvailableWorkers(mWorkerQueues[workerIdx]->size());
+        }
+    }
+    else
+    {
+        hasTask = popQueuedTask(task, worker, true);
+    }
+
+    if(!hasTask && hasUnlockedTasks())
+    {
+        //a task may have been pushed without the mutex after we looked but before we became available
+        wakeAvailableWorker();
+    }
+
+    if(hasTask)
+    {
+        worker->runTask(std::move(task));
+        growIfNeeded();
+    }
+}
+
+//------------------------------------------------------------------------------
+void Manager::wakeAvailableWorkers(size_t nbWorkers)
+{
+    while(nbWorkers > 0 && mNbAvailableWorkers > 0)
+    {
+        //take a handful of workers per trip through the mutex
+        Worker* workers[16];
+        size_t nbTaken = 0;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            if(isShutdown())
+            {
+                return;
+            }
+            while(nbTaken < nbWorkers && nbTaken < 16 && !mAvailableWorkers.empty())
+            {
+                workers[nbTaken++] = mAvailableWorkers.back();
+                mAvailableWorkers.pop_back();
+                --mNbAvailableWorkers;
+            }
+        }
+
+        if(0 == nbTaken)
+        {
+            return;
+        }
+        nbWorkers -= nbTaken;
+
+        //if nothing is left for a worker, it goes back to being available
+        for(size_t workerIdx = 0; workerIdx < nbTaken; ++workerIdx)
+        {
+            TaskHandle task;
+            if(stealTask(workers[workerIdx]->getId(), task) || popQueuedTask(task, workers[workerIdx], true))
+            {
+                workers[workerIdx]->runTask(std::move(task));
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+Worker* Manager::getCurrentWorker()
+{
+    Worker* worker = Worker::getCurrent();
+
+    if(0 != worker && worker->getId() < mWorkers.size() && mWorkers[worker->getId()] == worker)
+    {
+        return worker;
+    }
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+void Manager::placeWorkers(const size_t nbWorkers)
+{
+    mTopology = Topology::read();
+    if(WorkerPlacement::NONE == mConfig.placement)
+    {
+        return;
+    }
+
+    //keep to the processors asked for, dropping nodes left without any
+    std::vector< std::vector<int> > nodeCpus;
+    std::vector<int> nodes;
+    for(size_t node = 0; node < mTopology.getNbNodes(); ++node)
+    {
+        std::vector<int> cpus;
+        const std::vector<int>& topologyCpus = mTopology.getCpus(node);
+        for(std::vector<int>::const_iterator cpu = topologyCpus.begin(); cpu != topologyCpus.end(); ++cpu)
+        {
+            if(mConfig.cpus.empty() || mConfig.cpus.end() != std::find(mConfig.cpus.begin(), mConfig.cpus.end(), *cpu))
+            {
+                cpus.push_back(*cpu);
+            }
+        }
+        if(!cpus.empty())
+        {
+            nodeCpus.push_back(cpus);
+            nodes.push_back(static_cast<int>(node));
+        }
+    }
+    if(nodes.empty())
+    {
+        return;
+    }
+
+    //deal workers out to the nodes in turn, then to the processors within each node
+    mWorkerCpus.resize(nbWorkers);
+    mWorkerNodes.resize(nbWorkers);
+    for(size_t workerIdx = 0; workerIdx < nbWorkers; ++workerIdx)
+    {
+        const size_t nodeIdx = workerIdx % nodes.size();
+        const std::vector<int>& cpus = nodeCpus[nodeIdx];
+        mWorkerNodes[workerIdx] = nodes[nodeIdx];
+        if(WorkerPlacement::CORE == mConfig.placement)
+        {
+            mWorkerCpus[workerIdx].push_back(cpus[(workerIdx / nodes.size()) % cpus.size()]);
+        }
+        else
+        {
+            mWorkerCpus[workerIdx] = cpus;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void Manager::onWorkerStart(Worker* worker)
+{
+    const size_t workerIdx = worker->getId();
+    if(mWorkerCpus.empty())
+    {
+        return;
+    }
+
+    Topology::setThreadAffinity(mWorkerCpus[workerIdx]);
+
+    //allocated once pinned, first touch puts it on our node
+    if(!mWorkerQueues.empty() && !mWorkerQueues[workerIdx])
+    {
+        mWorkerQueues[workerIdx].reset(new WorkStealingDeque<Task*>());
+    }
+}
+
+//------------------------------------------------------------------------------
+Worker* Manager::takeAvailableWorker(const int node)
+{
+    size_t availableIdx = mAvailableWorkers.size() - 1;
+    if(node >= 0 && !mWorkerNodes.empty())
+    {
+        for(size_t candidateIdx = mAvailableWorkers.size(); candidateIdx-- > 0;)
+        {
+            if(mWorkerNodes[mAvailableWorkers[candidateIdx]->getId()] == node)
+            {
+                availableIdx = candidateIdx;
+                break;
+            }
+        }
+    }
+
+    Worker* worker = mAvailableWorkers[availableIdx];
+    mAvailableWorkers.erase(mAvailableWorkers.begin() + availableIdx);
+    --mNbAvailableWorkers;
+    return worker;
+}
+
+//------------------------------------------------------------------------------
+void Manager::growIfNeeded()
+{
+    //cheap checks first, a fixed size pool never gets past this
+    if(mNbWorkers >= mWorkers.size() || mNbAvailableWorkers > 0 || isShutdown())
+    {
+        return;
+    }
+
+    size_t nbQueued = 0;
+    for(size_t priority = 0; priority < NB_PRIORITIES; ++priority)
+    {
+        nbQueued += mNbQueuedTasks[priority];
+    }
+    if(0 == nbQueued || (nbQueued < mConfig.growQueueDepth && !mIsQueueSlow))
+    {
+        return;
+    }
+
+    //someone else adding or retiring a worker, they will do
+    std::unique_lock<std::mutex> workersLock(mWorkersMutex, std::try_to_lock);
+    if(!workersLock.owns_lock() || isShutdown())
+    {
+        return;
+    }
+
+    size_t workerIdx = 0;
+    while(workerIdx < mWorkers.size() && 0 != mWorkers[workerIdx])
+    {
+        ++workerIdx;
+    }
+    if(workerIdx == mWorkers.size())
+    {
+        return;
+    }
+
+    mIsQueueSlow = false;
+    Worker* worker = new Worker([this](Worker* worker) -> void {
+        this->onWorkerAvailable(worker);
+    }, workerIdx, [this](Worker* worker) -> void {
+        this->onWorkerStart(worker);
+    }, mConfig.waitStrategy);
+    mWorkers[workerIdx] = worker;
+    ++mNbWorkers;
+    workersLock.unlock();
+
+    //start it on whatever is waiting, or make it available
+    TaskHandle task;
+    if(stealTask(workerIdx, task) || popQueuedTask(task, worker, true))
+    {
+        worker->runTask(std::move(task));
+    }
+}
+
+//------------------------------------------------------------------------------
+void Manager::retireIdleWorkers()
+{
+    std::unique_lock<std::mutex> workersLock(mWorkersMutex);
+    if(isShutdown())
+    {
+        return;
+    }
+
+    //longest idle first, nobody can hand them a task once they leave the available list
+    std::vector<Worker*> workers;
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        while(mNbWorkers - workers.size() > mConfig.nbWorkers && !mAvailableWorkers.empty() &&
+            now - mIdleTimes[mAvailableWorkers.front()->getId()] >= mConfig.keepAlive)
+        {
+            workers.push_back(mAvailableWorkers.front());
+            mAvailableWorkers.erase(mAvailableWorkers.begin());
+            --mNbAvailableWorkers;
+        }
+    }
+
+    for(std::vector< Worker* >::iterator worker = workers.begin(); worker != workers.end(); ++worker)
+    {
+        const size_t workerIdx = (*worker)->getId();
+        mWorkers[workerIdx] = 0;
+        --mNbWorkers;
+        (*worker)->shutdown();
+        delete (*worker);
+
+        //its thread is gone, pass on anything its last task left on its deque
+        TaskHandle task;
+        while(workerIdx < mWorkerQueues.size() && popLocalTask(workerIdx, task))
+        {
+            run(std::move(task));
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+bool Manager::pushQueuedTask(TaskHandle& task, const size_t priority)
+{
+    //count first so that a worker becoming available never misses a task that is being pushed
+    const size_t nbQueued = ++mNbLockFreeTasks;
+    if(mConfig.maxQueuedTasks > 0 && nbQueued > mConfig.maxQueuedTasks)
+    {
+        onTaskRemoved(mNbLockFreeTasks);
+        return false;
+    }
+
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    task->mQueuedTime = now;
+    if(0 == mNbQueuedTasks[priority]++)
+    {
+        mPriorityServedTimes[priority] = now.time_since_epoch().count();
+    }
+
+    if(!mLockFreeTasks[priority]->tryPush(task.get()))
+    {
+        --mNbQueuedTasks[priority];
+        onTaskRemoved(mNbLockFreeTasks);
+        return false;
+    }
+
+    //the queue holds our reference now
+    task.release();
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void Manager::dropOldestTask()
+{
+    TaskHandle dropped;
+    if(QueueMode::LOCK_FREE == mConfig.queue)
+    {
+        for(size_t priority = NB_PRIORITIES; priority > 0 && !dropped; --priority)
+        {
+            Task* queued = 0;
+            if(mLockFreeTasks[priority - 1]->tryPop(queued))
+            {
+                --mNbQueuedTasks[priority - 1];
+                dropped = TaskHandle::adopt(queued);
+                onTaskRemoved(mNbLockFreeTasks);
+            }
+        }
+    }
+    else
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        for(size_t priority = NB_PRIORITIES; priority > 0 && !dropped; --priority)
+        {
+            if(!mTasks[priority - 1].empty())
+            {
+                dropped.swap(mTasks[priority - 1].front());
+                mTasks[priority - 1].pop();
+                --mNbQueuedTasks[priority - 1];
+            }
+        }
+    }
+
+    //workers may have emptied the queue meanwhile, in which case there is room already
+    if(dropped)
+    {
+        dropped->setCompletionStatus(false);
+    }
+}
+
+//------------------------------------------------------------------------------
+void Manager::runOnCaller(TaskHandle& task)
+{
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if(TaskTrace::isEnabled())
+    {
+        TaskTrace::record(TraceEvent::START, task.get(), TaskTrace::NO_WORKER, start);
+    }
+
+    task->perform([]() {});
+
+    const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    if(TaskTrace::isEnabled())
+    {
+        TaskTrace::record(TraceEvent::END, task.get(), TaskTrace::NO_WORKER, end);
+    }
+    mCallerRunTimes.record(end - start);
+    mNbCallerRunTasks.fetch_add(1, std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+void Manager::queueTask(TaskHandle task, const size_t priority)
+{
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    task->mQueuedTime = now;
+    if(mTasks[priority].empty())
+    {
+        mPriorityServedTimes[priority] = now.time_since_epoch().count();
+    }
+
+    mTasks[priority].push(std::move(task));
+    ++mNbQueuedTasks[priority];
+}
+
+//------------------------------------------------------------------------------
+bool Manager::popQueuedTask(TaskHandle& task, Worker* worker, const bool makeAvailable)
+{
+    Worker* availableWorker = makeAvailable ? worker : 0;
+    if(QueueMode::LOCK_FREE == mConfig.queue)
+    {
+        Task* queued = 0;
+        size_t priority = 0;
+        if(popLockFreeTask(queued, priority, worker))
+        {
+            task = TaskHandle::adopt(queued);
+            onTaskRemoved(mNbLockFreeTasks);
+            return true;
+        }
+
+        if(0 != availableWorker)
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            if(!isShutdown())
+            {
+                mAvailableWorkers.push_back(availableWorker);
+                ++mNbAvailableWorkers;
+                mIdleTimes[availableWorker->getId()] = std::chrono::steady_clock::now();
+            }
+        }
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    const size_t priority = selectPriority(now);
+    if(NB_PRIORITIES == priority)
+    {
+        if(0 != availableWorker && !isShutdown())
+        {
+            mAvailableWorkers.push_back(availableWorker);
+            ++mNbAvailableWorkers;
+            mIdleTimes[availableWorker->getId()] = now;
+        }
+        return false;
+    }
+
+    //task available, run it
+    task.swap(mTasks[priority].front());
+    mTasks[priority].pop();
+    --mNbQueuedTasks[priority];
+    onTaskDequeued(task.get(), priority, now, worker);
+    if(mNbBlockedProducers > 0)
+    {
+        mQueueSpaceSignal.notify_one();
+    }
+
+    if(mNbWaiting > 0 && !hasQueuedTasks())
+    {
+        mTasksRemovedSignal.notify_all();
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool Manager::popLockFreeTask(Task*& task, size_t& priority, Worker* worker)
+{
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    //the band we pick may still be getting its task pushed, fall back to whatever band has one
+    priority = selectPriority(now);
+    if(NB_PRIORITIES == priority || !mLockFreeTasks[priority]->tryPop(task))
+    {
+        for(priority = 0; priority < NB_PRIORITIES; ++priority)
+        {
+            if(mLockFreeTasks[priority]->tryPop(task))
+            {
+                break;
+            }
+        }
+        if(NB_PRIORITIES == priority)
+        {
+            return false;
+        }
+    }
+
+    --mNbQueuedTasks[priority];
+    onTaskDequeued(task, priority, now, worker);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+size_t Manager::selectPriority(const std::chrono::steady_clock::time_point now) const
+{
+    const std::chrono::steady_clock::rep agedTime = (now - mConfig.agingThreshold).time_since_epoch().count();
+    size_t selected = NB_PRIORITIES;
+
+    for(size_t priority = 0; priority < NB_PRIORITIES; ++priority)
+    {
+        if(0 == mNbQueuedTasks[priority])
+        {
+            continue;
+        }
+        if(NB_PRIORITIES == selected)
+        {
+            selected = priority;
+        }
+        else if(mPriorityServedTimes[priority] < agedTime)
+        {
+            //a lower band that was passed over for too long goes first
+            return priority;
+        }
+    }
+    return selected;
+}
+
+//------------------------------------------------------------------------------
+void Manager::onTaskDequeued(Task* task, const size_t priority, const std::chrono::steady_clock::time_point now, Worker* worker)
+{
+    mPriorityServedTimes[priority] = now.time_since_epoch().count();
+    if(0 != worker)
+    {
+        worker->onTaskDequeued(priority, now - task->mQueuedTime);
+    }
+
+    if(now - task->mQueuedTime >= mConfig.growWaitTime && mNbWorkers < mWorkers.size())
+    {
+        mIsQueueSlow = true;
+    }
+}
+
+//------------------------------------------------------------------------------
+bool Manager::claimQueuedTasks(Worker* worker, TaskHandle& task)
+{
+    if(mConfig.batchClaimSize < 2)
+    {
+        return popQueuedTask(task, worker, false);
+    }
+
+    const size_t workerIdx = worker->getId();
+    const size_t nbWorkers = mWorkerQueues.size();
+
+    if(QueueMode::LOCK_FREE == mConfig.queue)
+    {
+        Task* queued = 0;
+        size_t priority = 0;
+        if(!popLockFreeTask(queued, priority, worker))
+        {
+            return false;
+        }
+        task = TaskHandle::adopt(queued);
+
+        //extras come from the same band, leaving a fair share for the other workers. They keep their reference on our deque
+        BoundedQueue<Task*>& band = *mLockFreeTasks[priority];
+        const size_t nbToClaim = std::min(mConfig.batchClaimSize, band.size() / nbWorkers + 1);
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        for(size_t claimIdx = 1; claimIdx < nbToClaim && band.tryPop(queued); ++claimIdx)
+        {
+            --mNbQueuedTasks[priority];
+            worker->onTaskDequeued(priority, now - queued->mQueuedTime);
+            mWorkerQueues[workerIdx]->push(queued);
+            ++mNbLocalTasks;
+            onTaskRemoved(mNbLockFreeTasks);
+        }
+        onTaskRemoved(mNbLockFreeTasks);
+        return true;
+    }
+
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    const size_t priority = selectPriority(now);
+    if(NB_PRIORITIES == priority)
+    {
+        return false;
+    }
+
+    std::queue<TaskHandle>& band = mTasks[priority];
+    task.swap(band.front());
+    band.pop();
+    --mNbQueuedTasks[priority];
+    onTaskDequeued(task.get(), priority, now, worker);
+
+    const size_t nbToClaim = std::min(mConfig.batchClaimSize, band.size() / nbWorkers + 1);
+    for(size_t claimIdx = 1; claimIdx < nbToClaim && !band.empty(); ++claimIdx)
+    {
+        worker->onTaskDequeued(priority, now - band.front()->mQueuedTime);
+        pushLocalTask(workerIdx, std::move(band.front()));
+        band.pop();
+        --mNbQueuedTasks[priority];
+    }
+    if(mNbBlockedProducers > 0)
+    {
+        mQueueSpaceSignal.notify_all();
+    }
+
+    if(mNbWaiting > 0 && !hasQueuedTasks())
+    {
+        mTasksRemovedSignal.notify_all();
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void Manager::cancelQueuedTasks()
+{
+    std::queue<TaskHandle> tasks[NB_PRIORITIES];
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        for(size_t priority = 0; priority < NB_PRIORITIES; ++priority)
+        {
+            std::swap(tasks[priority], mTasks[priority]);
+            if(QueueMode::LOCKED == mConfig.queue)
+            {
+                mNbQueuedTasks[priority] = 0;
+            }
+        }
+        mTasksRemovedSignal.notify_all();
+        mQueueSpaceSignal.notify_all();
+    }
+
+    for(size_t priority = 0; priority < NB_PRIORITIES; ++priority)
+    {
+        for(; !tasks[priority].empty(); tasks[priority].pop())
+        {
+            tasks[priority].front()->setCompletionStatus(false);
+        }
+    }
+
+    TaskHandle task;
+    while(QueueMode::LOCK_FREE == mConfig.queue && popQueuedTask(task, 0, false))
+    {
+        task->setCompletionStatus(false);
+        task.reset();
+    }
+
+    //deques are only safe to pop from their owner, which is gone once workers are shut down
+    if(0 == mNbWorkers)
+    {
+        for(size_t workerIdx = 0; workerIdx < mWorkerQueues.size(); ++workerIdx)
+        {
+            while(popLocalTask(workerIdx, task))
+            {
+                task->setCompletionStatus(false);
+                task.reset();
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void Manager::pushLocalTask(const size_t workerIdx, TaskHandle task)
+{
+    //the deque holds our reference now
+    mWorkerQueues[workerIdx]->push(task.release());
+    ++mNbLocalTasks;
+}
+
+//------------------------------------------------------------------------------
+bool Manager::popLocalTask(const size_t workerIdx, TaskHandle& task)
+{
+    Task* queued = 0;
+    if(!mWorkerQueues[workerIdx]->pop(queued))
+    {
+        return false;
+    }
+
+    task = TaskHandle::adopt(queued);
+    onTaskRemoved(mNbLocalTasks);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool Manager::stealTask(const size_t thiefIdx, TaskHandle& task)
+{
+    const size_t nbQueues = mWorkerQueues.size();
+    if(nbQueues < 2)
+    {
+        return false;
+    }
+
+    //start at a random victim so thieves spread out, xorshift is plenty for this
+    static thread_local unsigned int seed = 0;
+    if(0 == seed)
+    {
+        seed = static_cast<unsigned int>(thiefIdx) * 2654435761u + 1;
+    }
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+
+    //when workers are placed, try those on our own node before going remote
+    const size_t start = seed % nbQueues;
+    const int node = mWorkerNodes.empty() ? -1 : mWorkerNodes[thiefIdx];
+    for(size_t pass = (node < 0) ? 1 : 0; pass < 2; ++pass)
+    {
+        for(size_t offset = 0; offset < nbQueues; ++offset)
+        {
+            const size_t victimIdx = (start + offset) % nbQueues;
+            Task* queued = 0;
+            if(victimIdx != thiefIdx && (pass > 0 || mWorkerNodes[victimIdx] == node) && mWorkerQueues[victimIdx]->steal(queued))
+            {
+                task = TaskHandle::adopt(queued);
+                onTaskRemoved(mNbLocalTasks);
+
+                Worker* thief = mWorkers[thiefIdx];
+                if(0 != thief)
+                {
+                    thief->onSteal();
+                }
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------
+void Manager::onTaskRemoved(std::atomic<size_t>& nbTasks)
+{
+    if(0 == --nbTasks && mNbWaiting > 0)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mTasksRemovedSignal.notify_all();
     }
 }
 
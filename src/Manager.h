@@ -1,52 +1,583 @@
 #pragma once
 #include "Platform.h"
+#include "BoundedQueue.h"
+#include "CallableTask.h"
+#include "LatencyHistogram.h"
+#include "Task.h"
+#include "TimerWheel.h"
+#include "Topology.h"
+#include "Worker.h"
+#include "WorkStealingDeque.h"
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <functional>
 #include <memory>
 #include <queue>
 #include <thread>
+#include <vector>
 
 namespace workers {
 
-class Task;
-class Worker;
+//How queued tasks find their way to workers
+enum class SchedulingMode {
+    //every task goes through the manager's queue, handed out in the order they were run
+    FIFO,
+    //tasks run from inside a worker go to that worker's own deque, idle workers steal from other workers
+    WORK_STEALING
+};
+
+//Queue holding tasks run from outside the pool while no worker is available
+enum class QueueMode {
+    //unbounded queue guarded by the manager's mutex
+    LOCKED,
+    //lock free ring of queueCapacity tasks per band, full once a band's ring is
+    LOCK_FREE
+};
+
+//What run does with a task while the manager's queue is full. Tasks a worker keeps on its own deque are not limited
+enum class OverflowPolicy {
+    //the caller waits for room. A worker, or the timer thread, never waits on its own manager, it runs the task itself instead
+    BLOCK,
+    //the task is completed as failed and run returns false
+    REJECT,
+    //the calling thread runs the task itself
+    CALLER_RUNS,
+    //the oldest task of the lowest band holding any is completed as failed to make room
+    DROP_OLDEST
+};
+
+//How workers are pinned to processors
+enum class WorkerPlacement {
+    //left to the operating system, which may move them between nodes
+    NONE,
+    //each worker pinned to a single processor, workers spread evenly over the nodes
+    CORE,
+    //each worker pinned to every processor of one node, workers spread evenly over the nodes
+    NODE
+};
+
+//Settings used to construct a manager
+struct ManagerConfig {
+    inline ManagerConfig(const size_t nbWorkers = 1, const SchedulingMode scheduling = SchedulingMode::FIFO);
+
+    //how many workers are available, the fewest we keep when elastic
+    size_t nbWorkers;
+    SchedulingMode scheduling;
+    QueueMode queue;
+    //size of the lock free queue, rounded up to a power of 2
+    size_t queueCapacity;
+    //most tasks a worker takes from the queue at once, extras wait on its deque where others can steal them
+    size_t batchClaimSize;
+    //a priority band passed over for this long is served ahead of higher ones, so low priority work is never starved
+    std::chrono::milliseconds agingThreshold;
+    //most workers we grow to under load, making the pool elastic when above nbWorkers
+    size_t maxWorkers;
+    //a worker is added once this many tasks are queued with none available
+    size_t growQueueDepth;
+    //or once a task waited this long in the queue
+    std::chrono::milliseconds growWaitTime;
+    //workers above nbWorkers retire once idle for this long
+    std::chrono::milliseconds keepAlive;
+    WorkerPlacement placement;
+    //processors to place workers on, every one we may run on when empty
+    std::vector<int> cpus;
+    //how idle workers wait for tasks, sleeping straight away by default
+    WaitStrategy waitStrategy;
+    //most tasks waiting in the queue across every band, 0 for no limit other than the lock free ring's
+    size_t maxQueuedTasks;
+    OverflowPolicy overflowPolicy;
+};
+
+//Snapshot of a manager's queues and of what its workers have done
+struct ManagerStats {
+    inline ManagerStats();
+
+    //tasks waiting in each band of the queue
+    size_t nbQueuedTasks[NB_PRIORITIES];
+    //tasks waiting on workers' own deques
+    size_t nbLocalTasks;
+    size_t nbWorkers;
+    //workers waiting for a task
+    size_t nbIdleWorkers;
+    //how long tasks of each band waited in the queue, over every worker
+    LatencyHistogram queueWaitTimes[NB_PRIORITIES];
+    //tasks the caller ran itself because the queue was full, under the caller runs policy
+    uint64_t nbCallerRunTasks;
+    //how long tasks ran, over every worker and every caller running one itself
+    LatencyHistogram runTimes;
+    //workers running now, by id. What retired workers did is not kept
+    std::vector<WorkerStats> workers;
+};
+
+class Manager;
+
+//What the task resuming a coroutine on a worker runs. A task the manager drops without running, as when it shuts
+//down with the task still queued, resumes the coroutine as the callable is destroyed, so that it still finishes
+template<typename Handle>
+struct CoroutineResumer {
+    inline explicit CoroutineResumer(Handle coroutine);
+    inline CoroutineResumer(CoroutineResumer&& other);
+    inline ~CoroutineResumer();
+
+    inline void operator()();
+
+    Handle coroutine;
+    bool isPending;
+};
+
+//What co_await manager.schedule() suspends on, resuming the coroutine on one of the manager's workers.
+//The await functions are templates, so this builds as C++11 and is only usable from coroutine code, see Coroutine.h
+class ScheduleAwaitable {
+public:
+    inline ScheduleAwaitable(Manager& manager, const Priority priority);
+
+    inline bool await_ready() const;
+    //resumes the coroutine straight away on this thread if the manager would not take the task, or whichever
+    //thread drops it if the manager never runs it
+    template<typename Handle>
+    void await_suspend(Handle coroutine);
+    inline void await_resume() const;
+private:
+    Manager& mManager;
+    Priority mPriority;
+};
+
+//What co_await manager.whenComplete(task) suspends on, resuming the coroutine on one of the manager's workers once
+//the task completed, or carrying on straight away if it already has. Gives the task's completion status
+class CompletionAwaitable {
+public:
+    inline CompletionAwaitable(Manager& manager, TaskHandle task);
+
+    inline bool await_ready() const;
+    template<typename Handle>
+    void await_suspend(Handle coroutine);
+    inline bool await_resume() const;
+private:
+    Manager& mManager;
+    TaskHandle mTask;
+};
 
 class EXAMPLES_LIB_API Manager {
 public:
     //Constructor, saying how many workers are available
     Manager(const size_t nbWorkers);
+    //Constructor, using the given settings
+    Manager(const ManagerConfig& config);
     ~Manager();
 
-    //Run a task. Run on the next available worker, queued until worker available
-    void run(std::shared_ptr<Task> task);
+    //Run a task. Run on the next available worker, queued until worker available, higher priorities leaving the queue first.
+    //When workers are placed, a task handed straight to a worker goes to one on its node hint if any is available.
+    //A full queue is handled following the overflow policy. False if the task was rejected or we are shut down,
+    //in which case it is completed as failed, or if the task is null
+    bool run(TaskHandle task, const Priority priority = Priority::NORMAL);
+    bool run(std::shared_ptr<Task> task, const Priority priority = Priority::NORMAL);
+    //Same, but never waits and ignores the overflow policy: false straight away if the queue is full, leaving the task
+    //untouched for the caller to retry or run itself. Also false once shut down, completing the task as failed like run
+    bool tryRun(TaskHandle task, const Priority priority = Priority::NORMAL);
+    bool tryRun(std::shared_ptr<Task> task, const Priority priority = Priority::NORMAL);
+    //Run several tasks with a single trip through the queue, only waking as many workers as there are tasks.
+    //With maxQueuedTasks set, tasks go through run one by one so each gets the overflow policy. Null tasks are skipped
+    void runBatch(const TaskHandle* tasks, const size_t nbTasks, const Priority priority = Priority::NORMAL);
+    void runBatch(const std::shared_ptr<Task>* tasks, const size_t nbTasks, const Priority priority = Priority::NORMAL);
+    inline void runBatch(const std::vector<TaskHandle>& tasks, const Priority priority = Priority::NORMAL);
+    inline void runBatch(const std::vector< std::shared_ptr<Task> >& tasks, const Priority priority = Priority::NORMAL);
+    //Run a task, and once it completes run the continuation with its result. Returns the continuation's task for chaining
+    std::shared_ptr<Task> runThen(std::shared_ptr<Task> task, std::function<bool (bool)> continuation);
+    //Run any callable without writing a Task for it. Small callables are stored in a pooled task, so once
+    //the pool is warm nothing is allocated. Returns the task to wait on or continue from
+    template<typename F>
+    TaskHandle submit(F&& function, const Priority priority = Priority::NORMAL);
+    //Run a task once delay has passed, or once the given time is reached. Timers are kept by a single timer thread,
+    //started the first time one is used, in a timer wheel with millisecond ticks
+    TimerId runAfter(const std::chrono::steady_clock::duration delay, TaskHandle task, const Priority priority = Priority::NORMAL);
+    TimerId runAfter(const std::chrono::steady_clock::duration delay, std::shared_ptr<Task> task, const Priority priority = Priority::NORMAL);
+    TimerId runAt(const std::chrono::steady_clock::time_point time, TaskHandle task, const Priority priority = Priority::NORMAL);
+    TimerId runAt(const std::chrono::steady_clock::time_point time, std::shared_ptr<Task> task, const Priority priority = Priority::NORMAL);
+    //Run a function every period, starting a period from now, until the timer is cancelled or we shut down.
+    //Periods are rounded up to whole ticks, a zero or negative one runs it every tick
+    TimerId runEvery(const std::chrono::steady_clock::duration period, std::function<void (void)> function, const Priority priority = Priority::NORMAL);
+    //Stop a timer. A task it had not run yet is completed as failed. False if it already fired or was cancelled
+    bool cancelTimer(const TimerId timer);
     //Stop all workers, prevent tasks from being run
     void shutdown();
     //Wait for all tasks that are queued/running to complete
     void waitForTasksToComplete();
 
     inline const bool isShutdown();
+    //Workers currently running, between nbWorkers and maxWorkers when elastic
+    inline size_t getNbWorkers() const;
+    //Workers waiting for a task, a hint that splitting off more work would pay
+    inline size_t getNbIdleWorkers() const;
+    //Processors and nodes of the machine workers are placed on
+    inline const Topology& getTopology() const;
+    //How long tasks of a priority waited in our queue before a worker took them. Tasks handed straight
+    //to a worker count as no wait, tasks kept on a worker's own deque are not counted. Workers keep their own
+    //histograms, summed up here, so what retired workers recorded is not kept
+    LatencyHistogram getQueueWaitTimes(const Priority priority);
+    //Gather our gauges and every worker's counters. Workers keep their own counters, so this is the only place they are summed up
+    ManagerStats getStats();
+    //Awaitables for coroutines, which carry on on one of our workers without blocking any thread meanwhile.
+    //A coroutine still waiting on a task as we shut down is never resumed
+    inline ScheduleAwaitable schedule(const Priority priority = Priority::NORMAL);
+    inline CompletionAwaitable whenComplete(TaskHandle task);
 protected:
-    //Our set of workers
-    std::vector< Worker* > mWorkers;
+    //Create our workers and wait for them to be ready
+    void start();
+    //Called by a worker when it finishes a task, hands it another task or adds it to the available workers
+    void onWorkerAvailable(Worker* worker);
+    //Hand a task to an available worker, if there is one and a task can be found for it
+    inline void wakeAvailableWorker();
+    //Same for up to nbWorkers available workers
+    void wakeAvailableWorkers(size_t nbWorkers);
+    //Worker belonging to this manager that we are running on, 0 if not on one of our workers
+    Worker* getCurrentWorker();
+    //Decide which processors and node each worker id gets, following our placement
+    void placeWorkers(const size_t nbWorkers);
+    //Called on a worker's own thread as it starts, pins it and creates its deque so its memory is local
+    void onWorkerStart(Worker* worker);
+    //Take an available worker, preferring the most recently used one on node. mMutex must be held and a worker available
+    Worker* takeAvailableWorker(const int node);
+    //Add a worker if we can grow and tasks are piling up or waiting too long with none available
+    void growIfNeeded();
+    //Called periodically when elastic, retires workers idle for longer than keepAlive down to nbWorkers
+    void retireIdleWorkers();
+
+    //Run or queue a task, following the overflow policy once the queue is full unless isTry, where the task is left
+    //untouched and false returned instead
+    bool dispatchTask(TaskHandle& task, const Priority priority, const bool isTry);
+    //Complete the oldest task of the lowest band holding any as failed, making room in the queue
+    void dropOldestTask();
+    //Run a task on the calling thread as the queue is full, traced and counted like one run by a worker
+    void runOnCaller(TaskHandle& task);
+    //True once the locked queue holds maxQueuedTasks, mMutex must be held
+    inline const bool isQueueFull() const;
+    //Add a task to the lock free queue, false without taking the task if it is full
+    bool pushQueuedTask(TaskHandle& task, const size_t priority);
+    //Add a task to the locked queue, mMutex must be held
+    void queueTask(TaskHandle task, const size_t priority);
+    //Take the next task from the queue for a worker, which records how long it waited. If the queue is empty and
+    //makeAvailable is set, the worker is made available. Without a worker, as when cancelling, nothing is recorded
+    bool popQueuedTask(TaskHandle& task, Worker* worker, const bool makeAvailable);
+    //Take a task from the lock free queue for a worker, saying which band it came from
+    bool popLockFreeTask(Task*& task, size_t& priority, Worker* worker);
+    //Band to serve next, the highest non-empty one unless a lower one was passed over for too long. NB_PRIORITIES if all are empty
+    size_t selectPriority(const std::chrono::steady_clock::time_point now) const;
+    //Record with the worker taking it how long a task taken from a band waited, and that the band made progress
+    void onTaskDequeued(Task* task, const size_t priority, const std::chrono::steady_clock::time_point now, Worker* worker);
+    //Called on a worker's own thread, takes up to batchClaimSize tasks from the queue, keeping extras on its deque
+    bool claimQueuedTasks(Worker* worker, TaskHandle& task);
+    //Empty the queues, completing whatever was in them as failed
+    void cancelQueuedTasks();
+    //Deque operations for work stealing, indexed by worker id
+    void pushLocalTask(const size_t workerIdx, TaskHandle task);
+    bool popLocalTask(const size_t workerIdx, TaskHandle& task);
+    bool stealTask(const size_t thiefIdx, TaskHandle& task);
+    //Add a timer and wake the timer thread if it would sleep past it, starting the thread if needed
+    TimerId addTimer(const std::chrono::steady_clock::time_point time, const std::chrono::steady_clock::duration period, TaskHandle task,
+        std::function<void (void)> function, const Priority priority);
+    //Entry point of the timer thread, running timers as they expire
+    void runTimers();
+    //Stop the timer thread and fail whatever tasks were still waiting on a timer
+    void cancelTimers();
+    //Called after a task leaves a deque or the lock free queue, wakes anyone waiting once the count reaches 0
+    void onTaskRemoved(std::atomic<size_t>& nbTasks);
+    //True if a task is sitting in the lock free queue or a deque
+    inline const bool hasUnlockedTasks() const;
+    //True if a task is waiting in any band of the queue
+    inline const bool hasQueuedTasks() const;
+    //True if a task is waiting in a band above NORMAL, which goes ahead of a worker's own deque
+    inline const bool hasUrgentTasks() const;
+
+    ManagerConfig mConfig;
+
+    //Our set of workers, one slot per worker id up to maxWorkers. Slots are empty while their worker is retired
+    std::vector< std::atomic<Worker*> > mWorkers;
+    std::atomic<size_t> mNbWorkers;
+    //Guards adding and retiring workers, taken before mMutex. Growing only tries it, so it never waits on a retirement
+    std::mutex mWorkersMutex;
+    //Set when a task waited longer than growWaitTime, until a worker is added
+    std::atomic<bool> mIsQueueSlow;
+    Topology mTopology;
+    //Processors each worker id is pinned to and the node they belong to, empty when workers are not placed
+    std::vector< std::vector<int> > mWorkerCpus;
+    std::vector<int> mWorkerNodes;
+    //Deque for each worker, only used when work stealing or claiming batches. Each task in it holds a reference given up by its handle
+    std::vector< std::unique_ptr< WorkStealingDeque<Task*> > > mWorkerQueues;
 
     //Mutex for tasks and signalling
     std::mutex mMutex;
     std::condition_variable mTasksRemovedSignal;
+    //Producers waiting for room in the locked queue, signalled as tasks leave it
+    std::condition_variable mQueueSpaceSignal;
+    size_t mNbBlockedProducers;
+
+    //Queue for tasks, added to when workers not available, one per priority
+    std::queue<TaskHandle> mTasks[NB_PRIORITIES];
+    //Used instead of mTasks when the queue is lock free, holding references like the deques
+    std::unique_ptr< BoundedQueue<Task*> > mLockFreeTasks[NB_PRIORITIES];
+    //Tasks sitting in mLockFreeTasks, counted before they are pushed
+    std::atomic<size_t> mNbLockFreeTasks;
+    //Tasks waiting in each band of whichever queue we use
+    std::atomic<size_t> mNbQueuedTasks[NB_PRIORITIES];
+    //When each band last had a task taken from it or stopped being empty, in steady_clock ticks
+    std::atomic<std::chrono::steady_clock::rep> mPriorityServedTimes[NB_PRIORITIES];
+
+    //What a timer runs, a task once or a function every period
+    struct TimedTask {
+        TaskHandle task;
+        //shared so that a periodic timer hands out copies without copying the function
+        std::shared_ptr< std::function<void (void)> > function;
+        Priority priority;
+    };
 
-    //Queue for tasks, added to when workers not available
-    std::queue< std::shared_ptr<Task> > mTasks;
-    //Queue for workers that are waiting to receive a task
-    std::queue< Worker* > mAvailableWorkers;
+    //Guards the timer wheel and thread
+    std::mutex mTimerMutex;
+    std::condition_variable mTimerSignal;
+    TimerWheel<TimedTask> mTimers;
+    std::unique_ptr<std::thread> mTimerThread;
+    //Time of tick 0
+    std::chrono::steady_clock::time_point mTimerEpoch;
+    //Tick the timer thread sleeps until, adding an earlier timer wakes it
+    uint64_t mTimerWakeTick;
+    //Workers that are waiting to receive a task, most recently used last so its cache is still warm.
+    //Reserved up front, so workers coming and going never allocates
+    std::vector< Worker* > mAvailableWorkers;
+    //When each worker was last made available, by worker id. The front of mAvailableWorkers has been idle longest
+    std::vector< std::chrono::steady_clock::time_point > mIdleTimes;
+    //Size of mAvailableWorkers, readable without the mutex
+    std::atomic<size_t> mNbAvailableWorkers;
+    //Tasks sitting in worker deques
+    std::atomic<size_t> mNbLocalTasks;
+    //Tasks callers ran themselves, and how long they took. Only touched once the queue overflows
+    std::atomic<uint64_t> mNbCallerRunTasks;
+    LatencyHistogram mCallerRunTimes;
+    //Threads inside waitForTasksToComplete
+    std::atomic<size_t> mNbWaiting;
 
     std::atomic<bool> mShutdown;
 };
 
 //inline implementations
+//------------------------------------------------------------------------------
+ManagerConfig::ManagerConfig(const size_t nbWorkers, const SchedulingMode scheduling) : nbWorkers(nbWorkers), scheduling(scheduling), queue(QueueMode::LOCKED), queueCapacity(1024), batchClaimSize(1), agingThreshold(100),
+    maxWorkers(0), growQueueDepth(4), growWaitTime(10), keepAlive(10000), placement(WorkerPlacement::NONE),
+    maxQueuedTasks(0), overflowPolicy(OverflowPolicy::BLOCK)
+{
+
+}
+
+//------------------------------------------------------------------------------
+ManagerStats::ManagerStats() : nbLocalTasks(0), nbWorkers(0), nbIdleWorkers(0), nbCallerRunTasks(0)
+{
+    for(size_t priority = 0; priority < NB_PRIORITIES; ++priority)
+    {
+        nbQueuedTasks[priority] = 0;
+    }
+}
+
 //------------------------------------------------------------------------------
 const bool Manager::isShutdown()
 {
     return mShutdown;
 }
 
-}
\ No newline at end of file
+//------------------------------------------------------------------------------
+size_t Manager::getNbWorkers() const
+{
+    return mNbWorkers;
+}
+
+//------------------------------------------------------------------------------
+size_t Manager::getNbIdleWorkers() const
+{
+    return mNbAvailableWorkers;
+}
+
+//------------------------------------------------------------------------------
+const Topology& Manager::getTopology() const
+{
+    return mTopology;
+}
+
+//------------------------------------------------------------------------------
+void Manager::runBatch(const std::vector<TaskHandle>& tasks, const Priority priority)
+{
+    if(!tasks.empty())
+    {
+        runBatch(&tasks[0], tasks.size(), priority);
+    }
+}
+
+//------------------------------------------------------------------------------
+void Manager::runBatch(const std::vector< std::shared_ptr<Task> >& tasks, const Priority priority)
+{
+    if(!tasks.empty())
+    {
+        runBatch(&tasks[0], tasks.size(), priority);
+    }
+}
+
+//------------------------------------------------------------------------------
+ScheduleAwaitable Manager::schedule(const Priority priority)
+{
+    return ScheduleAwaitable(*this, priority);
+}
+
+//------------------------------------------------------------------------------
+CompletionAwaitable Manager::whenComplete(TaskHandle task)
+{
+    return CompletionAwaitable(*this, std::move(task));
+}
+
+//------------------------------------------------------------------------------
+template<typename F>
+TaskHandle Manager::submit(F&& function, const Priority priority)
+{
+    TaskHandle task = CallableTask::create(std::forward<F>(function));
+    run(task, priority);
+    return task;
+}
+
+//------------------------------------------------------------------------------
+void Manager::wakeAvailableWorker()
+{
+    wakeAvailableWorkers(1);
+}
+
+//------------------------------------------------------------------------------
+const bool Manager::hasUnlockedTasks() const
+{
+    return mNbLockFreeTasks > 0 || mNbLocalTasks > 0;
+}
+
+//------------------------------------------------------------------------------
+const bool Manager::hasQueuedTasks() const
+{
+    for(size_t priority = 0; priority < NB_PRIORITIES; ++priority)
+    {
+        if(mNbQueuedTasks[priority] > 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------
+const bool Manager::isQueueFull() const
+{
+    if(0 == mConfig.maxQueuedTasks)
+    {
+        return false;
+    }
+
+    size_t nbQueued = 0;
+    for(size_t priority = 0; priority < NB_PRIORITIES; ++priority)
+    {
+        nbQueued += mNbQueuedTasks[priority];
+    }
+    return nbQueued >= mConfig.maxQueuedTasks;
+}
+
+//------------------------------------------------------------------------------
+const bool Manager::hasUrgentTasks() const
+{
+    for(size_t priority = 0; priority < static_cast<size_t>(Priority::NORMAL); ++priority)
+    {
+        if(mNbQueuedTasks[priority] > 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------
+template<typename Handle>
+CoroutineResumer<Handle>::CoroutineResumer(Handle coroutine) : coroutine(coroutine), isPending(true)
+{
+
+}
+
+//------------------------------------------------------------------------------
+template<typename Handle>
+CoroutineResumer<Handle>::CoroutineResumer(CoroutineResumer&& other) : coroutine(other.coroutine), isPending(other.isPending)
+{
+    other.isPending = false;
+}
+
+//------------------------------------------------------------------------------
+template<typename Handle>
+CoroutineResumer<Handle>::~CoroutineResumer()
+{
+    if(isPending)
+    {
+        coroutine.resume();
+    }
+}
+
+//------------------------------------------------------------------------------
+template<typename Handle>
+void CoroutineResumer<Handle>::operator()()
+{
+    isPending = false;
+    coroutine.resume();
+}
+
+//------------------------------------------------------------------------------
+ScheduleAwaitable::ScheduleAwaitable(Manager& manager, const Priority priority) : mManager(manager), mPriority(priority)
+{
+
+}
+
+//------------------------------------------------------------------------------
+bool ScheduleAwaitable::await_ready() const
+{
+    return false;
+}
+
+//------------------------------------------------------------------------------
+template<typename Handle>
+void ScheduleAwaitable::await_suspend(Handle coroutine)
+{
+    //the coroutine may be resumed, and this awaitable gone with its frame, before run returns. Returning whether to
+    //suspend would have the frame read once more after that, so a rejected task resumes the coroutine as it is dropped
+    mManager.run(CallableTask::create(CoroutineResumer<Handle>(coroutine)), mPriority);
+}
+
+//------------------------------------------------------------------------------
+void ScheduleAwaitable::await_resume() const
+{
+
+}
+
+//------------------------------------------------------------------------------
+CompletionAwaitable::CompletionAwaitable(Manager& manager, TaskHandle task) : mManager(manager), mTask(std::move(task))
+{
+
+}
+
+//------------------------------------------------------------------------------
+bool CompletionAwaitable::await_ready() const
+{
+    return mTask->isComplete();
+}
+
+//------------------------------------------------------------------------------
+template<typename Handle>
+void CompletionAwaitable::await_suspend(Handle coroutine)
+{
+    //same here, keep the task alive ourselves while then may already be resuming the coroutine
+    TaskHandle task = mTask;
+    task->then(mManager, CallableTask::create(CoroutineResumer<Handle>(coroutine)));
+}
+
+//------------------------------------------------------------------------------
+bool CompletionAwaitable::await_resume() const
+{
+    return mTask->getCompletionStatus();
+}
+
+}
@@ -0,0 +1,142 @@
+#include "Parallel.h"
+#include "AtomicWait.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace workers {
+
+//Shared by everyone working on one parallel_for. Helper tasks that start late still hold it, but find nothing to claim
+struct ParallelForState {
+    Manager* manager;
+    const std::function<void (size_t, size_t)>* body;
+    size_t grainSize;
+    bool isStatic;
+    //ranges handed off that nobody has claimed yet
+    std::mutex mutex;
+    std::vector< std::pair<size_t, size_t> > ranges;
+    //ranges handed off or being worked through that are not finished, the caller sleeps on it
+    std::atomic<int> nbUnfinished;
+};
+
+static void runHelper(const std::shared_ptr<ParallelForState>& state);
+
+//------------------------------------------------------------------------------
+static bool claimRange(ParallelForState& state, std::pair<size_t, size_t>& range)
+{
+    std::unique_lock<std::mutex> lock(state.mutex);
+    if(state.ranges.empty())
+    {
+        return false;
+    }
+    range = state.ranges.back();
+    state.ranges.pop_back();
+    return true;
+}
+
+//------------------------------------------------------------------------------
+static void offerRange(const std::shared_ptr<ParallelForState>& state, const size_t begin, const size_t end)
+{
+    ++state->nbUnfinished;
+    {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->ranges.push_back(std::make_pair(begin, end));
+    }
+
+    std::shared_ptr<ParallelForState> helperState = state;
+    state->manager->submit([helperState]() { runHelper(helperState); });
+}
+
+//------------------------------------------------------------------------------
+static void finishRange(ParallelForState& state)
+{
+    if(1 == state.nbUnfinished.fetch_sub(1))
+    {
+        atomicNotifyAll(state.nbUnfinished);
+    }
+}
+
+//------------------------------------------------------------------------------
+static void processRange(const std::shared_ptr<ParallelForState>& state, size_t begin, size_t end)
+{
+    const std::function<void (size_t, size_t)>& body = *state->body;
+
+    if(!state->isStatic)
+    {
+        const size_t grainSize = state->grainSize;
+        while(end - begin > grainSize)
+        {
+            if(state->manager->getNbIdleWorkers() > 0 && end - begin >= 2 * grainSize)
+            {
+                //someone is idle, give them the back half of what we have left
+                const size_t middle = begin + (end - begin) / 2;
+                offerRange(state, middle, end);
+                end = middle;
+                continue;
+            }
+
+            //work in pieces small enough that most of the range stays available to split off
+            const size_t piece = std::max(grainSize, (end - begin) / 64);
+            body(begin, begin + piece);
+            begin += piece;
+        }
+    }
+
+    if(begin < end)
+    {
+        body(begin, end);
+    }
+    finishRange(*state);
+}
+
+//------------------------------------------------------------------------------
+static void runHelper(const std::shared_ptr<ParallelForState>& state)
+{
+    std::pair<size_t, size_t> range;
+    while(claimRange(*state, range))
+    {
+        processRange(state, range.first, range.second);
+    }
+}
+
+//------------------------------------------------------------------------------
+void parallelForRanges(Manager& manager, const size_t count, const std::function<void (size_t, size_t)>& body, const size_t grainSize, const bool isStatic)
+{
+    if(0 == count)
+    {
+        return;
+    }
+
+    std::shared_ptr<ParallelForState> state = std::make_shared<ParallelForState>();
+    state->manager = &manager;
+    state->body = &body;
+    state->grainSize = std::max<size_t>(grainSize, 1);
+    state->isStatic = isStatic;
+    state->nbUnfinished = 1;
+
+    size_t end = count;
+    if(isStatic)
+    {
+        //we keep the first chunk, the others go to the workers
+        const size_t nbChunks = std::min(count, manager.getNbWorkers() + 1);
+        for(size_t chunkIdx = nbChunks - 1; chunkIdx > 0; --chunkIdx)
+        {
+            offerRange(state, count * chunkIdx / nbChunks, end);
+            end = count * chunkIdx / nbChunks;
+        }
+    }
+    processRange(state, 0, end);
+
+    //help with whatever was handed off but not picked up yet, then wait for the rest
+    runHelper(state);
+    for(int nbUnfinished = state->nbUnfinished; 0 != nbUnfinished; nbUnfinished = state->nbUnfinished)
+    {
+        atomicWait(state->nbUnfinished, nbUnfinished);
+    }
+}
+
+}
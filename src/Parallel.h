@@ -0,0 +1,133 @@
+#pragma once
+#include "Platform.h"
+#include "Manager.h"
+#include "Combinable.h"
+
+#include <cstddef>
+#include <functional>
+#include <utility>
+
+namespace workers {
+
+//Splits a parallel_for range up front into equal chunks, one per worker plus one for the calling thread.
+//Cheapest when every index costs about the same
+class EXAMPLES_LIB_API static_partitioner {
+};
+
+//Splits a parallel_for range lazily: whoever is working through a range hands half of what is left to another
+//worker, but only while some are idle, so uneven work still balances out. Never splits below grainSize indices
+class EXAMPLES_LIB_API auto_partitioner {
+public:
+    inline explicit auto_partitioner(const size_t grainSize = 1);
+
+    size_t grainSize;
+};
+
+//Call body(index) for every index in [first, last) on the manager's workers, returning once all calls are done.
+//The calling thread does its share, so this may be called from a task as well. body must not throw
+template<typename Index, typename Function>
+void parallel_for(Manager& manager, const Index first, const Index last, const Function& body, const auto_partitioner& partitioner = auto_partitioner());
+template<typename Index, typename Function>
+void parallel_for(Manager& manager, const Index first, const Index last, const Function& body, const static_partitioner& partitioner);
+
+//Reduce [first, last) on the manager's workers. Each sub range folds its indices into a copy of identity with
+//reduce(Value, Index) -> Value, then sub range results are merged with combine(Value, Value) -> Value. Results are
+//accumulated per thread in a combinable and merged once at the end, so workers never share an accumulator.
+//combine may be applied in any order, so it must be associative and commutative. identity for an empty range
+template<typename Index, typename Value, typename Reduce, typename Combine>
+Value parallel_reduce(Manager& manager, const Index first, const Index last, const Value& identity, const Reduce& reduce,
+    const Combine& combine, const auto_partitioner& partitioner = auto_partitioner());
+template<typename Index, typename Value, typename Reduce, typename Combine>
+Value parallel_reduce(Manager& manager, const Index first, const Index last, const Value& identity, const Reduce& reduce,
+    const Combine& combine, const static_partitioner& partitioner);
+
+//Call body(begin, end) on sub ranges covering [0, count) exactly once, the untyped core of parallel_for.
+//Static splits into a chunk per worker, otherwise ranges are split lazily down to grainSize
+EXAMPLES_LIB_API void parallelForRanges(Manager& manager, const size_t count, const std::function<void (size_t, size_t)>& body,
+    const size_t grainSize, const bool isStatic);
+//Both parallel_reduce go through this
+template<typename Index, typename Value, typename Reduce, typename Combine>
+Value parallelReduce(Manager& manager, const Index first, const Index last, const Value& identity, const Reduce& reduce,
+    const Combine& combine, const size_t grainSize, const bool isStatic);
+
+//inline implementations
+//------------------------------------------------------------------------------
+auto_partitioner::auto_partitioner(const size_t grainSize) : grainSize(grainSize > 0 ? grainSize : 1)
+{
+
+}
+
+//template implementations
+//------------------------------------------------------------------------------
+template<typename Index, typename Function>
+void parallel_for(Manager& manager, const Index first, const Index last, const Function& body, const auto_partitioner& partitioner)
+{
+    if(first < last)
+    {
+        parallelForRanges(manager, static_cast<size_t>(last - first), [first, &body](const size_t begin, const size_t end) {
+            for(size_t offset = begin; offset < end; ++offset)
+            {
+                body(static_cast<Index>(first + static_cast<Index>(offset)));
+            }
+        }, partitioner.grainSize, false);
+    }
+}
+
+//------------------------------------------------------------------------------
+template<typename Index, typename Function>
+void parallel_for(Manager& manager, const Index first, const Index last, const Function& body, const static_partitioner& partitioner)
+{
+    if(first < last)
+    {
+        parallelForRanges(manager, static_cast<size_t>(last - first), [first, &body](const size_t begin, const size_t end) {
+            for(size_t offset = begin; offset < end; ++offset)
+            {
+                body(static_cast<Index>(first + static_cast<Index>(offset)));
+            }
+        }, 1, true);
+    }
+}
+
+//------------------------------------------------------------------------------
+template<typename Index, typename Value, typename Reduce, typename Combine>
+Value parallel_reduce(Manager& manager, const Index first, const Index last, const Value& identity, const Reduce& reduce,
+    const Combine& combine, const auto_partitioner& partitioner)
+{
+    return parallelReduce(manager, first, last, identity, reduce, combine, partitioner.grainSize, false);
+}
+
+//------------------------------------------------------------------------------
+template<typename Index, typename Value, typename Reduce, typename Combine>
+Value parallel_reduce(Manager& manager, const Index first, const Index last, const Value& identity, const Reduce& reduce,
+    const Combine& combine, const static_partitioner& partitioner)
+{
+    return parallelReduce(manager, first, last, identity, reduce, combine, 1, true);
+}
+
+//------------------------------------------------------------------------------
+template<typename Index, typename Value, typename Reduce, typename Combine>
+Value parallelReduce(Manager& manager, const Index first, const Index last, const Value& identity, const Reduce& reduce,
+    const Combine& combine, const size_t grainSize, const bool isStatic)
+{
+    if(!(first < last))
+    {
+        return identity;
+    }
+
+    combinable<Value> accumulators([&identity]() { return identity; });
+    parallelForRanges(manager, static_cast<size_t>(last - first), [first, &identity, &reduce, &combine, &accumulators](const size_t begin, const size_t end) {
+        Value value = identity;
+        for(size_t offset = begin; offset < end; ++offset)
+        {
+            value = reduce(std::move(value), static_cast<Index>(first + static_cast<Index>(offset)));
+        }
+
+        Value& accumulator = accumulators.local();
+        accumulator = combine(std::move(accumulator), value);
+    }, grainSize, isStatic);
+
+    //parallelForRanges only returns once every sub range is done, so every accumulator can be read
+    return accumulators.combine(combine);
+}
+
+}
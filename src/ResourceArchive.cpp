@@ -0,0 +1,382 @@
+#include "ResourceArchive.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#if defined(WINDOWS)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//"WPAK" read as a number
+static const uint32_t ARCHIVE_MAGIC = 0x4B415057;
+//what pack copies at once
+static const size_t COPY_CHUNK_SIZE = 64 * 1024;
+
+struct ResourceArchive::Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t nbEntries;
+    uint32_t alignment;
+    uint64_t namesOffset;
+    uint64_t namesSize;
+};
+
+//Where a resource is, the index holding one per resource right after the header
+struct ResourceArchive::Entry {
+    uint64_t hash;
+    uint64_t offset;
+    uint64_t size;
+    uint32_t nameOffset;
+    uint32_t nameSize;
+};
+
+//An entry being packed, with where its bytes come from
+struct PackedEntry {
+    uint64_t hash;
+    std::string name;
+    std::string file;
+    uint64_t size;
+};
+
+//------------------------------------------------------------------------------
+static bool isPackedBefore(const PackedEntry& first, const PackedEntry& second)
+{
+    return (first.hash != second.hash) ? first.hash < second.hash : first.name < second.name;
+}
+
+//------------------------------------------------------------------------------
+static uint64_t alignOffset(const uint64_t offset, const size_t alignment)
+{
+    return (offset + alignment - 1) & ~static_cast<uint64_t>(alignment - 1);
+}
+
+//------------------------------------------------------------------------------
+static void writePadding(std::ofstream& archive, const uint64_t size)
+{
+    static const char ZEROS[ResourceArchive::DEFAULT_ALIGNMENT] = {};
+    for(uint64_t written = 0; written < size; written += sizeof(ZEROS))
+    {
+        archive.write(ZEROS, static_cast<std::streamsize>(std::min(static_cast<uint64_t>(sizeof(ZEROS)), size - written)));
+    }
+}
+
+//------------------------------------------------------------------------------
+ResourceArchive::ResourceArchive() : mData(0), mSize(0), mFile(0), mMapping(0), mEntries(0), mNbEntries(0), mNames(0)
+{
+
+}
+
+//------------------------------------------------------------------------------
+ResourceArchive::~ResourceArchive()
+{
+#if defined(WINDOWS)
+    if(0 != mData)
+    {
+        UnmapViewOfFile(mData);
+    }
+    if(0 != mMapping)
+    {
+        CloseHandle(mMapping);
+    }
+    if(0 != mFile)
+    {
+        CloseHandle(mFile);
+    }
+#else
+    if(0 != mData)
+    {
+        munmap(const_cast<char*>(mData), mSize);
+    }
+#endif
+}
+
+//------------------------------------------------------------------------------
+bool ResourceArchive::pack(const std::string& path, const std::vector<std::string>& names, const std::vector<std::string>& files, const size_t alignment)
+{
+    if(names.size() != files.size() || 0 == alignment || 0 != (alignment & (alignment - 1)))
+    {
+        return false;
+    }
+
+    //sizes first, so the whole layout is known before writing
+    std::vector<PackedEntry> entries;
+    uint64_t namesSize = 0;
+    for(size_t entryIdx = 0; entryIdx < names.size(); ++entryIdx)
+    {
+        std::ifstream file(files[entryIdx].c_str(), std::ios::binary | std::ios::ate);
+        if(!file)
+        {
+            return false;
+        }
+
+        PackedEntry entry;
+        entry.hash = hashName(names[entryIdx]);
+        entry.name = names[entryIdx];
+        entry.file = files[entryIdx];
+        entry.size = static_cast<uint64_t>(file.tellg());
+        entries.push_back(entry);
+        namesSize += entry.name.size();
+    }
+    std::sort(entries.begin(), entries.end(), isPackedBefore);
+    for(size_t entryIdx = 1; entryIdx < entries.size(); ++entryIdx)
+    {
+        if(entries[entryIdx].name == entries[entryIdx - 1].name)
+        {
+            return false;
+        }
+    }
+
+    Header header;
+    header.magic = ARCHIVE_MAGIC;
+    header.version = VERSION;
+    header.nbEntries = static_cast<uint32_t>(entries.size());
+    header.alignment = static_cast<uint32_t>(alignment);
+    header.namesOffset = sizeof(Header) + entries.size() * sizeof(Entry);
+    header.namesSize = namesSize;
+
+    std::vector<Entry> index;
+    uint64_t offset = alignOffset(header.namesOffset + namesSize, alignment);
+    uint32_t nameOffset = 0;
+    for(std::vector<PackedEntry>::const_iterator packed = entries.begin(); packed != entries.end(); ++packed)
+    {
+        Entry entry;
+        entry.hash = packed->hash;
+        entry.offset = offset;
+        entry.size = packed->size;
+        entry.nameOffset = nameOffset;
+        entry.nameSize = static_cast<uint32_t>(packed->name.size());
+        index.push_back(entry);
+
+        offset = alignOffset(offset + packed->size, alignment);
+        nameOffset += entry.nameSize;
+    }
+
+    //a process mapping the archive we replace would see it change under its views if we wrote over it
+    const std::string packingPath = path + ".packing";
+    {
+        std::ofstream archive(packingPath.c_str(), std::ios::binary | std::ios::trunc);
+        archive.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        if(!index.empty())
+        {
+            archive.write(reinterpret_cast<const char*>(&index[0]), static_cast<std::streamsize>(index.size() * sizeof(Entry)));
+        }
+        for(std::vector<PackedEntry>::const_iterator packed = entries.begin(); packed != entries.end(); ++packed)
+        {
+            archive.write(packed->name.data(), static_cast<std::streamsize>(packed->name.size()));
+        }
+
+        uint64_t written = header.namesOffset + namesSize;
+        std::vector<char> chunk(COPY_CHUNK_SIZE);
+        for(size_t entryIdx = 0; entryIdx < entries.size() && archive; ++entryIdx)
+        {
+            writePadding(archive, index[entryIdx].offset - written);
+
+            std::ifstream file(entries[entryIdx].file.c_str(), std::ios::binary);
+            uint64_t copied = 0;
+            while(file && copied < entries[entryIdx].size)
+            {
+                file.read(&chunk[0], static_cast<std::streamsize>(std::min(static_cast<uint64_t>(chunk.size()), entries[entryIdx].size - copied)));
+                archive.write(&chunk[0], file.gcount());
+                copied += static_cast<uint64_t>(file.gcount());
+            }
+            if(copied != entries[entryIdx].size)
+            {
+                //changed since we took its size
+                archive.setstate(std::ios::failbit);
+            }
+            written = index[entryIdx].offset + copied;
+        }
+
+        archive.close();
+        if(!archive)
+        {
+            std::remove(packingPath.c_str());
+            return false;
+        }
+    }
+
+#if defined(WINDOWS)
+    //renaming over an existing file fails here, and a mapped one cannot be replaced anyway
+    std::remove(path.c_str());
+#endif
+    if(0 != std::rename(packingPath.c_str(), path.c_str()))
+    {
+        std::remove(packingPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+std::shared_ptr<ResourceArchive> ResourceArchive::open(const std::string& path)
+{
+    std::shared_ptr<ResourceArchive> archive(new ResourceArchive());
+    if(!archive->map(path) || !archive->validate())
+    {
+        return std::shared_ptr<ResourceArchive>();
+    }
+    return archive;
+}
+
+//------------------------------------------------------------------------------
+bool ResourceArchive::find(const std::string& name, const char*& data, size_t& size) const
+{
+    const uint64_t hash = hashName(name);
+
+    //entries of the same hash are next to each other, sorted by name
+    size_t first = 0;
+    size_t last = mNbEntries;
+    while(first < last)
+    {
+        const size_t middle = first + (last - first) / 2;
+        if(mEntries[middle].hash < hash)
+        {
+            first = middle + 1;
+        }
+        else
+        {
+            last = middle;
+        }
+    }
+
+    for(size_t entryIdx = first; entryIdx < mNbEntries && hash == mEntries[entryIdx].hash; ++entryIdx)
+    {
+        const Entry& entry = mEntries[entryIdx];
+        if(name.size() == entry.nameSize && 0 == memcmp(name.data(), mNames + entry.nameOffset, entry.nameSize))
+        {
+            data = mData + entry.offset;
+            size = static_cast<size_t>(entry.size);
+            return true;
+        }
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------
+size_t ResourceArchive::getNbEntries() const
+{
+    return mNbEntries;
+}
+
+//------------------------------------------------------------------------------
+std::string ResourceArchive::getName(const size_t entryIdx) const
+{
+    return std::string(mNames + mEntries[entryIdx].nameOffset, mEntries[entryIdx].nameSize);
+}
+
+//------------------------------------------------------------------------------
+const char* ResourceArchive::getData(const size_t entryIdx) const
+{
+    return mData + mEntries[entryIdx].offset;
+}
+
+//------------------------------------------------------------------------------
+size_t ResourceArchive::getSize(const size_t entryIdx) const
+{
+    return static_cast<size_t>(mEntries[entryIdx].size);
+}
+
+//------------------------------------------------------------------------------
+uint64_t ResourceArchive::hashName(const std::string& name)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for(std::string::const_iterator character = name.begin(); character != name.end(); ++character)
+    {
+        hash ^= static_cast<unsigned char>(*character);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+//------------------------------------------------------------------------------
+bool ResourceArchive::map(const std::string& path)
+{
+#if defined(WINDOWS)
+    mFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if(INVALID_HANDLE_VALUE == mFile)
+    {
+        mFile = 0;
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if(!GetFileSizeEx(mFile, &fileSize) || fileSize.QuadPart < static_cast<LONGLONG>(sizeof(Header)))
+    {
+        return false;
+    }
+    mSize = static_cast<size_t>(fileSize.QuadPart);
+
+    mMapping = CreateFileMappingA(mFile, 0, PAGE_READONLY, 0, 0, 0);
+    if(0 == mMapping)
+    {
+        return false;
+    }
+    mData = static_cast<const char*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+    return 0 != mData;
+#else
+    const int file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(file < 0)
+    {
+        return false;
+    }
+
+    struct stat status;
+    if(0 != fstat(file, &status) || status.st_size < static_cast<off_t>(sizeof(Header)))
+    {
+        close(file);
+        return false;
+    }
+    mSize = static_cast<size_t>(status.st_size);
+
+    //shared, so the pages are the page cache's own, the mapping keeps the file alive once closed
+    void* data = mmap(0, mSize, PROT_READ, MAP_SHARED, file, 0);
+    close(file);
+    if(MAP_FAILED == data)
+    {
+        return false;
+    }
+    mData = static_cast<const char*>(data);
+    return true;
+#endif
+}
+
+//------------------------------------------------------------------------------
+bool ResourceArchive::validate()
+{
+    const Header& header = *reinterpret_cast<const Header*>(mData);
+    if(ARCHIVE_MAGIC != header.magic || VERSION != header.version)
+    {
+        return false;
+    }
+
+    const uint64_t indexSize = static_cast<uint64_t>(header.nbEntries) * sizeof(Entry);
+    if(indexSize > mSize - sizeof(Header) || header.namesOffset != sizeof(Header) + indexSize ||
+        header.namesSize > mSize - header.namesOffset)
+    {
+        return false;
+    }
+
+    mEntries = reinterpret_cast<const Entry*>(mData + sizeof(Header));
+    mNbEntries = header.nbEntries;
+    mNames = mData + header.namesOffset;
+
+    for(size_t entryIdx = 0; entryIdx < mNbEntries; ++entryIdx)
+    {
+        const Entry& entry = mEntries[entryIdx];
+        if(entry.offset > mSize || entry.size > mSize - entry.offset ||
+            entry.nameOffset > header.namesSize || entry.nameSize > header.namesSize - entry.nameOffset ||
+            (entryIdx > 0 && entry.hash < mEntries[entryIdx - 1].hash))
+        {
+            return false;
+        }
+    }
+    return true;
+}
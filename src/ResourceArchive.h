@@ -0,0 +1,60 @@
+#pragma once
+#include "Platform.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+//Resources packed offline into a single file: a header, an index of name hashes sorted for binary search, the
+//names, then the bytes of every resource, each starting aligned. Opening maps the whole file read only and shared,
+//so resources are views straight into the mapping: nothing is read until touched, and every process mapping the
+//same archive shares one copy through the page cache. Numbers are in the byte order of the machine that packed it,
+//an archive only opens on machines of the same order
+class EXAMPLES_LIB_API ResourceArchive {
+public:
+    static const uint32_t VERSION = 1;
+    //resources start on multiples of this, enough for any type and for vector loads
+    static const size_t DEFAULT_ALIGNMENT = 64;
+
+    //Pack files into an archive, each under the name at the same position, the alignment being a power of 2.
+    //The archive is written aside and renamed over the path, so processes mapping the old one keep valid views.
+    //False if a file could not be read, a name is used twice or the archive could not be written
+    static bool pack(const std::string& path, const std::vector<std::string>& names, const std::vector<std::string>& files, const size_t alignment = DEFAULT_ALIGNMENT);
+    //Map an archive, null if it cannot be opened or is not a valid archive
+    static std::shared_ptr<ResourceArchive> open(const std::string& path);
+    //Unmaps, invalidating every view into the archive
+    ~ResourceArchive();
+
+    //Find a resource, false if none has that name. The data stays valid as long as the archive
+    bool find(const std::string& name, const char*& data, size_t& size) const;
+    size_t getNbEntries() const;
+    std::string getName(const size_t entryIdx) const;
+    const char* getData(const size_t entryIdx) const;
+    size_t getSize(const size_t entryIdx) const;
+
+    //what the index is sorted by, FNV-1a
+    static uint64_t hashName(const std::string& name);
+private:
+    ResourceArchive();
+    ResourceArchive(const ResourceArchive&);
+    ResourceArchive& operator=(const ResourceArchive&);
+
+    struct Header;
+    struct Entry;
+
+    bool map(const std::string& path);
+    //check that everything the header and index say fits in the file, so that no lookup reads past the mapping
+    bool validate();
+
+    const char* mData;
+    size_t mSize;
+    //windows only, the file and mapping handles
+    void* mFile;
+    void* mMapping;
+
+    const Entry* mEntries;
+    size_t mNbEntries;
+    const char* mNames;
+};
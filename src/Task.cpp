@@ -1,9 +1,14 @@
 #include "Task.h"
+#include "AtomicWait.h"
+#include "ContinuationTask.h"
+#include "Manager.h"
+
+#include <thread>
 
 namespace workers {
 
 //------------------------------------------------------------------------------
-Task::Task()
+Task::Task() : mState(PENDING), mContinuations(0), mNbReferences(0), mIsShared(false), mSharedOwnerLocked(false), mNodeHint(-1)
 {
 
 }
@@ -11,24 +16,230 @@ Task::Task()
 //------------------------------------------------------------------------------
 Task::~Task()
 {
-    try
+    //fails the task if it was never completed by perform
+    complete(false);
+}
+
+//------------------------------------------------------------------------------
+bool Task::waitForCompletion()
+{
+    int state = mState.load(std::memory_order_acquire);
+
+    while(0 == (state & COMPLETE_MASK))
     {
-        setCompletionStatus(false);
+        //tell whoever completes us that someone is asleep, then sleep until the state changes
+        if(0 == (state & HAS_WAITERS) && !mState.compare_exchange_weak(state, state | HAS_WAITERS, std::memory_order_acquire))
+        {
+            continue;
+        }
+        atomicWait(mState, state | HAS_WAITERS);
+        state = mState.load(std::memory_order_acquire);
     }
-    catch(std::future_error&)
+    return SUCCEEDED == (state & COMPLETE_MASK);
+}
+
+//------------------------------------------------------------------------------
+std::future<bool> Task::getCompletionFuture()
+{
+    Continuation* continuation = new Continuation();
+    continuation->manager = 0;
+    continuation->promise.reset(new std::promise<bool>());
+    std::future<bool> future = continuation->promise->get_future();
+
+    if(!pushContinuation(continuation))
     {
-        //task was already completed by perform
+        continuation->promise->set_value(getCompletionStatus());
+        delete continuation;
     }
+    return future;
 }
 
 //------------------------------------------------------------------------------
 void Task::setCompletionStatus(const bool status)
 {
-    mTaskCompletePromise.set_value(status);
+    if(!complete(status))
+    {
+        throw std::future_error(std::future_errc::promise_already_satisfied);
+    }
+}
+
+//------------------------------------------------------------------------------
+bool Task::complete(const bool status)
+{
+    int state = mState.load(std::memory_order_relaxed);
+    do
+    {
+        if(0 != (state & COMPLETE_MASK))
+        {
+            return false;
+        }
+    }
+    while(!mState.compare_exchange_weak(state, status ? SUCCEEDED : FAILED, std::memory_order_acq_rel));
+
+    if(0 != (state & HAS_WAITERS))
+    {
+        atomicNotifyAll(mState);
+    }
+
+    //close the list, anything added from now on sees us completed, then run what was added in the order it was added
+    Continuation* continuations = mContinuations.exchange(getCompletedList(), std::memory_order_acq_rel);
+    Continuation* ordered = 0;
+    while(0 != continuations)
+    {
+        Continuation* next = continuations->next;
+        continuations->next = ordered;
+        ordered = continuations;
+        continuations = next;
+    }
+
+    while(0 != ordered)
+    {
+        Continuation* continuation = ordered;
+        ordered = continuation->next;
+
+        if(0 != continuation->promise)
+        {
+            continuation->promise->set_value(status);
+        }
+        else
+        {
+            continuation->task->onAntecedentComplete(status);
+            continuation->manager->run(std::move(continuation->task));
+        }
+        delete continuation;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool Task::pushContinuation(Continuation* continuation)
+{
+    Continuation* head = mContinuations.load(std::memory_order_acquire);
+    do
+    {
+        if(getCompletedList() == head)
+        {
+            return false;
+        }
+        continuation->next = head;
+    }
+    while(!mContinuations.compare_exchange_weak(head, continuation, std::memory_order_acq_rel, std::memory_order_acquire));
+    return true;
+}
+
+//------------------------------------------------------------------------------
+Task::Continuation* Task::getCompletedList()
+{
+    static Continuation completed;
+    return &completed;
+}
+
+//------------------------------------------------------------------------------
+std::shared_ptr<Task> Task::then(Manager& manager, std::function<bool (bool)> continuation)
+{
+    std::shared_ptr<Task> task(new ContinuationTask(continuation));
+    then(manager, task);
+    return task;
+}
+
+//------------------------------------------------------------------------------
+void Task::then(Manager& manager, std::shared_ptr<Task> continuation)
+{
+    then(manager, TaskHandle(continuation));
+}
+
+//------------------------------------------------------------------------------
+void Task::then(Manager& manager, TaskHandle continuation)
+{
+    Continuation* pending = new Continuation();
+    pending->manager = &manager;
+    pending->task = std::move(continuation);
+
+    if(!pushContinuation(pending))
+    {
+        //already complete, nothing to wait for
+        pending->task->onAntecedentComplete(getCompletionStatus());
+        manager.run(std::move(pending->task));
+        delete pending;
+    }
+}
+
+//------------------------------------------------------------------------------
+void Task::destroy()
+{
+    delete this;
+}
+
+//------------------------------------------------------------------------------
+void Task::addSharedReference(const std::shared_ptr<Task>& owner)
+{
+    mIsShared.store(true, std::memory_order_relaxed);
+
+    //while other handles exist the owner is already set and cannot be cleared under us
+    unsigned int nbReferences = mNbReferences.load(std::memory_order_relaxed);
+    while(nbReferences > 0)
+    {
+        if(mNbReferences.compare_exchange_weak(nbReferences, nbReferences + 1, std::memory_order_acq_rel))
+        {
+            return;
+        }
+    }
+
+    lockSharedOwner();
+    if(0 == mNbReferences.fetch_add(1, std::memory_order_acq_rel))
+    {
+        //first handle, keep the shared_ptrs' task alive until the last handle is gone
+        mSharedOwner = owner;
+    }
+    unlockSharedOwner();
+}
+
+//------------------------------------------------------------------------------
+void Task::releaseSharedReference()
+{
+    unsigned int nbReferences = mNbReferences.load(std::memory_order_relaxed);
+    while(nbReferences > 1)
+    {
+        if(mNbReferences.compare_exchange_weak(nbReferences, nbReferences - 1, std::memory_order_acq_rel))
+        {
+            return;
+        }
+    }
+
+    //maybe the last handle, give the task back to its shared_ptrs under the lock so that a new first handle cannot slip in
+    std::shared_ptr<Task> owner;
+    lockSharedOwner();
+    if(1 == mNbReferences.fetch_sub(1, std::memory_order_acq_rel))
+    {
+        owner.swap(mSharedOwner);
+    }
+    unlockSharedOwner();
+    //may delete us
+}
+
+//------------------------------------------------------------------------------
+void Task::lockSharedOwner()
+{
+    while(mSharedOwnerLocked.exchange(true, std::memory_order_acquire))
+    {
+        std::this_thread::yield();
+    }
+}
+
+//------------------------------------------------------------------------------
+void Task::unlockSharedOwner()
+{
+    mSharedOwnerLocked.store(false, std::memory_order_release);
+}
+
+//------------------------------------------------------------------------------
+void Task::onAntecedentComplete(const bool)
+{
+
 }
 
 //------------------------------------------------------------------------------
-void Task::perform(std::function<void(void)> completeFunction)
+void Task::perform(const std::function<void(void)>& completeFunction)
 {
     bool result = performSpecific();
     completeFunction();
@@ -1,37 +1,301 @@
 #pragma once
 #include "Platform.h"
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
 #include <functional>
 #include <future>
+#include <memory>
 
 namespace workers {
 
+class Manager;
+class Task;
+
+//Priority of a task waiting in the manager's queue, higher bands are served first
+enum class Priority {
+    CRITICAL,
+    HIGH,
+    NORMAL,
+    LOW
+};
+
+//Number of priority bands
+const size_t NB_PRIORITIES = 4;
+
+//Intrusively counted reference to a task. Copies only touch the count kept inside the task itself,
+//and moving a handle along (queue, worker, continuation) does not touch it at all
+class TaskHandle {
+public:
+    inline TaskHandle();
+    //Take a reference to a task created with new, or pooled, which is destroyed once the last handle goes away
+    inline explicit TaskHandle(Task* task);
+    //Take a reference to a task owned by shared_ptrs, which is kept alive while any handle exists
+    inline explicit TaskHandle(const std::shared_ptr<Task>& task);
+    inline TaskHandle(const TaskHandle& other);
+    inline TaskHandle(TaskHandle&& other);
+    inline ~TaskHandle();
+
+    inline TaskHandle& operator=(TaskHandle other);
+
+    //Give up our reference without releasing it, for containers that only hold raw pointers
+    inline Task* release();
+    //Take back a reference given up with release
+    inline static TaskHandle adopt(Task* task);
+
+    inline void reset();
+    inline void swap(TaskHandle& other);
+    inline Task* get() const;
+    inline Task* operator->() const;
+    inline Task& operator*() const;
+    inline explicit operator bool() const;
+private:
+    Task* mTask;
+};
+
 class EXAMPLES_LIB_API Task {
 public:
     Task();
     virtual ~Task();
 
-    //Get future associated with this task to determine when it completes
-    inline std::future<bool> getCompletionFuture();
+    //True once the task has completed, never blocks
+    inline bool isComplete() const;
+    //Whether the task succeeded, only meaningful once it is complete
+    inline bool getCompletionStatus() const;
+    //Block until the task completes and return whether it succeeded. Any number of threads may wait,
+    //costing a load when already complete and otherwise a single sleep until we complete
+    bool waitForCompletion();
+    //Get a future to determine when the task completes. Allocates, prefer waitForCompletion where a future is not needed
+    std::future<bool> getCompletionFuture();
     //used by workers to perform the functionality of this task (performSpecific)
-    void perform(std::function<void(void)> priorToCompleteFunction);
+    void perform(const std::function<void(void)>& priorToCompleteFunction);
     //used by workers to indicate completion status if they do not call perform
     void setCompletionStatus(const bool status);
 
+    //Run a function on the manager's workers as soon as this task completes, passing it our result.
+    //Returns the task running the function, so continuations can be chained. Manager must outlive this task
+    std::shared_ptr<Task> then(Manager& manager, std::function<bool (bool)> continuation);
+    //Run another task on the manager as soon as this task completes
+    void then(Manager& manager, std::shared_ptr<Task> continuation);
+    void then(Manager& manager, TaskHandle continuation);
+
+    //NUMA node we would rather run on, for tasks working on memory local to a node. -1 for no preference
+    inline void setNodeHint(const int node);
+    inline int getNodeHint() const;
+
 protected:
     //abstract method for task functionality, returning true if successful
     virtual bool performSpecific() = 0;
+    //called once the last TaskHandle is gone from a task not owned by shared_ptrs
+    virtual void destroy();
 
 private:
-    //promise used to determine when task is finished
-    std::promise<bool> mTaskCompletePromise;
+    friend class Manager;
+    friend class TaskHandle;
+
+    //called on a continuation with the result of the task it was waiting on, just before it is run
+    virtual void onAntecedentComplete(const bool status);
+    //set our completion status and run continuations, false if we were already complete
+    bool complete(const bool status);
+
+    //used by TaskHandle
+    inline void addReference();
+    inline void releaseReference();
+    //same for tasks owned by shared_ptrs, where the first and last handles hand ownership over under our lock
+    void addSharedReference(const std::shared_ptr<Task>& owner);
+    void releaseSharedReference();
+    void lockSharedOwner();
+    void unlockSharedOwner();
+
+    //task to run on a manager, or promise to set, once we complete. Kept in a lock free list
+    struct Continuation {
+        Manager* manager;
+        TaskHandle task;
+        std::unique_ptr< std::promise<bool> > promise;
+        Continuation* next;
+    };
+    //add to the list, false if we completed already and the caller has to handle it
+    bool pushContinuation(Continuation* continuation);
+    //marks the list once we complete, nothing can be added after
+    static Continuation* getCompletedList();
+
+    //bits of mState
+    enum State {
+        PENDING = 0,
+        SUCCEEDED = 1,
+        FAILED = 2,
+        COMPLETE_MASK = 3,
+        //set by threads sleeping in waitForCompletion, so that completing only wakes anyone when needed
+        HAS_WAITERS = 4
+    };
+
+    std::atomic<int> mState;
+    std::atomic<Continuation*> mContinuations;
+    //number of TaskHandles referencing us
+    std::atomic<unsigned int> mNbReferences;
+    //true once a handle was made from a shared_ptr, the shared_ptrs own us rather than our handles
+    std::atomic<bool> mIsShared;
+    //set while handles exist to a task owned by shared_ptrs, so it is not deleted under them
+    std::shared_ptr<Task> mSharedOwner;
+    //spin lock guarding mSharedOwner, only ever held for a couple of instructions
+    std::atomic<bool> mSharedOwnerLocked;
+    //set by the manager when we are queued, to measure how long we waited
+    std::chrono::steady_clock::time_point mQueuedTime;
+    int mNodeHint;
 };
 
 //inline implementations
 //------------------------------------------------------------------------------
-std::future<bool> Task::getCompletionFuture()
+bool Task::isComplete() const
+{
+    return 0 != (mState.load(std::memory_order_acquire) & COMPLETE_MASK);
+}
+
+//------------------------------------------------------------------------------
+bool Task::getCompletionStatus() const
+{
+    return SUCCEEDED == (mState.load(std::memory_order_acquire) & COMPLETE_MASK);
+}
+
+//------------------------------------------------------------------------------
+void Task::setNodeHint(const int node)
+{
+    mNodeHint = node;
+}
+
+//------------------------------------------------------------------------------
+int Task::getNodeHint() const
+{
+    return mNodeHint;
+}
+
+//------------------------------------------------------------------------------
+void Task::addReference()
+{
+    mNbReferences.fetch_add(1, std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+void Task::releaseReference()
+{
+    if(mIsShared.load(std::memory_order_relaxed))
+    {
+        releaseSharedReference();
+    }
+    else if(1 == mNbReferences.fetch_sub(1, std::memory_order_acq_rel))
+    {
+        destroy();
+    }
+}
+
+//------------------------------------------------------------------------------
+TaskHandle::TaskHandle() : mTask(0)
+{
+
+}
+
+//------------------------------------------------------------------------------
+TaskHandle::TaskHandle(Task* task) : mTask(task)
+{
+    if(0 != mTask)
+    {
+        mTask->addReference();
+    }
+}
+
+//------------------------------------------------------------------------------
+TaskHandle::TaskHandle(const std::shared_ptr<Task>& task) : mTask(task.get())
+{
+    if(0 != mTask)
+    {
+        mTask->addSharedReference(task);
+    }
+}
+
+//------------------------------------------------------------------------------
+TaskHandle::TaskHandle(const TaskHandle& other) : mTask(other.mTask)
+{
+    if(0 != mTask)
+    {
+        mTask->addReference();
+    }
+}
+
+//------------------------------------------------------------------------------
+TaskHandle::TaskHandle(TaskHandle&& other) : mTask(other.mTask)
+{
+    other.mTask = 0;
+}
+
+//------------------------------------------------------------------------------
+TaskHandle::~TaskHandle()
+{
+    reset();
+}
+
+//------------------------------------------------------------------------------
+TaskHandle& TaskHandle::operator=(TaskHandle other)
+{
+    swap(other);
+    return *this;
+}
+
+//------------------------------------------------------------------------------
+Task* TaskHandle::release()
+{
+    Task* task = mTask;
+    mTask = 0;
+    return task;
+}
+
+//------------------------------------------------------------------------------
+TaskHandle TaskHandle::adopt(Task* task)
 {
-    return mTaskCompletePromise.get_future();
+    TaskHandle handle;
+    handle.mTask = task;
+    return handle;
 }
 
-}
\ No newline at end of file
+//------------------------------------------------------------------------------
+void TaskHandle::reset()
+{
+    if(0 != mTask)
+    {
+        release()->releaseReference();
+    }
+}
+
+//------------------------------------------------------------------------------
+void TaskHandle::swap(TaskHandle& other)
+{
+    Task* task = mTask;
+    mTask = other.mTask;
+    other.mTask = task;
+}
+
+//------------------------------------------------------------------------------
+Task* TaskHandle::get() const
+{
+    return mTask;
+}
+
+//------------------------------------------------------------------------------
+Task* TaskHandle::operator->() const
+{
+    return mTask;
+}
+
+//------------------------------------------------------------------------------
+Task& TaskHandle::operator*() const
+{
+    return *mTask;
+}
+
+//------------------------------------------------------------------------------
+TaskHandle::operator bool() const
+{
+    return 0 != mTask;
+}
+
+}
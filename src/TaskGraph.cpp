@@ -0,0 +1,242 @@
+#include "TaskGraph.h"
+#include "AtomicWait.h"
+
+#include <thread>
+
+namespace workers {
+
+//What a pooled task runs for a node. A task the manager drops without running, once shut down,
+//still has to count its node as done, which happens when the callable is destroyed without having run
+struct TaskGraphNodeRunner {
+    TaskGraphNodeRunner(TaskGraph* graph, const size_t nodeIdx) : graph(graph), nodeIdx(nodeIdx)
+    {
+
+    }
+
+    TaskGraphNodeRunner(TaskGraphNodeRunner&& other) : graph(other.graph), nodeIdx(other.nodeIdx)
+    {
+        other.graph = 0;
+    }
+
+    ~TaskGraphNodeRunner()
+    {
+        if(0 != graph)
+        {
+            graph->skipNode(nodeIdx);
+        }
+    }
+
+    void operator()()
+    {
+        TaskGraph* runGraph = graph;
+        graph = 0;
+        runGraph->runNode(nodeIdx);
+    }
+
+    TaskGraph* graph;
+    size_t nodeIdx;
+};
+
+//------------------------------------------------------------------------------
+TaskGraph::TaskGraph() : mIsChanged(false), mManager(0), mNbUnfinished(0), mHasFailed(false), mIsRunning(false)
+{
+
+}
+
+//------------------------------------------------------------------------------
+TaskGraph::~TaskGraph()
+{
+    wait();
+}
+
+//------------------------------------------------------------------------------
+void TaskGraph::addEdge(const size_t before, const size_t after)
+{
+    mNodes[before].successors.push_back(after);
+    ++mNodes[after].nbPredecessors;
+    mIsChanged = true;
+}
+
+//------------------------------------------------------------------------------
+bool TaskGraph::run(Manager& manager)
+{
+    bool isRunning = false;
+    if(!mIsRunning.compare_exchange_strong(isRunning, true))
+    {
+        return false;
+    }
+
+    if(mIsChanged && !prepare())
+    {
+        mIsRunning = false;
+        return false;
+    }
+
+    mHasFailed = false;
+    if(mNodes.empty())
+    {
+        mIsRunning = false;
+        return true;
+    }
+
+    mManager = &manager;
+    for(size_t nodeIdx = 0; nodeIdx < mNodes.size(); ++nodeIdx)
+    {
+        mStates[nodeIdx].nbPending.store(mNodes[nodeIdx].nbPredecessors, std::memory_order_relaxed);
+        mStates[nodeIdx].isSkipped.store(false, std::memory_order_relaxed);
+    }
+    mNbUnfinished = static_cast<int>(mNodes.size());
+
+    //once the last root is handed over the run may finish any time, do not touch anything after
+    const size_t nbRoots = mRoots.size();
+    for(size_t rootIdx = 0; rootIdx < nbRoots; ++rootIdx)
+    {
+        submitNode(mRoots[rootIdx]);
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool TaskGraph::wait()
+{
+    for(int nbUnfinished = mNbUnfinished; 0 != nbUnfinished; nbUnfinished = mNbUnfinished)
+    {
+        atomicWait(mNbUnfinished, nbUnfinished);
+    }
+
+    //whoever finished the last node may still be waking us up
+    while(mIsRunning.load(std::memory_order_acquire))
+    {
+        std::this_thread::yield();
+    }
+    return !mHasFailed;
+}
+
+//------------------------------------------------------------------------------
+bool TaskGraph::prepare()
+{
+    //walk the graph from its roots, every node is reached only if there is no cycle
+    std::vector<size_t> nbPending(mNodes.size());
+    std::vector<size_t> ready;
+    mRoots.clear();
+    for(size_t nodeIdx = 0; nodeIdx < mNodes.size(); ++nodeIdx)
+    {
+        nbPending[nodeIdx] = mNodes[nodeIdx].nbPredecessors;
+        if(0 == nbPending[nodeIdx])
+        {
+            mRoots.push_back(nodeIdx);
+            ready.push_back(nodeIdx);
+        }
+    }
+
+    size_t nbReached = 0;
+    while(!ready.empty())
+    {
+        const size_t nodeIdx = ready.back();
+        ready.pop_back();
+        ++nbReached;
+
+        const std::vector<size_t>& successors = mNodes[nodeIdx].successors;
+        for(std::vector<size_t>::const_iterator successor = successors.begin(); successor != successors.end(); ++successor)
+        {
+            if(0 == --nbPending[*successor])
+            {
+                ready.push_back(*successor);
+            }
+        }
+    }
+    if(nbReached != mNodes.size())
+    {
+        return false;
+    }
+
+    std::vector<NodeState>(mNodes.size()).swap(mStates);
+    mIsChanged = false;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void TaskGraph::submitNode(const size_t nodeIdx)
+{
+    mManager->submit(TaskGraphNodeRunner(this, nodeIdx), mNodes[nodeIdx].priority);
+}
+
+//------------------------------------------------------------------------------
+void TaskGraph::runNode(size_t nodeIdx)
+{
+    while(NO_NODE != nodeIdx)
+    {
+        const bool succeeded = mNodes[nodeIdx].function();
+        nodeIdx = finishNode(nodeIdx, succeeded);
+    }
+}
+
+//------------------------------------------------------------------------------
+void TaskGraph::skipNode(const size_t nodeIdx)
+{
+    //every successor is skipped as well, none of them comes back to be run
+    finishNode(nodeIdx, false);
+}
+
+//------------------------------------------------------------------------------
+size_t TaskGraph::finishNode(const size_t nodeIdx, const bool succeeded)
+{
+    size_t nextIdx = NO_NODE;
+    //successors of a failed node that are now skipped, finished here rather than through the manager
+    std::vector<size_t> skipped;
+    int nbFinished = 0;
+
+    size_t finishedIdx = nodeIdx;
+    bool isSucceeded = succeeded;
+    for(;;)
+    {
+        ++nbFinished;
+        if(!isSucceeded)
+        {
+            mHasFailed = true;
+        }
+
+        const std::vector<size_t>& successors = mNodes[finishedIdx].successors;
+        for(std::vector<size_t>::const_iterator successor = successors.begin(); successor != successors.end(); ++successor)
+        {
+            NodeState& state = mStates[*successor];
+            if(!isSucceeded)
+            {
+                state.isSkipped.store(true, std::memory_order_relaxed);
+            }
+            if(1 == state.nbPending.fetch_sub(1, std::memory_order_acq_rel))
+            {
+                if(state.isSkipped.load(std::memory_order_relaxed))
+                {
+                    skipped.push_back(*successor);
+                }
+                else if(NO_NODE == nextIdx)
+                {
+                    nextIdx = *successor;
+                }
+                else
+                {
+                    submitNode(*successor);
+                }
+            }
+        }
+
+        if(skipped.empty())
+        {
+            break;
+        }
+        finishedIdx = skipped.back();
+        skipped.pop_back();
+        isSucceeded = false;
+    }
+
+    //a node we hand back is still unfinished, so the run cannot end while we are using it
+    if(nbFinished == mNbUnfinished.fetch_sub(nbFinished))
+    {
+        atomicNotifyAll(mNbUnfinished);
+        mIsRunning.store(false, std::memory_order_release);
+    }
+    return nextIdx;
+}
+
+}
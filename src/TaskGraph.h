@@ -0,0 +1,124 @@
+#pragma once
+#include "Platform.h"
+#include "Manager.h"
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace workers {
+
+//Tasks with dependencies between them, built once then run on a manager as many times as needed.
+//Each node counts how many of its predecessors are left and is handed to the manager the moment that reaches 0,
+//so no worker ever blocks waiting on another node. The worker finishing a node goes straight on to one of the
+//successors it made ready, the others are handed to the manager.
+//A node whose function returns false fails, and every node after it is skipped and fails too.
+//Nodes and edges must not be added while the graph is running
+class EXAMPLES_LIB_API TaskGraph {
+public:
+    TaskGraph();
+    //Waits for the graph to finish if it is running
+    ~TaskGraph();
+
+    //Add a node running a callable, which may return bool to report success. Returns the node's index
+    template<typename F>
+    size_t addNode(F&& function, const Priority priority = Priority::NORMAL);
+    //Make after wait for before to complete
+    void addEdge(const size_t before, const size_t after);
+
+    //Start running every node. Nothing is allocated for the graph itself once it has run since its last change,
+    //only pooled tasks. False if it is already running or has a cycle, in which case nothing is run
+    bool run(Manager& manager);
+    //Block until a run finishes, true if every node ran and succeeded. Waiting from a task ties up a worker
+    bool wait();
+    inline bool isRunning() const;
+    inline size_t getNbNodes() const;
+private:
+    TaskGraph(const TaskGraph&);
+    TaskGraph& operator=(const TaskGraph&);
+
+    static const size_t NO_NODE = static_cast<size_t>(-1);
+
+    struct Node {
+        std::function<bool ()> function;
+        Priority priority;
+        std::vector<size_t> successors;
+        size_t nbPredecessors;
+    };
+    //what changes while running, kept apart from nodes so that adding nodes can move those around
+    struct NodeState {
+        std::atomic<size_t> nbPending;
+        //set by a predecessor that failed or was skipped, before it counts itself done
+        std::atomic<bool> isSkipped;
+    };
+
+    friend struct TaskGraphNodeRunner;
+
+    //wrap a callable returning void or bool into one returning its success
+    template<typename F>
+    static std::function<bool ()> makeFunction(F&& function);
+
+    //check for cycles and find the nodes to start from, after the graph changed
+    bool prepare();
+    //hand a ready node to the manager
+    void submitNode(const size_t nodeIdx);
+    //run a node, then any successor it makes ready that nobody else is running
+    void runNode(size_t nodeIdx);
+    //a node was not run, the manager dropped it
+    void skipNode(const size_t nodeIdx);
+    //count a node as done and release its successors. Returns one that is now ready for the caller to run,
+    //submitting the others, NO_NODE if none
+    size_t finishNode(const size_t nodeIdx, const bool succeeded);
+
+    std::vector<Node> mNodes;
+    std::vector<NodeState> mStates;
+    std::vector<size_t> mRoots;
+    //nodes or edges were added since prepare
+    bool mIsChanged;
+    Manager* mManager;
+    //nodes not done yet in this run, the last one to finish wakes anyone waiting
+    std::atomic<int> mNbUnfinished;
+    std::atomic<bool> mHasFailed;
+    //only cleared once whoever finished the run is done touching us
+    std::atomic<bool> mIsRunning;
+};
+
+//inline implementations
+//------------------------------------------------------------------------------
+bool TaskGraph::isRunning() const
+{
+    return mIsRunning.load(std::memory_order_acquire);
+}
+
+//------------------------------------------------------------------------------
+size_t TaskGraph::getNbNodes() const
+{
+    return mNodes.size();
+}
+
+//template implementations
+//------------------------------------------------------------------------------
+template<typename F>
+size_t TaskGraph::addNode(F&& function, const Priority priority)
+{
+    Node node;
+    node.function = makeFunction(std::forward<F>(function));
+    node.priority = priority;
+    node.nbPredecessors = 0;
+    mNodes.push_back(std::move(node));
+    mIsChanged = true;
+    return mNodes.size() - 1;
+}
+
+//------------------------------------------------------------------------------
+template<typename F>
+std::function<bool ()> TaskGraph::makeFunction(F&& function)
+{
+    typename std::decay<F>::type callable(std::forward<F>(function));
+    return [callable]() mutable -> bool { return invokeForStatus(callable); };
+}
+
+}
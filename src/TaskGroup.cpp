@@ -0,0 +1,161 @@
+#include "TaskGroup.h"
+#include "AtomicWait.h"
+
+#include <thread>
+
+namespace workers {
+
+//What a pooled task runs for a task of a group, performing it so that it has completed by the time it finishes
+//in the group. A task the manager drops without running is completed as failed as the callable is destroyed
+struct TaskGroupTask {
+    TaskGroupTask(TaskGroup* group, TaskHandle task) : group(group), task(std::move(task))
+    {
+
+    }
+
+    TaskGroupTask(TaskGroupTask&& other) : group(other.group), task(std::move(other.task))
+    {
+        other.group = 0;
+    }
+
+    ~TaskGroupTask()
+    {
+        if(0 != group)
+        {
+            //setting the status of a task that already completed throws, which would terminate us here
+            if(!task->isComplete())
+            {
+                task->setCompletionStatus(false);
+            }
+            group->finishTask(false);
+        }
+    }
+
+    bool operator()()
+    {
+        TaskGroup* runGroup = group;
+        group = 0;
+        //performing would set the status of a task that already completed, which throws
+        if(!task->isComplete())
+        {
+            task->perform([]() {});
+        }
+        const bool succeeded = task->getCompletionStatus();
+        runGroup->finishTask(succeeded);
+        return succeeded;
+    }
+
+    TaskGroup* group;
+    TaskHandle task;
+};
+
+//------------------------------------------------------------------------------
+TaskGroup::TaskGroup(Manager& manager) : mManager(manager), mParent(0), mState(0), mHasFailed(false)
+{
+
+}
+
+//------------------------------------------------------------------------------
+TaskGroup::TaskGroup(TaskGroup& parent) : mManager(parent.mManager), mParent(&parent), mState(0), mHasFailed(false)
+{
+
+}
+
+//------------------------------------------------------------------------------
+TaskGroup::~TaskGroup()
+{
+    wait();
+}
+
+//------------------------------------------------------------------------------
+bool TaskGroup::run(std::shared_ptr<Task> task, const Priority priority)
+{
+    return run(TaskHandle(task), priority);
+}
+
+//------------------------------------------------------------------------------
+bool TaskGroup::run(TaskHandle task, const Priority priority)
+{
+    if(!task)
+    {
+        return false;
+    }
+
+    addTask();
+    const int nodeHint = task->getNodeHint();
+    TaskHandle groupTask = CallableTask::create(TaskGroupTask(this, std::move(task)));
+    groupTask->setNodeHint(nodeHint);
+    return mManager.run(std::move(groupTask), priority);
+}
+
+//------------------------------------------------------------------------------
+bool TaskGroup::wait()
+{
+    for(;;)
+    {
+        const int state = mState.load(std::memory_order_acquire);
+        if(0 == state)
+        {
+            break;
+        }
+
+        if(0 == (state & IN_FLIGHT_MASK))
+        {
+            //whoever finished the last task is still waking us up
+            std::this_thread::yield();
+        }
+        else
+        {
+            atomicWait(mState, state);
+        }
+    }
+    return !mHasFailed.exchange(false);
+}
+
+//------------------------------------------------------------------------------
+bool TaskGroup::tryWait() const
+{
+    return 0 == mState.load(std::memory_order_acquire);
+}
+
+//------------------------------------------------------------------------------
+void TaskGroup::addTask()
+{
+    for(TaskGroup* group = this; 0 != group; group = group->mParent)
+    {
+        group->mState.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+//------------------------------------------------------------------------------
+void TaskGroup::finishTask(const bool succeeded)
+{
+    //innermost first, so a parent cannot be done before the groups nested in it
+    TaskGroup* group = this;
+    while(0 != group)
+    {
+        //once the count is 0, a waiting thread may destroy the group, read what we need before that
+        TaskGroup* parent = group->mParent;
+        if(!succeeded)
+        {
+            group->mHasFailed.store(true, std::memory_order_relaxed);
+        }
+
+        //taking the last task marks us as still waking waiters in the same step, so none can destroy the group under us
+        int state = group->mState.load(std::memory_order_relaxed);
+        while(!group->mState.compare_exchange_weak(state, (1 == (state & IN_FLIGHT_MASK)) ? state - 1 + NOTIFYING : state - 1,
+            std::memory_order_acq_rel, std::memory_order_relaxed))
+        {
+
+        }
+        if(1 == (state & IN_FLIGHT_MASK))
+        {
+            atomicNotifyAll(group->mState);
+            group->mState.fetch_sub(NOTIFYING, std::memory_order_release);
+        }
+
+        group = parent;
+    }
+}
+
+}
@@ -0,0 +1,139 @@
+#pragma once
+#include "Platform.h"
+#include "Manager.h"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace workers {
+
+//Tasks run on a manager that can be waited on together, unlike waitForTasksToComplete which covers every task
+//of the manager and returns once they have left its queues. A single counter covers the group's tasks from the
+//moment they are run until they finish, queued or running, and the last one to finish wakes whoever waits,
+//so waiting on any number of tasks costs one wake up.
+//A nested group counts its tasks in its parent as well, so waiting on the parent waits for them too.
+//A group holds up to 16 million tasks in flight at once
+class EXAMPLES_LIB_API TaskGroup {
+public:
+    TaskGroup(Manager& manager);
+    //Group nested in another, running on the same manager. The parent must outlive it
+    TaskGroup(TaskGroup& parent);
+    //Waits for the group's tasks to finish
+    ~TaskGroup();
+
+    //Run a callable, which may return bool to report success, as part of the group
+    template<typename F>
+    void submit(F&& function, const Priority priority = Priority::NORMAL);
+    //Run a task as part of the group, which finishes once the task completed. False if the manager rejected it,
+    //in which case it is completed as failed and counted as a failure. A null task is not run nor counted, and gives false
+    bool run(TaskHandle task, const Priority priority = Priority::NORMAL);
+    bool run(std::shared_ptr<Task> task, const Priority priority = Priority::NORMAL);
+    //Block until every task run in the group, or in a group nested in it, has finished. True if they all succeeded,
+    //failures are forgotten once reported. Waiting from one of the group's own tasks never returns
+    bool wait();
+    //True once nothing is in flight, never blocks. wait then returns straight away with the result
+    bool tryWait() const;
+    inline size_t getNbInFlight() const;
+    inline Manager& getManager() const;
+private:
+    TaskGroup(const TaskGroup&);
+    TaskGroup& operator=(const TaskGroup&);
+
+    template<typename Function>
+    friend class TaskGroupFunction;
+    friend struct TaskGroupTask;
+
+    //mState holds the tasks in flight in its low bits, and above them a count of threads that took it to 0 and
+    //are still waking waiters, which the group may not be destroyed under
+    static const int IN_FLIGHT_MASK = (1 << 24) - 1;
+    static const int NOTIFYING = 1 << 24;
+
+    //count a task in us and every group we are nested in
+    void addTask();
+    //count a task as finished in us and every group we are nested in, waking anyone waiting once none is left
+    void finishTask(const bool succeeded);
+
+    Manager& mManager;
+    TaskGroup* mParent;
+    std::atomic<int> mState;
+    std::atomic<bool> mHasFailed;
+};
+
+//What a pooled task runs for a callable of a group. A task the manager drops without running still finishes
+//in its group, once the callable is destroyed without having run
+template<typename Function>
+class TaskGroupFunction {
+public:
+    template<typename F>
+    TaskGroupFunction(TaskGroup* group, F&& function);
+    TaskGroupFunction(TaskGroupFunction&& other);
+    ~TaskGroupFunction();
+
+    bool operator()();
+private:
+    TaskGroup* mGroup;
+    Function mFunction;
+};
+
+//inline implementations
+//------------------------------------------------------------------------------
+size_t TaskGroup::getNbInFlight() const
+{
+    return static_cast<size_t>(mState.load(std::memory_order_relaxed) & IN_FLIGHT_MASK);
+}
+
+//------------------------------------------------------------------------------
+Manager& TaskGroup::getManager() const
+{
+    return mManager;
+}
+
+//template implementations
+//------------------------------------------------------------------------------
+template<typename F>
+void TaskGroup::submit(F&& function, const Priority priority)
+{
+    addTask();
+    mManager.submit(TaskGroupFunction<typename std::decay<F>::type>(this, std::forward<F>(function)), priority);
+}
+
+//------------------------------------------------------------------------------
+template<typename Function>
+template<typename F>
+TaskGroupFunction<Function>::TaskGroupFunction(TaskGroup* group, F&& function) : mGroup(group), mFunction(std::forward<F>(function))
+{
+
+}
+
+//------------------------------------------------------------------------------
+template<typename Function>
+TaskGroupFunction<Function>::TaskGroupFunction(TaskGroupFunction&& other) : mGroup(other.mGroup), mFunction(std::move(other.mFunction))
+{
+    other.mGroup = 0;
+}
+
+//------------------------------------------------------------------------------
+template<typename Function>
+TaskGroupFunction<Function>::~TaskGroupFunction()
+{
+    if(0 != mGroup)
+    {
+        mGroup->finishTask(false);
+    }
+}
+
+//------------------------------------------------------------------------------
+template<typename Function>
+bool TaskGroupFunction<Function>::operator()()
+{
+    TaskGroup* group = mGroup;
+    mGroup = 0;
+    const bool succeeded = invokeForStatus(mFunction);
+    group->finishTask(succeeded);
+    return succeeded;
+}
+
+}
@@ -0,0 +1,202 @@
+#include "TaskPool.h"
+
+namespace workers {
+
+//Pools a thread has cached blocks for. Enough for the task pool and every coroutine frame pool, a thread using more pools than this goes straight to their shared lists
+class TaskPool::ThreadCache {
+public:
+    static const size_t MAX_POOLS = 8;
+
+    struct Entry {
+        TaskPool* pool;
+        FreeBlock* blocks;
+        size_t nbBlocks;
+    };
+
+    ThreadCache()
+    {
+        for(size_t entryIdx = 0; entryIdx < MAX_POOLS; ++entryIdx)
+        {
+            Entry empty = { 0, 0, 0 };
+            mEntries[entryIdx] = empty;
+        }
+    }
+
+    //thread is exiting, hand our blocks to the other threads
+    ~ThreadCache()
+    {
+        flushAll();
+    }
+
+    //cache for a pool, 0 if we have no room for another pool
+    Entry* find(TaskPool* pool)
+    {
+        Entry* empty = 0;
+        for(size_t entryIdx = 0; entryIdx < MAX_POOLS; ++entryIdx)
+        {
+            if(mEntries[entryIdx].pool == pool)
+            {
+                return &mEntries[entryIdx];
+            }
+            if(0 == empty && 0 == mEntries[entryIdx].pool)
+            {
+                empty = &mEntries[entryIdx];
+            }
+        }
+        if(0 != empty)
+        {
+            empty->pool = pool;
+        }
+        return empty;
+    }
+
+    void flushAll()
+    {
+        for(size_t entryIdx = 0; entryIdx < MAX_POOLS; ++entryIdx)
+        {
+            flush(mEntries[entryIdx], 0);
+        }
+    }
+
+    //give all but nbToKeep blocks back to the entry's pool
+    static void flush(Entry& entry, const size_t nbToKeep)
+    {
+        if(entry.nbBlocks <= nbToKeep)
+        {
+            return;
+        }
+
+        FreeBlock* first = entry.blocks;
+        FreeBlock* last = first;
+        for(size_t blockIdx = nbToKeep + 1; blockIdx < entry.nbBlocks; ++blockIdx)
+        {
+            last = last->next;
+        }
+        entry.blocks = last->next;
+        entry.nbBlocks = nbToKeep;
+        entry.pool->giveBlocks(first, last);
+    }
+private:
+    Entry mEntries[MAX_POOLS];
+};
+
+//------------------------------------------------------------------------------
+TaskPool::TaskPool(const size_t blockSize, const size_t blocksPerChunk) : mBlocksPerChunk(blocksPerChunk), mFreeBlocks(0)
+{
+    //keep every block aligned for anything it might hold
+    const size_t alignment = sizeof(long double) > sizeof(FreeBlock) ? sizeof(long double) : sizeof(FreeBlock);
+    mBlockSize = ((blockSize + alignment - 1) / alignment) * alignment;
+}
+
+//------------------------------------------------------------------------------
+void TaskPool::flushThreadCache()
+{
+    getThreadCache().flushAll();
+}
+
+//------------------------------------------------------------------------------
+TaskPool::ThreadCache& TaskPool::getThreadCache()
+{
+    static thread_local ThreadCache cache;
+    return cache;
+}
+
+//------------------------------------------------------------------------------
+void* TaskPool::allocate(const size_t size)
+{
+    if(size > mBlockSize)
+    {
+        return ::operator new(size);
+    }
+
+    ThreadCache::Entry* entry = getThreadCache().find(this);
+    if(0 == entry)
+    {
+        size_t nbBlocks = 1;
+        return takeBlocks(nbBlocks);
+    }
+
+    if(0 == entry->blocks)
+    {
+        size_t nbBlocks = BATCH_SIZE;
+        entry->blocks = takeBlocks(nbBlocks);
+        entry->nbBlocks = nbBlocks;
+    }
+
+    FreeBlock* block = entry->blocks;
+    entry->blocks = block->next;
+    --entry->nbBlocks;
+    return block;
+}
+
+//------------------------------------------------------------------------------
+void TaskPool::deallocate(void* block, const size_t size)
+{
+    if(size > mBlockSize)
+    {
+        ::operator delete(block);
+        return;
+    }
+
+    FreeBlock* freeBlock = static_cast<FreeBlock*>(block);
+    ThreadCache::Entry* entry = getThreadCache().find(this);
+    if(0 == entry)
+    {
+        giveBlocks(freeBlock, freeBlock);
+        return;
+    }
+
+    freeBlock->next = entry->blocks;
+    entry->blocks = freeBlock;
+    ++entry->nbBlocks;
+
+    //blocks freed here but made elsewhere pile up, pass a batch on while keeping one for ourselves
+    if(entry->nbBlocks >= 2 * BATCH_SIZE)
+    {
+        ThreadCache::flush(*entry, BATCH_SIZE);
+    }
+}
+
+//------------------------------------------------------------------------------
+TaskPool::FreeBlock* TaskPool::takeBlocks(size_t& nbBlocks)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    if(0 == mFreeBlocks)
+    {
+        //out of blocks, carve up a new chunk
+        char* chunk = new char[mBlockSize * mBlocksPerChunk];
+        mChunks.push_back(chunk);
+        for(size_t blockIdx = 0; blockIdx < mBlocksPerChunk; ++blockIdx)
+        {
+            FreeBlock* block = reinterpret_cast<FreeBlock*>(chunk + blockIdx * mBlockSize);
+            block->next = mFreeBlocks;
+            mFreeBlocks = block;
+        }
+    }
+
+    FreeBlock* first = mFreeBlocks;
+    FreeBlock* last = first;
+    size_t nbTaken = 1;
+    while(nbTaken < nbBlocks && 0 != last->next)
+    {
+        last = last->next;
+        ++nbTaken;
+    }
+    mFreeBlocks = last->next;
+    last->next = 0;
+
+    nbBlocks = nbTaken;
+    return first;
+}
+
+//------------------------------------------------------------------------------
+void TaskPool::giveBlocks(FreeBlock* first, FreeBlock* last)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    last->next = mFreeBlocks;
+    mFreeBlocks = first;
+}
+
+}
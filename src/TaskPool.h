@@ -0,0 +1,64 @@
+#pragma once
+#include "Platform.h"
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace workers {
+
+//Fixed size blocks carved out of larger chunks, recycled through free lists instead of going back to the heap.
+//Every thread keeps a cache of free blocks, only going to the shared list once per batch, so tasks made and freed
+//on the same thread never contend. Requests bigger than a block fall back to the heap.
+//Any thread may hold blocks of a pool in its cache until it exits, so pools are never destroyed: make them with new
+//and keep them for the life of the process
+class EXAMPLES_LIB_API TaskPool {
+public:
+    //blocks moved between a thread's cache and the shared list at once
+    static const size_t BATCH_SIZE = 32;
+
+    TaskPool(const size_t blockSize, const size_t blocksPerChunk = 64);
+
+    void* allocate(const size_t size);
+    void deallocate(void* block, const size_t size);
+    //Give every block the calling thread cached, for any pool, back to the shared lists, so other threads can
+    //have them. For threads about to sit idle
+    static void flushThreadCache();
+
+    inline const size_t getBlockSize() const;
+private:
+    //never defined, see above
+    ~TaskPool();
+    TaskPool(const TaskPool&);
+    TaskPool& operator=(const TaskPool&);
+
+    //a block while it sits in a free list
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    //free blocks a thread holds for each pool it uses
+    class ThreadCache;
+    static ThreadCache& getThreadCache();
+
+    //take up to BATCH_SIZE blocks from the shared list, carving a new chunk if it is empty
+    FreeBlock* takeBlocks(size_t& nbBlocks);
+    //give a chain of blocks back to the shared list
+    void giveBlocks(FreeBlock* first, FreeBlock* last);
+
+    size_t mBlockSize;
+    size_t mBlocksPerChunk;
+    //guards the shared list and chunks
+    std::mutex mMutex;
+    FreeBlock* mFreeBlocks;
+    std::vector<char*> mChunks;
+};
+
+//inline implementations
+//------------------------------------------------------------------------------
+const size_t TaskPool::getBlockSize() const
+{
+    return mBlockSize;
+}
+
+}
@@ -0,0 +1,287 @@
+#include "TaskTrace.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <vector>
+
+namespace workers {
+
+//an event as kept in a ring
+struct TraceRecord {
+    //steady_clock ticks
+    int64_t time;
+    const Task* task;
+    size_t workerId;
+    TraceEvent event;
+};
+
+//ring of the latest events recorded by one thread. Rings are never freed, so events outlive their thread,
+//and a ring whose thread ended is taken over by the next thread needing one
+struct TraceBuffer {
+    TraceBuffer(const size_t index) : records(TaskTrace::BUFFER_SIZE), nbWritten(0), generation(0), isOwned(true), index(index), next(0)
+    {
+
+    }
+
+    std::vector<TraceRecord> records;
+    //events ever written since the ring was last cleared, the latest BUFFER_SIZE of which are kept
+    std::atomic<uint64_t> nbWritten;
+    //tracing session our events belong to
+    std::atomic<uint64_t> generation;
+    std::atomic<bool> isOwned;
+    //lane of the trace our events go in
+    size_t index;
+    TraceBuffer* next;
+};
+
+//gives up the calling thread's ring as the thread ends
+struct TraceBufferOwner {
+    TraceBufferOwner() : buffer(0)
+    {
+
+    }
+
+    ~TraceBufferOwner()
+    {
+        if(0 != buffer)
+        {
+            buffer->isOwned.store(false, std::memory_order_release);
+        }
+    }
+
+    TraceBuffer* buffer;
+};
+
+//span of a task's life being put together while writing
+struct TraceSpan {
+    TraceSpan() : hasSubmit(false), hasDequeue(false), hasStart(false)
+    {
+
+    }
+
+    bool hasSubmit;
+    int64_t submitTime;
+    size_t submitThread;
+    bool hasDequeue;
+    int64_t dequeueTime;
+    bool hasStart;
+    int64_t startTime;
+};
+
+//event taken from a ring, with the lane it goes in
+struct TracedEvent {
+    TraceRecord record;
+    size_t threadIdx;
+};
+
+std::atomic<bool> TaskTrace::sIsEnabled(false);
+
+//every ring ever created, only ever pushed to
+static std::atomic<TraceBuffer*> sTraceBuffers(0);
+static std::atomic<size_t> sNbTraceBuffers(0);
+//bumped by every start, rings of an older session are cleared before being written again
+static std::atomic<uint64_t> sTraceGeneration(0);
+static thread_local TraceBufferOwner tlsTraceBuffer;
+
+//------------------------------------------------------------------------------
+static TraceBuffer* getTraceBuffer()
+{
+    if(0 != tlsTraceBuffer.buffer)
+    {
+        return tlsTraceBuffer.buffer;
+    }
+
+    //take over the ring of a thread that ended, else add one
+    TraceBuffer* buffer = sTraceBuffers.load(std::memory_order_acquire);
+    for(; 0 != buffer; buffer = buffer->next)
+    {
+        bool isOwned = false;
+        if(!buffer->isOwned.load(std::memory_order_relaxed) && buffer->isOwned.compare_exchange_strong(isOwned, true, std::memory_order_acquire))
+        {
+            break;
+        }
+    }
+
+    if(0 == buffer)
+    {
+        buffer = new TraceBuffer(sNbTraceBuffers.fetch_add(1));
+        buffer->next = sTraceBuffers.load(std::memory_order_relaxed);
+        while(!sTraceBuffers.compare_exchange_weak(buffer->next, buffer, std::memory_order_release, std::memory_order_relaxed))
+        {
+
+        }
+    }
+
+    tlsTraceBuffer.buffer = buffer;
+    return buffer;
+}
+
+//------------------------------------------------------------------------------
+static void writeSeparator(std::ostream& stream, bool& isFirst)
+{
+    stream << (isFirst ? "\n" : ",\n");
+    isFirst = false;
+}
+
+//------------------------------------------------------------------------------
+static double getMicroseconds(const int64_t time, const int64_t origin)
+{
+    return std::chrono::duration_cast< std::chrono::duration<double, std::micro> >(std::chrono::steady_clock::duration(time - origin)).count();
+}
+
+//------------------------------------------------------------------------------
+static void writeSpan(std::ostream& stream, bool& isFirst, const char* name, const uint64_t id, const size_t threadIdx, const double begin, const double end)
+{
+    //async spans, as the spans of different tasks overlap on the same thread
+    writeSeparator(stream, isFirst);
+    stream << "{\"name\": \"" << name << "\", \"cat\": \"task\", \"ph\": \"b\", \"id\": " << id << ", \"pid\": 1, \"tid\": " << threadIdx << ", \"ts\": " << begin << "}";
+    writeSeparator(stream, isFirst);
+    stream << "{\"name\": \"" << name << "\", \"cat\": \"task\", \"ph\": \"e\", \"id\": " << id << ", \"pid\": 1, \"tid\": " << threadIdx << ", \"ts\": " << end << "}";
+}
+
+//------------------------------------------------------------------------------
+static bool isEarlier(const TracedEvent& a, const TracedEvent& b)
+{
+    return a.record.time < b.record.time;
+}
+
+//------------------------------------------------------------------------------
+void TaskTrace::start()
+{
+    sTraceGeneration.fetch_add(1);
+    sIsEnabled = true;
+}
+
+//------------------------------------------------------------------------------
+void TaskTrace::stop()
+{
+    sIsEnabled = false;
+}
+
+//------------------------------------------------------------------------------
+void TaskTrace::record(const TraceEvent event, const Task* task, const size_t workerId, const std::chrono::steady_clock::time_point time)
+{
+    TraceBuffer* buffer = getTraceBuffer();
+
+    //only we write to our ring, a plain load and store is enough
+    uint64_t nbWritten = buffer->nbWritten.load(std::memory_order_relaxed);
+    const uint64_t generation = sTraceGeneration.load(std::memory_order_relaxed);
+    if(buffer->generation.load(std::memory_order_relaxed) != generation)
+    {
+        nbWritten = 0;
+        buffer->generation.store(generation, std::memory_order_relaxed);
+    }
+
+    TraceRecord& record = buffer->records[nbWritten & (BUFFER_SIZE - 1)];
+    record.time = time.time_since_epoch().count();
+    record.task = task;
+    record.workerId = workerId;
+    record.event = event;
+    buffer->nbWritten.store(nbWritten + 1, std::memory_order_release);
+}
+
+//------------------------------------------------------------------------------
+bool TaskTrace::write(std::ostream& stream)
+{
+    //gather the events of this session from every ring, in the order they happened
+    std::vector<TracedEvent> events;
+    const uint64_t generation = sTraceGeneration.load();
+    for(TraceBuffer* buffer = sTraceBuffers.load(std::memory_order_acquire); 0 != buffer; buffer = buffer->next)
+    {
+        const uint64_t nbWritten = buffer->nbWritten.load(std::memory_order_acquire);
+        if(buffer->generation.load(std::memory_order_relaxed) != generation)
+        {
+            continue;
+        }
+
+        for(uint64_t recordIdx = (nbWritten > BUFFER_SIZE) ? nbWritten - BUFFER_SIZE : 0; recordIdx < nbWritten; ++recordIdx)
+        {
+            TracedEvent traced;
+            traced.record = buffer->records[recordIdx & (BUFFER_SIZE - 1)];
+            traced.threadIdx = buffer->index;
+            events.push_back(traced);
+        }
+    }
+    std::stable_sort(events.begin(), events.end(), isEarlier);
+
+    const int64_t origin = events.empty() ? 0 : events.front().record.time;
+    std::map<const Task*, TraceSpan> spans;
+    //worker last seen running on each lane, to name it
+    std::map<size_t, size_t> laneWorkers;
+    uint64_t nbSpans = 0;
+    bool isFirst = true;
+
+    stream << "[" << std::fixed << std::setprecision(3);
+    for(std::vector<TracedEvent>::const_iterator traced = events.begin(); traced != events.end(); ++traced)
+    {
+        const TraceRecord& record = traced->record;
+        TraceSpan& span = spans[record.task];
+        switch(record.event)
+        {
+        case TraceEvent::SUBMIT:
+            span = TraceSpan();
+            span.hasSubmit = true;
+            span.submitTime = record.time;
+            span.submitThread = traced->threadIdx;
+            break;
+        case TraceEvent::DEQUEUE:
+            span.hasDequeue = true;
+            span.dequeueTime = record.time;
+            break;
+        case TraceEvent::START:
+            //time spent in the queue, then being handed over to the worker, up to the start
+            if(span.hasSubmit)
+            {
+                writeSpan(stream, isFirst, "queued", ++nbSpans, span.submitThread, getMicroseconds(span.submitTime, origin),
+                    getMicroseconds(span.hasDequeue ? span.dequeueTime : record.time, origin));
+            }
+            if(span.hasDequeue)
+            {
+                writeSpan(stream, isFirst, "handoff", ++nbSpans, traced->threadIdx, getMicroseconds(span.dequeueTime, origin), getMicroseconds(record.time, origin));
+            }
+            span.hasStart = true;
+            span.startTime = record.time;
+            if(NO_WORKER != record.workerId)
+            {
+                laneWorkers[traced->threadIdx] = record.workerId;
+            }
+            break;
+        case TraceEvent::END:
+            //the start may have been overwritten in its ring, or recorded before tracing started
+            if(span.hasStart)
+            {
+                writeSeparator(stream, isFirst);
+                stream << "{\"name\": \"task\", \"cat\": \"task\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << traced->threadIdx << ", \"ts\": " << getMicroseconds(span.startTime, origin)
+                    << ", \"dur\": " << getMicroseconds(record.time, span.startTime) << ", \"args\": {\"task\": \"" << record.task << "\"";
+                if(NO_WORKER != record.workerId)
+                {
+                    stream << ", \"worker\": " << record.workerId;
+                }
+                stream << "}}";
+            }
+            spans.erase(record.task);
+            break;
+        }
+    }
+
+    for(std::map<size_t, size_t>::const_iterator lane = laneWorkers.begin(); lane != laneWorkers.end(); ++lane)
+    {
+        writeSeparator(stream, isFirst);
+        stream << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << lane->first << ", \"args\": {\"name\": \"worker " << lane->second << "\"}}";
+    }
+    stream << "\n]\n";
+    return !stream.fail();
+}
+
+//------------------------------------------------------------------------------
+bool TaskTrace::write(const std::string& path)
+{
+    std::ofstream file(path.c_str());
+    return write(file);
+}
+
+}
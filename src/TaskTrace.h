@@ -0,0 +1,59 @@
+#pragma once
+#include "Platform.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+
+namespace workers {
+
+class Task;
+
+//Moments of a task's life that are traced
+enum class TraceEvent {
+    //given to a manager to run
+    SUBMIT,
+    //handed to a worker, after waiting in whichever queue it was kept in
+    DEQUEUE,
+    //started and finished running on the worker
+    START,
+    END
+};
+
+//Optional tracing of every task's life, written out as a Chrome trace event file, which chrome://tracing and
+//Perfetto show as a timeline: how long each task was queued, how long the handoff to its worker took and how
+//long it ran, with a lane per thread. Each thread records into a ring of its own, so recording takes no lock
+//and only the latest events of a thread are kept. While tracing is off, recording costs a single branch
+class EXAMPLES_LIB_API TaskTrace {
+public:
+    //events each thread keeps
+    static const size_t BUFFER_SIZE = 65536;
+    //worker id of events not recorded for a worker
+    static const size_t NO_WORKER = static_cast<size_t>(-1);
+
+    //Start tracing, forgetting whatever was traced before
+    static void start();
+    static void stop();
+    inline static bool isEnabled();
+
+    //Record an event for a task on the calling thread's ring, allocated by the thread's first event. Only call while enabled
+    static void record(const TraceEvent event, const Task* task, const size_t workerId, const std::chrono::steady_clock::time_point time);
+
+    //Write out every event kept since tracing last started as a trace event JSON array. Events recorded while
+    //writing may be torn, so stop tracing and let the traced tasks finish first. False if the stream failed
+    static bool write(std::ostream& stream);
+    static bool write(const std::string& path);
+private:
+    static std::atomic<bool> sIsEnabled;
+};
+
+//inline implementations
+//------------------------------------------------------------------------------
+bool TaskTrace::isEnabled()
+{
+    return sIsEnabled.load(std::memory_order_relaxed);
+}
+
+}
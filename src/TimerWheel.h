@@ -0,0 +1,352 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace workers {
+
+//Identifies a timer in a TimerWheel, stays safe to use once the timer has fired or been cancelled
+struct TimerId {
+    inline TimerId() : index(0xFFFFFFFF), generation(0) {}
+
+    uint32_t index;
+    uint32_t generation;
+};
+
+//Hierarchical timing wheel. Levels of 64 slots each cover 64 times the span of the level below, timers are
+//placed in the level matching how far away they are and move down a level as time gets closer to them.
+//Adding and cancelling take constant time however many timers are pending. Not thread safe, time is counted
+//in ticks whose length is up to the owner
+template<typename T>
+class TimerWheel {
+public:
+    static const size_t NB_LEVELS = 4;
+    static const size_t SLOT_BITS = 6;
+    static const size_t NB_SLOTS = size_t(1) << SLOT_BITS;
+
+    explicit TimerWheel(const uint64_t currentTick = 0);
+
+    //Add a timer firing at expiryTick, then every period ticks if period is not 0.
+    //Timers already due fire on the next advance
+    TimerId add(const uint64_t expiryTick, T value, const uint64_t period = 0);
+    //Remove a timer, handing back its value. False if it already fired for the last time or was cancelled
+    bool cancel(const TimerId id, T& value);
+    //Move time forward to tick, adding the values of timers that fired to expired. Periodic timers hand out a copy,
+    //once per call however many of their periods it covers
+    void advance(const uint64_t tick, std::vector<T>& expired);
+    //Remove every timer, adding their values to values
+    void clear(std::vector<T>& values);
+
+    //Earliest tick at which advancing can do anything, never later than the next timer fires. UINT64_MAX if empty
+    uint64_t getNextTick() const;
+    inline uint64_t getCurrentTick() const;
+    inline size_t size() const;
+    inline bool empty() const;
+private:
+    static const uint32_t NO_NODE = 0xFFFFFFFF;
+
+    struct Node {
+        uint64_t expiry;
+        uint64_t period;
+        T value;
+        uint32_t generation;
+        uint32_t prev;
+        uint32_t next;
+        unsigned char level;
+        unsigned char slot;
+        bool isActive;
+    };
+
+    //put a node in the slot matching its expiry, or the one for earliestTick if it is already due
+    void link(const uint32_t nodeIdx, const uint64_t earliestTick);
+    void unlink(const uint32_t nodeIdx);
+    //back to the free list, making any id for it stale
+    void release(const uint32_t nodeIdx);
+    //move every node of a slot down to where it now belongs
+    void cascade(const size_t level, const size_t slot);
+
+    //nodes are referred to by index, so growing never invalidates them
+    std::vector<Node> mNodes;
+    std::vector<uint32_t> mFreeNodes;
+    uint32_t mSlots[NB_LEVELS][NB_SLOTS];
+    size_t mLevelSizes[NB_LEVELS];
+    uint64_t mCurrentTick;
+    size_t mSize;
+};
+
+//template implementations
+//------------------------------------------------------------------------------
+template<typename T>
+TimerWheel<T>::TimerWheel(const uint64_t currentTick) : mCurrentTick(currentTick), mSize(0)
+{
+    for(size_t level = 0; level < NB_LEVELS; ++level)
+    {
+        mLevelSizes[level] = 0;
+        for(size_t slot = 0; slot < NB_SLOTS; ++slot)
+        {
+            mSlots[level][slot] = NO_NODE;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+TimerId TimerWheel<T>::add(const uint64_t expiryTick, T value, const uint64_t period)
+{
+    uint32_t nodeIdx = 0;
+    if(mFreeNodes.empty())
+    {
+        nodeIdx = static_cast<uint32_t>(mNodes.size());
+        Node node = Node();
+        mNodes.push_back(std::move(node));
+    }
+    else
+    {
+        nodeIdx = mFreeNodes.back();
+        mFreeNodes.pop_back();
+    }
+
+    Node& node = mNodes[nodeIdx];
+    node.expiry = expiryTick;
+    node.period = period;
+    node.value = std::move(value);
+    node.isActive = true;
+    link(nodeIdx, mCurrentTick + 1);
+    ++mSize;
+
+    TimerId id;
+    id.index = nodeIdx;
+    id.generation = node.generation;
+    return id;
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+bool TimerWheel<T>::cancel(const TimerId id, T& value)
+{
+    if(id.index >= mNodes.size() || !mNodes[id.index].isActive || mNodes[id.index].generation != id.generation)
+    {
+        return false;
+    }
+
+    unlink(id.index);
+    value = std::move(mNodes[id.index].value);
+    release(id.index);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+void TimerWheel<T>::advance(const uint64_t tick, std::vector<T>& expired)
+{
+    while(mCurrentTick < tick)
+    {
+        if(0 == mLevelSizes[0])
+        {
+            //nothing can fire before the lowest non-empty level cascades, skip straight there
+            uint64_t next = tick;
+            for(size_t level = 1; level < NB_LEVELS; ++level)
+            {
+                if(0 != mLevelSizes[level])
+                {
+                    const size_t shift = level * SLOT_BITS;
+                    next = ((mCurrentTick >> shift) + 1) << shift;
+                    break;
+                }
+            }
+            if(next >= tick)
+            {
+                mCurrentTick = tick - 1;
+            }
+            else
+            {
+                mCurrentTick = next - 1;
+            }
+        }
+
+        ++mCurrentTick;
+
+        //bring down the timers of each level whose slot we just reached
+        for(size_t level = 1; level < NB_LEVELS; ++level)
+        {
+            const size_t shift = level * SLOT_BITS;
+            if(0 != (mCurrentTick & ((uint64_t(1) << shift) - 1)))
+            {
+                break;
+            }
+            cascade(level, static_cast<size_t>((mCurrentTick >> shift) & (NB_SLOTS - 1)));
+        }
+
+        const size_t slot = static_cast<size_t>(mCurrentTick & (NB_SLOTS - 1));
+        while(NO_NODE != mSlots[0][slot])
+        {
+            const uint32_t nodeIdx = mSlots[0][slot];
+            Node& node = mNodes[nodeIdx];
+            unlink(nodeIdx);
+
+            if(0 == node.period)
+            {
+                expired.push_back(std::move(node.value));
+                release(nodeIdx);
+            }
+            else
+            {
+                expired.push_back(node.value);
+                //fire once however many periods we are moving past, rather than all at once
+                while(node.expiry <= tick)
+                {
+                    node.expiry += node.period;
+                }
+                link(nodeIdx, mCurrentTick + 1);
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+void TimerWheel<T>::clear(std::vector<T>& values)
+{
+    for(uint32_t nodeIdx = 0; nodeIdx < mNodes.size(); ++nodeIdx)
+    {
+        if(mNodes[nodeIdx].isActive)
+        {
+            unlink(nodeIdx);
+            values.push_back(std::move(mNodes[nodeIdx].value));
+            release(nodeIdx);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+uint64_t TimerWheel<T>::getNextTick() const
+{
+    if(0 != mLevelSizes[0])
+    {
+        for(uint64_t tick = mCurrentTick + 1; tick <= mCurrentTick + NB_SLOTS; ++tick)
+        {
+            if(NO_NODE != mSlots[0][tick & (NB_SLOTS - 1)])
+            {
+                return tick;
+            }
+        }
+    }
+
+    for(size_t level = 1; level < NB_LEVELS; ++level)
+    {
+        if(0 != mLevelSizes[level])
+        {
+            const size_t shift = level * SLOT_BITS;
+            return ((mCurrentTick >> shift) + 1) << shift;
+        }
+    }
+    return UINT64_MAX;
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+void TimerWheel<T>::link(const uint32_t nodeIdx, const uint64_t earliestTick)
+{
+    Node& node = mNodes[nodeIdx];
+
+    const uint64_t expiry = (node.expiry > earliestTick) ? node.expiry : earliestTick;
+    const uint64_t delta = expiry - mCurrentTick;
+
+    size_t level = 0;
+    while(level < NB_LEVELS - 1 && delta >= (uint64_t(1) << ((level + 1) * SLOT_BITS)))
+    {
+        ++level;
+    }
+
+    //beyond the top level, park in its furthest slot and get placed again when it cascades
+    const uint64_t maxDelta = (uint64_t(1) << (NB_LEVELS * SLOT_BITS)) - 1;
+    const uint64_t placement = (delta > maxDelta) ? mCurrentTick + maxDelta : expiry;
+    const size_t slot = static_cast<size_t>((placement >> (level * SLOT_BITS)) & (NB_SLOTS - 1));
+
+    node.level = static_cast<unsigned char>(level);
+    node.slot = static_cast<unsigned char>(slot);
+    node.prev = NO_NODE;
+    node.next = mSlots[level][slot];
+    if(NO_NODE != node.next)
+    {
+        mNodes[node.next].prev = nodeIdx;
+    }
+    mSlots[level][slot] = nodeIdx;
+    ++mLevelSizes[level];
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+void TimerWheel<T>::unlink(const uint32_t nodeIdx)
+{
+    Node& node = mNodes[nodeIdx];
+
+    if(NO_NODE != node.prev)
+    {
+        mNodes[node.prev].next = node.next;
+    }
+    else
+    {
+        mSlots[node.level][node.slot] = node.next;
+    }
+    if(NO_NODE != node.next)
+    {
+        mNodes[node.next].prev = node.prev;
+    }
+    --mLevelSizes[node.level];
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+void TimerWheel<T>::release(const uint32_t nodeIdx)
+{
+    Node& node = mNodes[nodeIdx];
+    node.value = T();
+    node.isActive = false;
+    ++node.generation;
+    mFreeNodes.push_back(nodeIdx);
+    --mSize;
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+void TimerWheel<T>::cascade(const size_t level, const size_t slot)
+{
+    uint32_t nodeIdx = mSlots[level][slot];
+    mSlots[level][slot] = NO_NODE;
+
+    while(NO_NODE != nodeIdx)
+    {
+        const uint32_t next = mNodes[nodeIdx].next;
+        --mLevelSizes[level];
+        //cascading comes before the current tick's slot fires, so timers due now still make it
+        link(nodeIdx, mCurrentTick);
+        nodeIdx = next;
+    }
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+uint64_t TimerWheel<T>::getCurrentTick() const
+{
+    return mCurrentTick;
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+size_t TimerWheel<T>::size() const
+{
+    return mSize;
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+bool TimerWheel<T>::empty() const
+{
+    return 0 == mSize;
+}
+
+}
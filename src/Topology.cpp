@@ -0,0 +1,177 @@
+#include "Topology.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace workers {
+
+//------------------------------------------------------------------------------
+Topology::Topology()
+{
+
+}
+
+//------------------------------------------------------------------------------
+Topology Topology::read()
+{
+    Topology topology;
+
+#if defined(__linux__)
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    const bool hasAllowed = (0 == sched_getaffinity(0, sizeof(allowed), &allowed));
+
+    std::ifstream onlineFile("/sys/devices/system/node/online");
+    std::string online;
+    if(std::getline(onlineFile, online))
+    {
+        const std::vector<int> nodes = parseCpuList(online);
+        for(std::vector<int>::const_iterator node = nodes.begin(); node != nodes.end(); ++node)
+        {
+            std::ostringstream path;
+            path << "/sys/devices/system/node/node" << (*node) << "/cpulist";
+            std::ifstream cpuFile(path.str().c_str());
+            std::string list;
+            if(!std::getline(cpuFile, list))
+            {
+                continue;
+            }
+
+            //containers and taskset may keep us off some of them
+            std::vector<int> cpus;
+            const std::vector<int> nodeCpus = parseCpuList(list);
+            for(std::vector<int>::const_iterator cpu = nodeCpus.begin(); cpu != nodeCpus.end(); ++cpu)
+            {
+                if(!hasAllowed || (*cpu < CPU_SETSIZE && CPU_ISSET(*cpu, &allowed)))
+                {
+                    cpus.push_back(*cpu);
+                }
+            }
+            if(!cpus.empty())
+            {
+                topology.addNode(cpus);
+            }
+        }
+    }
+#endif
+
+    if(0 == topology.getNbNodes())
+    {
+        std::vector<int> cpus;
+        const int nbCpus = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        for(int cpu = 0; cpu < nbCpus; ++cpu)
+        {
+            cpus.push_back(cpu);
+        }
+        topology.addNode(cpus);
+    }
+    return topology;
+}
+
+//------------------------------------------------------------------------------
+std::vector<int> Topology::parseCpuList(const std::string& list)
+{
+    std::vector<int> cpus;
+    std::istringstream stream(list);
+    std::string range;
+
+    while(std::getline(stream, range, ','))
+    {
+        const char* begin = range.c_str();
+        char* end = 0;
+        const long first = std::strtol(begin, &end, 10);
+        if(end == begin || first < 0)
+        {
+            continue;
+        }
+
+        long last = first;
+        if('-' == *end)
+        {
+            begin = end + 1;
+            last = std::strtol(begin, &end, 10);
+            if(end == begin || last < first)
+            {
+                continue;
+            }
+        }
+
+        for(long cpu = first; cpu <= last; ++cpu)
+        {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+    }
+    return cpus;
+}
+
+//------------------------------------------------------------------------------
+bool Topology::setThreadAffinity(const std::vector<int>& cpus)
+{
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for(std::vector<int>::const_iterator cpu = cpus.begin(); cpu != cpus.end(); ++cpu)
+    {
+        if(*cpu >= 0 && *cpu < CPU_SETSIZE)
+        {
+            CPU_SET(*cpu, &set);
+        }
+    }
+    return 0 != CPU_COUNT(&set) && 0 == pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    return false;
+#endif
+}
+
+//------------------------------------------------------------------------------
+int Topology::getCurrentCpu()
+{
+#if defined(__linux__)
+    return sched_getcpu();
+#else
+    return -1;
+#endif
+}
+
+//------------------------------------------------------------------------------
+void Topology::addNode(const std::vector<int>& cpus)
+{
+    mNodes.push_back(cpus);
+}
+
+//------------------------------------------------------------------------------
+int Topology::getNode(const int cpu) const
+{
+    for(size_t node = 0; node < mNodes.size(); ++node)
+    {
+        for(std::vector<int>::const_iterator nodeCpu = mNodes[node].begin(); nodeCpu != mNodes[node].end(); ++nodeCpu)
+        {
+            if(*nodeCpu == cpu)
+            {
+                return static_cast<int>(node);
+            }
+        }
+    }
+    return -1;
+}
+
+//------------------------------------------------------------------------------
+size_t Topology::getNbCpus() const
+{
+    size_t nbCpus = 0;
+    for(size_t node = 0; node < mNodes.size(); ++node)
+    {
+        nbCpus += mNodes[node].size();
+    }
+    return nbCpus;
+}
+
+}
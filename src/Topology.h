@@ -0,0 +1,48 @@
+#pragma once
+#include "Platform.h"
+
+#include <string>
+#include <vector>
+
+namespace workers {
+
+//Processors of the machine grouped by NUMA node, as read from sysfs. Nodes are numbered from 0 in the order they were added
+class EXAMPLES_LIB_API Topology {
+public:
+    //Empty topology, add nodes to it or use read
+    Topology();
+
+    //Topology of this machine, limited to the processors we are allowed to run on.
+    //Falls back to a single node holding every processor where sysfs is not available
+    static Topology read();
+    //Parse a sysfs cpu list such as "0-3,8,10-11", skipping anything malformed
+    static std::vector<int> parseCpuList(const std::string& list);
+    //Pin the calling thread to the given processors, false if that failed or is not supported here
+    static bool setThreadAffinity(const std::vector<int>& cpus);
+    //Processor the calling thread is running on, -1 if not known
+    static int getCurrentCpu();
+
+    void addNode(const std::vector<int>& cpus);
+    inline size_t getNbNodes() const;
+    inline const std::vector<int>& getCpus(const size_t node) const;
+    //Node a processor belongs to, -1 if it is not in any
+    int getNode(const int cpu) const;
+    size_t getNbCpus() const;
+private:
+    std::vector< std::vector<int> > mNodes;
+};
+
+//inline implementations
+//------------------------------------------------------------------------------
+size_t Topology::getNbNodes() const
+{
+    return mNodes.size();
+}
+
+//------------------------------------------------------------------------------
+const std::vector<int>& Topology::getCpus(const size_t node) const
+{
+    return mNodes[node];
+}
+
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace workers {
+
+//Chase-Lev work stealing deque. The owning thread pushes and pops at the bottom (LIFO),
+//any other thread may steal from the top (FIFO). Elements must be trivially copyable (pointers).
+//Buffers grow as needed, old buffers are kept until destruction since a thief may still be reading them
+template<typename T>
+class WorkStealingDeque {
+public:
+    WorkStealingDeque(const size_t initialCapacity = 64);
+    ~WorkStealingDeque();
+
+    //Owner only: add a value at the bottom of the deque
+    void push(T value);
+    //Owner only: take the most recently pushed value, false if deque is empty
+    bool pop(T& value);
+    //Any thread: take the oldest value, false if deque is empty or another thread took it first
+    bool steal(T& value);
+
+    //Approximate number of values in the deque
+    inline size_t size() const;
+    inline bool empty() const;
+private:
+    WorkStealingDeque(const WorkStealingDeque&);
+    WorkStealingDeque& operator=(const WorkStealingDeque&);
+
+    //circular array of values, capacity is always a power of 2
+    class Buffer {
+    public:
+        Buffer(const size_t capacity) : mMask(capacity - 1), mValues(new std::atomic<T>[capacity]) {}
+        ~Buffer() { delete[] mValues; }
+
+        inline size_t capacity() const { return mMask + 1; }
+        inline T get(const std::ptrdiff_t idx) const { return mValues[idx & mMask].load(std::memory_order_relaxed); }
+        inline void put(const std::ptrdiff_t idx, T value) { mValues[idx & mMask].store(value, std::memory_order_relaxed); }
+
+        //copy values in [top, bottom) into a buffer twice our size
+        Buffer* grow(const std::ptrdiff_t top, const std::ptrdiff_t bottom) const
+        {
+            Buffer* buffer = new Buffer(capacity() * 2);
+            for(std::ptrdiff_t idx = top; idx < bottom; ++idx)
+            {
+                buffer->put(idx, get(idx));
+            }
+            return buffer;
+        }
+    private:
+        size_t mMask;
+        std::atomic<T>* mValues;
+    };
+
+    //top is written by thieves, bottom only by the owner, keep them on separate cache lines
+    std::atomic<std::ptrdiff_t> mTop;
+    char mTopPadding[64 - sizeof(std::atomic<std::ptrdiff_t>)];
+    std::atomic<std::ptrdiff_t> mBottom;
+    std::atomic<Buffer*> mBuffer;
+    //buffers replaced by a grow, owner only
+    std::vector<Buffer*> mRetiredBuffers;
+};
+
+//template implementations
+//------------------------------------------------------------------------------
+template<typename T>
+WorkStealingDeque<T>::WorkStealingDeque(const size_t initialCapacity) : mTop(0), mBottom(0)
+{
+    size_t capacity = 1;
+    while(capacity < initialCapacity)
+    {
+        capacity <<= 1;
+    }
+    mBuffer.store(new Buffer(capacity), std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+WorkStealingDeque<T>::~WorkStealingDeque()
+{
+    delete mBuffer.load(std::memory_order_relaxed);
+
+    for(typename std::vector<Buffer*>::iterator buffer = mRetiredBuffers.begin(); buffer != mRetiredBuffers.end(); ++buffer)
+    {
+        delete (*buffer);
+    }
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+void WorkStealingDeque<T>::push(T value)
+{
+    const std::ptrdiff_t bottom = mBottom.load(std::memory_order_relaxed);
+    const std::ptrdiff_t top = mTop.load(std::memory_order_acquire);
+    Buffer* buffer = mBuffer.load(std::memory_order_relaxed);
+
+    if(bottom - top > static_cast<std::ptrdiff_t>(buffer->capacity()) - 1)
+    {
+        mRetiredBuffers.push_back(buffer);
+        buffer = buffer->grow(top, bottom);
+        mBuffer.store(buffer, std::memory_order_release);
+    }
+
+    buffer->put(bottom, value);
+    //publishes the value, and whatever the caller wrote before pushing, to thieves
+    mBottom.store(bottom + 1, std::memory_order_release);
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+bool WorkStealingDeque<T>::pop(T& value)
+{
+    const std::ptrdiff_t bottom = mBottom.load(std::memory_order_relaxed) - 1;
+    Buffer* buffer = mBuffer.load(std::memory_order_relaxed);
+    mBottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::ptrdiff_t top = mTop.load(std::memory_order_relaxed);
+
+    if(top > bottom)
+    {
+        //deque was empty, restore bottom
+        mBottom.store(bottom + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    value = buffer->get(bottom);
+    if(top != bottom)
+    {
+        //more than one value left, no thief can reach this one
+        return true;
+    }
+
+    //last value, race against thieves for it
+    const bool won = mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    mBottom.store(bottom + 1, std::memory_order_relaxed);
+    return won;
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+bool WorkStealingDeque<T>::steal(T& value)
+{
+    std::ptrdiff_t top = mTop.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const std::ptrdiff_t bottom = mBottom.load(std::memory_order_acquire);
+
+    if(top >= bottom)
+    {
+        return false;
+    }
+
+    Buffer* buffer = mBuffer.load(std::memory_order_acquire);
+    T stolen = buffer->get(top);
+    if(!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+        return false;
+    }
+
+    value = stolen;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+size_t WorkStealingDeque<T>::size() const
+{
+    const std::ptrdiff_t bottom = mBottom.load(std::memory_order_relaxed);
+    const std::ptrdiff_t top = mTop.load(std::memory_order_relaxed);
+    return (bottom > top) ? static_cast<size_t>(bottom - top) : 0;
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+bool WorkStealingDeque<T>::empty() const
+{
+    return 0 == size();
+}
+
+}
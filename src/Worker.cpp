@@ -1,11 +1,22 @@
 #include "Worker.h"
 #include "Task.h"
+#include "AtomicWait.h"
+#include "TaskTrace.h"
+#include "TaskPool.h"
+
+#include <algorithm>
 
 namespace workers {
 
+//worker running on this thread, set when the worker thread starts
+static thread_local Worker* tlsCurrentWorker = 0;
+
 //------------------------------------------------------------------------------
-Worker::Worker(std::function<void (Worker*)> taskCompleteFunction) : mShutdown(false), mTaskCompleteFunction(taskCompleteFunction), mHasTask(false)
+Worker::Worker(std::function<void (Worker*)> taskCompleteFunction, const size_t id, std::function<void (Worker*)> startFunction, const WaitStrategy& waitStrategy) :
+    mNextTask(0), mSignal(EMPTY), mWaitStrategy(waitStrategy), mSpinBudget(waitStrategy.maxSpins), mTaskCompleteFunction(taskCompleteFunction),
+    mStartFunction(startFunction), mShutdown(false), mId(id), mNbTasks(0), mNbSteals(0), mBusyTime(0), mIdleTime(0)
 {
+    mPriorToCompleteFunction = [this]()->void { this->mTaskCompleteFunction(this); };
     mReadyForWorkFuture = mReadyForWorkPromise.get_future();
     mThread = std::unique_ptr<std::thread>(new std::thread(std::bind(&Worker::run, this)));
 }
@@ -23,66 +34,184 @@ void Worker::shutdown()
     
     if(wasShutdown)
     {
-        {
-            std::unique_lock<std::mutex> lock(mMutex);
-
-            mHasTask = true;
-        }
-        mWaitingForTask.notify_all();
+        signal();
         mThread->join();
-    }
 
-    if(0 != mRunningTask)
-    {
-        mRunningTask->setCompletionStatus(false);
+        //a task handed over as we were stopping will not be run
+        TaskHandle task = TaskHandle::adopt(mNextTask.exchange(0));
+        if(task)
+        {
+            task->setCompletionStatus(false);
+        }
     }
 }
 
 //------------------------------------------------------------------------------
 void Worker::runTask(std::shared_ptr<Task> task)
 {
-    if(!isShutdown())
+    runTask(TaskHandle(task));
+}
+
+//------------------------------------------------------------------------------
+void Worker::runTask(TaskHandle task)
+{
+    if(isShutdown())
     {
+        if(task)
         {
-            std::unique_lock<std::mutex> lock(mMutex);
-
-            mRunningTask = task;
-            mHasTask = true;
+            task->setCompletionStatus(false);
         }
+        return;
+    }
+
+    if(TaskTrace::isEnabled())
+    {
+        TaskTrace::record(TraceEvent::DEQUEUE, task.get(), mId, std::chrono::steady_clock::now());
+    }
+
+    mNextTask.store(task.release());
+    signal();
 
-        mWaitingForTask.notify_all();
+    //shutdown may have collected what was left before we stored ours, if so take it back
+    if(isShutdown())
+    {
+        task = TaskHandle::adopt(mNextTask.exchange(0));
+        if(task)
+        {
+            task->setCompletionStatus(false);
+        }
     }
-    else if(task != 0)
+}
+
+//------------------------------------------------------------------------------
+void Worker::signal()
+{
+    if(SLEEPING == mSignal.exchange(SIGNALLED))
     {
-        task->setCompletionStatus(false);
+        atomicNotifyAll(mSignal);
     }
 }
 
+//------------------------------------------------------------------------------
+Worker* Worker::getCurrent()
+{
+    return tlsCurrentWorker;
+}
+
 //------------------------------------------------------------------------------
 void Worker::run()
 {
+    tlsCurrentWorker = this;
+    if(mStartFunction)
+    {
+        mStartFunction(this);
+    }
     mReadyForWorkPromise.set_value(true);
 
-    while(!isShutdown())
+    std::chrono::steady_clock::time_point idleStart = std::chrono::steady_clock::now();
+    while(true)
     {
-        std::shared_ptr<Task> taskToRun;
+        TaskHandle taskToRun = TaskHandle::adopt(waitForTask());
+
+        if(taskToRun)
         {
-            std::unique_lock<std::mutex> lock(mMutex);
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            if(TaskTrace::isEnabled())
+            {
+                TaskTrace::record(TraceEvent::START, taskToRun.get(), mId, start);
+            }
+
+            //a task handed to us before shutdown still gets run
+            taskToRun->perform(mPriorToCompleteFunction);
 
-            while(!mHasTask)
+            const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+            if(TaskTrace::isEnabled())
             {
-                mWaitingForTask.wait(lock);
+                TaskTrace::record(TraceEvent::END, taskToRun.get(), mId, end);
             }
+            mRunTimes.recordFromOwner(end - start);
+            mNbTasks.store(mNbTasks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            addTime(mBusyTime, end - start);
+            addTime(mIdleTime, start - idleStart);
+            idleStart = end;
+        }
+        else if(isShutdown())
+        {
+            break;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void Worker::addTime(std::atomic<int64_t>& total, const std::chrono::steady_clock::duration duration)
+{
+    total.store(total.load(std::memory_order_relaxed) + std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(), std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+WorkerStats Worker::getStats() const
+{
+    WorkerStats stats;
+    stats.id = mId;
+    stats.nbTasks = mNbTasks.load(std::memory_order_relaxed);
+    stats.nbSteals = mNbSteals.load(std::memory_order_relaxed);
+    stats.busyTime = std::chrono::nanoseconds(mBusyTime.load(std::memory_order_relaxed));
+    stats.idleTime = std::chrono::nanoseconds(mIdleTime.load(std::memory_order_relaxed));
+    stats.runTimes = mRunTimes;
+    for(size_t priority = 0; priority < NB_PRIORITIES; ++priority)
+    {
+        stats.queueWaitTimes[priority] = mQueueWaitTimes[priority];
+    }
+    return stats;
+}
 
-            taskToRun.swap(mRunningTask);
-            mHasTask = false;
+//------------------------------------------------------------------------------
+Task* Worker::waitForTask()
+{
+    bool isSignalled = false;
+
+    //spin with plain loads, so the line stays shared until the signal arrives
+    for(size_t spinIdx = 0; spinIdx < mSpinBudget && !isSignalled; ++spinIdx)
+    {
+        isSignalled = (SIGNALLED == mSignal.load(std::memory_order_relaxed));
+        if(!isSignalled)
+        {
+            cpuRelax();
         }
+    }
+    if(isSignalled)
+    {
+        //tasks are arriving quickly, worth waiting longer for the next one
+        mSpinBudget = std::min(mWaitStrategy.maxSpins, mSpinBudget * 2);
+    }
 
-        if(taskToRun != 0)
+    for(size_t yieldIdx = 0; yieldIdx < mWaitStrategy.nbYields && !isSignalled; ++yieldIdx)
+    {
+        std::this_thread::yield();
+        isSignalled = (SIGNALLED == mSignal.load(std::memory_order_relaxed));
+    }
+
+    if(!isSignalled)
+    {
+        //spinning did not pay off this time, but keep a little so a quicker pace can build it back up
+        mSpinBudget = std::max((mWaitStrategy.maxSpins + 15) / 16, mSpinBudget / 2);
+
+        //a signal we took along with our last task may have been shutdown's, do not sleep through it
+        int expected = EMPTY;
+        if(!isShutdown() && mSignal.compare_exchange_strong(expected, SLEEPING))
         {
-            taskToRun->perform([this]()->void { this->mTaskCompleteFunction(this); });
+            //blocks freed by our tasks would be stranded in our cache while we sleep
+            TaskPool::flushThreadCache();
+            while(SLEEPING == mSignal.load())
+            {
+                atomicWait(mSignal, SLEEPING);
+            }
         }
     }
+
+    //taking the signal with an exchange makes whatever was handed over before it visible
+    mSignal.exchange(EMPTY);
+    return mNextTask.exchange(0);
 }
 
 }
@@ -1,8 +1,11 @@
 #pragma once
 #include "Platform.h"
+#include "Task.h"
+#include "LatencyHistogram.h"
 
 #include <atomic>
-#include <condition_variable>
+#include <chrono>
+#include <cstdint>
 #include <functional>
 #include <future>
 #include <memory>
@@ -10,15 +13,45 @@
 
 namespace workers {
 
-class Task;
+//How an idle worker waits for its next task: spin, then yield, then sleep until woken. Spinning saves the sleep
+//and the wake up system call when tasks arrive close together, at the price of some idle processor time
+struct WaitStrategy {
+    inline WaitStrategy(const size_t maxSpins = 0, const size_t nbYields = 0);
+
+    //most checks for a task, with a pause between each, before yielding. The budget actually spent doubles
+    //while tasks keep arriving during the spin and halves each time we end up sleeping anyway
+    size_t maxSpins;
+    //times we give up our processor before sleeping
+    size_t nbYields;
+};
+
+//Snapshot of what a worker has been doing since it started
+struct WorkerStats {
+    inline WorkerStats();
+
+    size_t id;
+    uint64_t nbTasks;
+    //tasks its manager took from another worker's deque for it
+    uint64_t nbSteals;
+    //time spent running tasks, and waiting for them in between
+    std::chrono::nanoseconds busyTime;
+    std::chrono::nanoseconds idleTime;
+    //how long each of its tasks ran
+    LatencyHistogram runTimes;
+    //how long the tasks it was given waited in each band of its manager's queue
+    LatencyHistogram queueWaitTimes[NB_PRIORITIES];
+};
 
 class EXAMPLES_LIB_API Worker {
 public:
-    //Constructor, takes a function to call every time worker has completed a task
-    Worker(std::function<void (Worker*)> taskCompleteFunction);
+    //Constructor, takes a function to call every time worker has completed a task, and an id for the owner's use.
+    //The start function is called on the worker's thread before it is ready, to place it or set up state local to it
+    Worker(std::function<void (Worker*)> taskCompleteFunction, const size_t id = 0, std::function<void (Worker*)> startFunction = std::function<void (Worker*)>(),
+        const WaitStrategy& waitStrategy = WaitStrategy());
     virtual ~Worker();
 
-    //Set the task for this worker to run
+    //Set the task for this worker to run. Only makes a system call when the worker is asleep
+    void runTask(TaskHandle task);
     void runTask(std::shared_ptr<Task> task);
     //Stop worker thread. Worker can no longer run tasks
     void shutdown();
@@ -26,27 +59,79 @@ public:
     //Wait until the worker has started up and is ready to accept tasks
     inline void waitUntilReady();
     inline const bool isShutdown();
+    inline const size_t getId() const;
+    //Counters are only written by our own thread, so reading them costs us nothing
+    WorkerStats getStats() const;
+    //Count a task taken from another worker for us
+    inline void onSteal();
+    //Record how long a task taken from a band of the queue for us waited there. Done by whoever takes it, mostly our
+    //own thread, so the histogram is rarely shared with another
+    inline void onTaskDequeued(const size_t priority, const std::chrono::steady_clock::duration waitTime);
+
+    //Worker whose thread we are currently running on, 0 if not called from a worker thread
+    static Worker* getCurrent();
 private:
     //Entry point for our thread
     void run();
+    //Spin, yield then sleep until signalled, returning the task handed over, if any
+    Task* waitForTask();
+    //Signal our thread, waking it if it sleeps
+    void signal();
+    //Add to one of our time counters, only from our thread
+    static void addTime(std::atomic<int64_t>& total, const std::chrono::steady_clock::duration duration);
+
+    //values of mSignal
+    enum Signal {
+        //nothing for us yet
+        EMPTY,
+        //a task was handed over or we are shutting down
+        SIGNALLED,
+        //our thread is asleep, whoever signals has to wake it
+        SLEEPING
+    };
 
     //thread for work
     std::unique_ptr<std::thread> mThread;
     //promise and future used to know when our worker has entered its work thread and is ready for tasks
     std::promise<bool> mReadyForWorkPromise;
     std::future<bool> mReadyForWorkFuture;
-    //mutex to allow changing the task to run, done when setting a new task to run
-    std::mutex mMutex;
-    std::shared_ptr<Task> mRunningTask;
-    //signal to know when a task is available
-    std::condition_variable mWaitingForTask;
+    //task handed over for us to run next, holding the reference its handle gave up
+    std::atomic<Task*> mNextTask;
+    std::atomic<int> mSignal;
+    WaitStrategy mWaitStrategy;
+    //checks we spin through before yielding, only touched by our thread
+    size_t mSpinBudget;
     //function to call after we finish with a task
     std::function<void (Worker*)> mTaskCompleteFunction;
+    //function to call once our thread starts
+    std::function<void (Worker*)> mStartFunction;
+    //mTaskCompleteFunction bound to this worker, built once rather than for every task
+    std::function<void (void)> mPriorToCompleteFunction;
     std::atomic<bool> mShutdown;
-    bool mHasTask;
+    //id given by our owner
+    size_t mId;
+    //written by our thread alone, relaxed stores rather than read modify writes
+    std::atomic<uint64_t> mNbTasks;
+    std::atomic<uint64_t> mNbSteals;
+    std::atomic<int64_t> mBusyTime;
+    std::atomic<int64_t> mIdleTime;
+    LatencyHistogram mRunTimes;
+    LatencyHistogram mQueueWaitTimes[NB_PRIORITIES];
 };
 
 //inline implementations
+//------------------------------------------------------------------------------
+WaitStrategy::WaitStrategy(const size_t maxSpins, const size_t nbYields) : maxSpins(maxSpins), nbYields(nbYields)
+{
+
+}
+
+//------------------------------------------------------------------------------
+WorkerStats::WorkerStats() : id(0), nbTasks(0), nbSteals(0), busyTime(0), idleTime(0)
+{
+
+}
+
 //------------------------------------------------------------------------------
 void Worker::waitUntilReady()
 {
@@ -59,4 +144,23 @@ const bool Worker::isShutdown()
     return mShutdown;
 }
 
-}
\ No newline at end of file
+//------------------------------------------------------------------------------
+const size_t Worker::getId() const
+{
+    return mId;
+}
+
+//------------------------------------------------------------------------------
+void Worker::onSteal()
+{
+    //stealing is done on behalf of a worker by whoever wakes it, so unlike the others this one needs an add
+    mNbSteals.fetch_add(1, std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+void Worker::onTaskDequeued(const size_t priority, const std::chrono::steady_clock::duration waitTime)
+{
+    mQueueWaitTimes[priority].record(waitTime);
+}
+
+}
@@ -1,6 +1,15 @@
+#include "Coroutine.h"
 #include "FunctionalProgramming.h"
+#include "IoEngine.h"
+#include "ResourceArchive.h"
 #include "MultiThreading.h"
 #include "Manager.h"
+#include "Parallel.h"
+#include "ConcurrentVector.h"
+#include "Combinable.h"
+#include "TaskGraph.h"
+#include "TaskGroup.h"
+#include "TaskTrace.h"
 #include "Task.h"
 
 #include <algorithm>
@@ -336,6 +345,231 @@ void example_task()
     //all our tasks are completed at this point
 }
 
+void example_task_continuation()
+{
+    workers::Manager manager(2);
+
+    //instead of waiting on a task's future before doing the next step, the next step can be attached
+    //as a continuation. It is run on the manager's workers as soon as the task completes, and receives
+    //the task's result, so no thread sits blocked waiting
+    std::shared_ptr<workers::Task> task(new ExampleTask());
+    std::shared_ptr<workers::Task> lastStep = manager.runThen(task, [](bool taskResult) -> bool {
+        return taskResult;
+    //continuations can themselves be continued, building up a chain of steps
+    })->then(manager, [](bool previousResult) -> bool {
+        return !previousResult;
+    });
+
+    //only the end of the chain needs to be waited on
+    bool chainResult = lastStep->getCompletionFuture().get();
+}
+
+void example_parallel_for()
+{
+    workers::Manager manager(2);
+
+    //rather than making a task for every index, parallel_for hands out ranges of indices. The calling thread
+    //works through the range too, giving half of what it has left to any worker that goes idle
+    std::vector<double> values(100000, 1.0);
+    workers::parallel_for(manager, size_t(0), values.size(), [&values](size_t i) {
+        values[i] = values[i] * 2.0;
+    });
+
+    //when every index costs the same, splitting into one chunk per worker up front is cheaper still
+    workers::parallel_for(manager, size_t(0), values.size(), [&values](size_t i) {
+        values[i] = values[i] + 1.0;
+    }, workers::static_partitioner());
+}
+
+void example_concurrent_vector()
+{
+    workers::Manager manager(2);
+
+    //any number of tasks can push_back at once, elements never move once added so the
+    //strings can be read while others are still being added
+    workers::concurrent_vector<std::string> results;
+    workers::parallel_for(manager, 0, 100, [&results](int value) {
+        if(0 == value % 3)
+        {
+            results.push_back("multiple of three");
+        }
+    });
+
+    //everything pushed from within the loop can be read once it returns
+    for(workers::concurrent_vector<std::string>::const_iterator result = results.begin(); result != results.end(); ++result)
+    {
+        size_t length = result->size();
+    }
+}
+
+void example_parallel_reduce()
+{
+    workers::Manager manager(2);
+    std::vector<int> values(100000, 1);
+
+    //a shared result would need a lock or an atomic every task fights over. parallel_reduce folds each range
+    //into its own copy of the identity, then merges the results once at the end
+    bool allPositive = workers::parallel_reduce(manager, size_t(0), values.size(), true,
+        [&values](bool result, size_t i) { return result && values[i] > 0; },
+        [](bool a, bool b) { return a && b; });
+
+    //combinable gives every thread its own accumulator, for results built up from any tasks
+    workers::combinable<long long> sums;
+    workers::parallel_for(manager, size_t(0), values.size(), [&values, &sums](size_t i) {
+        sums.local() += values[i];
+    });
+    long long sum = sums.combine([](long long a, long long b) { return a + b; });
+}
+
+void example_task_graph()
+{
+    workers::Manager manager(2);
+
+    //tasks blocking on each other's futures tie up a worker each, and deadlock once they outnumber the workers.
+    //A graph only hands a node to the manager once everything it depends on is done
+    workers::TaskGraph build;
+    size_t parse = build.addNode([]() { /*parse sources*/ });
+    size_t compileA = build.addNode([]() { /*compile a*/ return true; });
+    size_t compileB = build.addNode([]() { /*compile b*/ return true; });
+    size_t link = build.addNode([]() { /*link*/ });
+    build.addEdge(parse, compileA);
+    build.addEdge(parse, compileB);
+    build.addEdge(compileA, link);
+    build.addEdge(compileB, link);
+
+    //built once, run as often as needed
+    for(int i = 0; i < 10; ++i)
+    {
+        build.run(manager);
+        bool succeeded = build.wait();
+    }
+}
+
+void example_task_group()
+{
+    workers::Manager manager(2);
+
+    //waitForTasksToComplete waits on every task of the manager, and only until they leave its queue.
+    //A group waits for its own tasks until they are done running, with a single wake up however many there are
+    workers::TaskGroup request(manager);
+    for(int i = 0; i < 10000; ++i)
+    {
+        request.submit([]() { /*handle part of a request*/ });
+    }
+
+    //a nested group can be waited on alone, or through its parent
+    workers::TaskGroup logging(request);
+    logging.submit([]() { /*write the request's log*/ return true; });
+
+    bool succeeded = request.wait();
+}
+
+void example_task_trace()
+{
+    workers::Manager manager(2);
+
+    //tracing costs a branch per event while off, so it can stay compiled in and be turned on around a slow batch
+    workers::TaskTrace::start();
+    for(int i = 0; i < 100; ++i)
+    {
+        manager.submit([]() { std::this_thread::sleep_for(std::chrono::microseconds(100)); });
+    }
+    manager.waitForTasksToComplete();
+    workers::TaskTrace::stop();
+
+    //open in chrome://tracing or ui.perfetto.dev to see when each task was queued, handed over and run
+    workers::TaskTrace::write("tasks.json");
+}
+
+void example_io_engine()
+{
+    workers::Manager manager(4);
+
+    //thousands of reads can be in flight with io_uring while the workers stay free for the callbacks
+    workers::IoEngine io(manager);
+    for(int i = 0; i < 1000; ++i)
+    {
+        io.readFile("asset.bin", [](bool succeeded, std::vector<char>& data) { /*decode the asset*/ });
+    }
+
+    //a map's assets are loaded the same way, each added to the resource manager as its read completes
+    ResourceManager mgr;
+    MapLoader loader;
+    loader.loadResourcesAsync(mgr, "maps/level1.map", io, [](bool succeeded) { /*start the level*/ });
+    io.wait();
+}
+
+void example_resource_archive()
+{
+    //packed offline, by the PackResources tool or directly
+    std::vector<std::string> names(1, "textures/grass");
+    std::vector<std::string> files(1, "assets/textures/grass.dds");
+    bool packed = ResourceArchive::pack("level1.pak", names, files);
+
+    //loading maps the archive and hands out views into it, nothing is copied and pages are read as they are touched
+    ResourceManager mgr;
+    MapLoader loader;
+    bool loaded = loader.loadArchive(mgr, "level1.pak");
+    Resource grass = mgr.getResource("textures/grass");
+    const char* texels = grass.getData();
+}
+
+void example_resource_cache()
+{
+    //at most 256MB cached, what is not looked up goes first once over
+    ResourceManager mgr(256 * 1024 * 1024);
+
+    //threads after the same resource while it loads wait for that load instead of loading it again
+    std::vector<std::thread> threads;
+    for(int i = 0; i < 4; ++i)
+    {
+        threads.push_back(std::thread([&mgr]() {
+            Resource shader = mgr.load("shaders/water", []() {
+                std::vector<char> compiled(1024);
+                /*compile the shader*/
+                return Resource(compiled);
+            });
+        }));
+    }
+    for(std::vector<std::thread>::iterator thread = threads.begin(); thread != threads.end(); ++thread)
+    {
+        thread->join();
+    }
+}
+
+#if defined(WORKERS_COROUTINES)
+workers::co_task<int> loadPart(workers::Manager& manager, int part)
+{
+    //carry on on one of the manager's workers, freeing whoever started us
+    co_await manager.schedule();
+    co_return part * 2;
+}
+
+workers::co_task<int> loadAll(workers::Manager& manager)
+{
+    //no thread is held while waiting on a task, only the coroutine's frame
+    workers::TaskHandle config = workers::CallableTask::create([]() { /*read the config*/ });
+    manager.run(config);
+    bool succeeded = co_await manager.whenComplete(config);
+
+    int total = 0;
+    for(int part = 0; part < 10; ++part)
+    {
+        total += co_await loadPart(manager, part);
+    }
+    co_return total;
+}
+
+void example_coroutines()
+{
+    workers::Manager manager(2);
+
+    workers::co_task<int> load = loadAll(manager);
+    load.start(manager);
+    int total = load.get();
+}
+#endif
+
 //http://msdn.microsoft.com/en-us/library/dd492427.aspx
 
 #include <ppltasks.h>
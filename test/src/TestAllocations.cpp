@@ -0,0 +1,130 @@
+#include "Manager.h"
+#include "Task.h"
+
+#pragma warning(disable:4251)
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+using namespace workers;
+
+//count every heap allocation made by the test executable and the library
+static std::atomic<size_t> gNbAllocations(0);
+
+void* operator new(size_t size)
+{
+    ++gNbAllocations;
+    void* memory = std::malloc(size ? size : 1);
+    if(0 == memory)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t size) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory, size_t size) noexcept
+{
+    std::free(memory);
+}
+
+//submit nbTasks lambdas capturing captureSize bytes, wait until all have run, return how many allocations that took
+template<size_t captureSize>
+static size_t countSubmitAllocations(Manager& manager, const size_t nbTasks)
+{
+    struct Capture {
+        char bytes[captureSize];
+    };
+    Capture capture = {};
+    std::atomic<size_t> nbPerformed(0);
+
+    const size_t nbAllocationsBefore = gNbAllocations;
+    for(size_t i = 0; i < nbTasks; ++i)
+    {
+        std::atomic<size_t>* counter = &nbPerformed;
+        manager.submit([capture, counter]() { ++(*counter); });
+    }
+    while(nbPerformed < nbTasks)
+    {
+        std::this_thread::yield();
+    }
+    manager.waitForTasksToComplete();
+
+    return gNbAllocations - nbAllocationsBefore;
+}
+
+//fill the pool with as many tasks as will ever be alive at once, by holding them all until they are submitted
+static void warmUp(Manager& manager, const size_t nbTasks)
+{
+    std::atomic<bool> gate(false);
+    std::atomic<size_t> nbPerformed(0);
+
+    for(size_t i = 0; i < nbTasks; ++i)
+    {
+        std::atomic<bool>* taskGate = &gate;
+        std::atomic<size_t>* counter = &nbPerformed;
+        manager.submit([taskGate, counter]() {
+            while(!(*taskGate))
+            {
+                std::this_thread::yield();
+            }
+            ++(*counter);
+        });
+    }
+    gate = true;
+    while(nbPerformed < nbTasks)
+    {
+        std::this_thread::yield();
+    }
+    manager.waitForTasksToComplete();
+}
+
+TEST(ALLOCATIONS_TEST, SUBMIT_TEST)
+{
+    ManagerConfig config(2);
+    config.queue = QueueMode::LOCK_FREE;
+    config.queueCapacity = 4096;
+    Manager manager(config);
+
+    //once the pool is warm, submitting small callables never touches the heap
+    warmUp(manager, 2000);
+    ASSERT_EQ(0, countSubmitAllocations<48>(manager, 2000));
+
+    //callables too big for the task are allocated alongside it
+    ASSERT_GE(countSubmitAllocations<256>(manager, 100), 100);
+}
+
+TEST(ALLOCATIONS_TEST, SUBMIT_RESULT_TEST)
+{
+    Manager manager(2);
+
+    //callables returning bool report their own success
+    ASSERT_TRUE(manager.submit([]() -> bool { return true; })->getCompletionFuture().get());
+    ASSERT_FALSE(manager.submit([]() -> bool { return false; })->getCompletionFuture().get());
+
+    //tasks from submit can be continued like any other
+    TaskHandle task = manager.submit([]() {});
+    ASSERT_FALSE(task->then(manager, [](bool status) -> bool { return !status; })->getCompletionFuture().get());
+}
@@ -0,0 +1,131 @@
+#if defined(WORKERS_COROUTINES)
+
+#include "Coroutine.h"
+#include "Manager.h"
+#include "Worker.h"
+
+#pragma warning(disable:4251)
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace workers;
+
+//------------------------------------------------------------------------------
+static co_task<int> addOnWorker(Manager& manager, const int a, const int b)
+{
+    co_await manager.schedule();
+    co_return a + b;
+}
+
+//------------------------------------------------------------------------------
+static co_task<bool> isOnWorker(Manager& manager)
+{
+    co_await manager.schedule();
+    co_return 0 != Worker::getCurrent();
+}
+
+//------------------------------------------------------------------------------
+static co_task<int> sumOnWorkers(Manager& manager, const int nbValues)
+{
+    int total = 0;
+    for(int value = 0; value < nbValues; ++value)
+    {
+        total += co_await addOnWorker(manager, value, 1);
+    }
+    co_return total;
+}
+
+//------------------------------------------------------------------------------
+static co_task<bool> waitForTask(Manager& manager, TaskHandle task)
+{
+    const bool succeeded = co_await manager.whenComplete(task);
+    EXPECT_TRUE(task->isComplete());
+    co_return succeeded;
+}
+
+//------------------------------------------------------------------------------
+static co_task<void> throwOnWorker(Manager& manager)
+{
+    co_await manager.schedule();
+    throw std::runtime_error("failed on a worker");
+}
+
+TEST(WORKERS_TEST, COROUTINE_TEST)
+{
+    Manager manager(2);
+
+    co_task<bool> onWorker = isOnWorker(manager);
+    onWorker.start(manager);
+    ASSERT_TRUE(onWorker.get());
+
+    //awaiting other coroutines, hopping onto workers each time
+    co_task<int> sum = sumOnWorkers(manager, 100);
+    sum.start(manager);
+    ASSERT_EQ(100 * 99 / 2 + 100, sum.get());
+
+    //many coroutines suspended on one task hold no worker while they wait
+    TaskHandle gate = CallableTask::create([]() {});
+    std::vector< co_task<bool> > waiting;
+    for(int coroutineIdx = 0; coroutineIdx < 1000; ++coroutineIdx)
+    {
+        waiting.push_back(waitForTask(manager, gate));
+        waiting.back().start(manager);
+    }
+    ASSERT_TRUE(manager.submit([]() {})->waitForCompletion());
+    manager.run(gate);
+    for(std::vector< co_task<bool> >::iterator coroutine = waiting.begin(); coroutine != waiting.end(); ++coroutine)
+    {
+        ASSERT_TRUE(coroutine->get());
+    }
+
+    //a failed task is reported, one already complete does not suspend
+    TaskHandle failing = manager.submit([]() { return false; });
+    failing->waitForCompletion();
+    co_task<bool> failed = waitForTask(manager, failing);
+    failed.start(manager);
+    ASSERT_FALSE(failed.get());
+
+    //what a coroutine throws comes out of get
+    co_task<void> throwing = throwOnWorker(manager);
+    throwing.start(manager);
+    ASSERT_THROW(throwing.get(), std::runtime_error);
+
+    //a manager that is shut down leaves the coroutine running on the thread that started it
+    Manager stopped(1);
+    stopped.shutdown();
+    co_task<bool> onCaller = isOnWorker(stopped);
+    onCaller.start(stopped);
+    ASSERT_FALSE(onCaller.get());
+    co_task<int> sumOnCaller = sumOnWorkers(stopped, 10);
+    sumOnCaller.start(stopped);
+    ASSERT_EQ(10 * 9 / 2 + 10, sumOnCaller.get());
+
+    //a coroutine still queued as the manager shuts down finishes on the thread shutting it down
+    Manager busy(1);
+    std::atomic<bool> isStarted(false);
+    std::atomic<bool> isReleased(false);
+    busy.submit([&isStarted, &isReleased]() {
+        isStarted = true;
+        while(!isReleased)
+        {
+            std::this_thread::yield();
+        }
+    });
+    while(!isStarted)
+    {
+        std::this_thread::yield();
+    }
+    //started on this thread, so it is queued by the time start returns
+    co_task<bool> queued = isOnWorker(busy);
+    queued.start(stopped);
+    std::thread stopper([&busy]() { busy.shutdown(); });
+    ASSERT_FALSE(queued.get());
+    isReleased = true;
+    stopper.join();
+}
+
+#endif
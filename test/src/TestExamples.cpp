@@ -1,7 +1,14 @@
 #include "FunctionalProgramming.h"
 #include "MultiThreading.h"
+#include "IoEngine.h"
+#include "ResourceArchive.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
 #include <vector>
 #include <mutex>
 
@@ -36,6 +43,176 @@ TEST(EXAMPLES_TEST, TEST_BIND)
     ASSERT_TRUE(pathBoundFunction(&loader, mgr));
 }
 
+TEST(EXAMPLES_TEST, TEST_LOAD_RESOURCES_ASYNC)
+{
+    std::ofstream("map_test_asset_a.bin") << "aaa";
+    std::ofstream("map_test_asset_b.bin") << "bb";
+    std::ofstream("map_test.map") << "# assets\nmap_test_asset_a.bin\n\nmap_test_asset_b.bin\n";
+    std::ofstream("map_test_broken.map") << "map_test_asset_a.bin\nmap_test_missing.bin\n";
+
+    workers::Manager manager(2);
+    workers::IoEngine io(manager);
+    MapLoader loader;
+
+    ResourceManager mgr;
+    std::atomic<int> loaded(-1);
+    loader.loadResourcesAsync(mgr, "map_test.map", io, [&loaded](bool succeeded) { loaded = succeeded ? 1 : 0; });
+    io.wait();
+    ASSERT_EQ(1, loaded);
+    ASSERT_EQ(2u, mgr.getNbResources());
+    Resource asset = mgr.getResource("map_test_asset_a.bin");
+    ASSERT_EQ("aaa", std::string(asset.getData(), asset.getSize()));
+    asset = mgr.getResource("map_test_asset_b.bin");
+    ASSERT_EQ("bb", std::string(asset.getData(), asset.getSize()));
+    ASSERT_FALSE(mgr.getResource("map_test.map").isValid());
+
+    //the same map loaded twice at once, the second waiting on the first's reads
+    ResourceManager twice;
+    std::atomic<int> nbLoaded(0);
+    loader.loadResourcesAsync(twice, "map_test.map", io, [&nbLoaded](bool succeeded) { nbLoaded += succeeded ? 1 : 0; });
+    loader.loadResourcesAsync(twice, "map_test.map", io, [&nbLoaded](bool succeeded) { nbLoaded += succeeded ? 1 : 0; });
+    io.wait();
+    ASSERT_EQ(2, nbLoaded);
+    ASSERT_EQ(2u, twice.getNbResources());
+
+    ResourceManager broken;
+    loader.loadResourcesAsync(broken, "map_test_broken.map", io, [&loaded](bool succeeded) { loaded = succeeded ? 1 : 0; });
+    io.wait();
+    ASSERT_EQ(0, loaded);
+
+    std::remove("map_test_asset_a.bin");
+    std::remove("map_test_asset_b.bin");
+    std::remove("map_test.map");
+    std::remove("map_test_broken.map");
+}
+
+TEST(EXAMPLES_TEST, TEST_LOAD_ARCHIVE)
+{
+    const std::string big(100000, 'x');
+    std::ofstream("archive_test_a.bin") << "aaa";
+    std::ofstream("archive_test_empty.bin");
+    std::ofstream("archive_test_big.bin") << big;
+
+    std::vector<std::string> names;
+    names.push_back("textures/a");
+    names.push_back("empty");
+    names.push_back("models/big");
+    std::vector<std::string> files;
+    files.push_back("archive_test_a.bin");
+    files.push_back("archive_test_empty.bin");
+    files.push_back("archive_test_big.bin");
+    ASSERT_TRUE(ResourceArchive::pack("archive_test.pak", names, files));
+
+    {
+        std::shared_ptr<ResourceArchive> archive = ResourceArchive::open("archive_test.pak");
+        ASSERT_TRUE(archive);
+        ASSERT_EQ(3u, archive->getNbEntries());
+        const char* data = 0;
+        size_t size = 0;
+        ASSERT_TRUE(archive->find("textures/a", data, size));
+        ASSERT_EQ("aaa", std::string(data, size));
+        ASSERT_EQ(0u, reinterpret_cast<size_t>(data) % ResourceArchive::DEFAULT_ALIGNMENT);
+        ASSERT_TRUE(archive->find("models/big", data, size));
+        ASSERT_TRUE(big == std::string(data, size));
+        ASSERT_EQ(0u, reinterpret_cast<size_t>(data) % ResourceArchive::DEFAULT_ALIGNMENT);
+        ASSERT_TRUE(archive->find("empty", data, size));
+        ASSERT_EQ(0u, size);
+        ASSERT_FALSE(archive->find("textures/b", data, size));
+    }
+
+    //views stay valid after the loader let go of the archive
+    ResourceManager mgr;
+    MapLoader loader;
+    ASSERT_TRUE(loader.loadArchive(mgr, "archive_test.pak"));
+    ASSERT_EQ(3u, mgr.getNbResources());
+    Resource resource = mgr.getResource("textures/a");
+    ASSERT_EQ("aaa", std::string(resource.getData(), resource.getSize()));
+    ASSERT_TRUE(mgr.getResource("empty").isValid());
+
+    //names used twice, missing files, and files that are not archives are refused
+    names.push_back("empty");
+    files.push_back("archive_test_a.bin");
+    ASSERT_FALSE(ResourceArchive::pack("archive_test_bad.pak", names, files));
+    names.back() = "missing";
+    files.back() = "archive_test_missing.bin";
+    ASSERT_FALSE(ResourceArchive::pack("archive_test_bad.pak", names, files));
+    ASSERT_FALSE(ResourceArchive::open("archive_test_a.bin"));
+    ASSERT_FALSE(ResourceArchive::open("archive_test_missing.bin"));
+    ASSERT_FALSE(loader.loadArchive(mgr, "archive_test_big.bin"));
+
+    std::remove("archive_test_a.bin");
+    std::remove("archive_test_empty.bin");
+    std::remove("archive_test_big.bin");
+    std::remove("archive_test.pak");
+}
+
+TEST(EXAMPLES_TEST, TEST_RESOURCE_CACHE)
+{
+    //a single shard so that every resource is on the same clock
+    ResourceManager mgr(100, 1);
+    std::vector<char> data(10, 'h');
+    mgr.addResource("hot", data);
+    Resource first;
+    for(int resourceIdx = 0; resourceIdx < 50; ++resourceIdx)
+    {
+        std::ostringstream name;
+        name << "cold" << resourceIdx;
+        data.assign(10, 'c');
+        mgr.addResource(name.str(), data);
+        if(0 == resourceIdx)
+        {
+            first = mgr.getResource(name.str());
+        }
+
+        //looked up after every add, so the clock keeps sparing it
+        ASSERT_TRUE(mgr.getResource("hot").isValid());
+        ASSERT_LE(mgr.getNbBytes(), mgr.getByteBudget());
+    }
+    ASSERT_EQ(10u, mgr.getNbResources());
+    ASSERT_FALSE(mgr.getResource("cold0").isValid());
+    //evicted, but what was handed out stays valid
+    ASSERT_EQ(std::string(10, 'c'), std::string(first.getData(), first.getSize()));
+    ASSERT_TRUE(mgr.removeResource("hot"));
+    ASSERT_FALSE(mgr.removeResource("hot"));
+    ASSERT_EQ(90u, mgr.getNbBytes());
+
+    //threads asking for the same resource at once load it once
+    ResourceManager shared;
+    std::atomic<int> nbLoads(0);
+    std::atomic<int> nbLoaded(0);
+    std::vector<std::thread> threads;
+    for(int threadIdx = 0; threadIdx < 8; ++threadIdx)
+    {
+        threads.push_back(std::thread([&shared, &nbLoads, &nbLoaded]() {
+            Resource resource = shared.load("texture", [&nbLoads]() {
+                ++nbLoads;
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                std::vector<char> texels(4, 't');
+                return Resource(texels);
+            });
+            if(std::string(4, 't') == std::string(resource.getData(), resource.getSize()))
+            {
+                ++nbLoaded;
+            }
+        }));
+    }
+    for(std::vector<std::thread>::iterator thread = threads.begin(); thread != threads.end(); ++thread)
+    {
+        thread->join();
+    }
+    ASSERT_EQ(1, nbLoads);
+    ASSERT_EQ(8, nbLoaded);
+
+    //cached resources are handed back straight away, failed loads are not kept
+    bool wasCached = false;
+    ASSERT_FALSE(shared.beginLoad("texture", [&wasCached](const Resource& resource) { wasCached = resource.isValid(); }));
+    ASSERT_TRUE(wasCached);
+    ASSERT_FALSE(shared.load("missing", []() { return Resource(); }).isValid());
+    ASSERT_FALSE(shared.getResource("missing").isValid());
+    ASSERT_TRUE(shared.beginLoad("missing", [](const Resource& resource) {}));
+    shared.finishLoad("missing", Resource());
+}
+
 TEST(EXAMPLES_TEST, TEST_LAMBDA)
 {
     std::function<bool(int)> lfObj = [](int x) -> bool { return true; };
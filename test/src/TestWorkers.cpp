@@ -1,11 +1,33 @@
 #include "Manager.h"
 #include "Worker.h"
 #include "Task.h"
+#include "ContinuationTask.h"
+#include "BoundedQueue.h"
+#include "WorkStealingDeque.h"
+#include "TimerWheel.h"
+#include "Topology.h"
+#include "Parallel.h"
+#include "ConcurrentVector.h"
+#include "Combinable.h"
+#include "TaskGraph.h"
+#include "TaskGroup.h"
+#include "TaskTrace.h"
+#include "IoEngine.h"
 
 #pragma warning(disable:4251)
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <chrono>
+#include <climits>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 
 using namespace workers;
 
@@ -33,6 +55,60 @@ private:
 
 };
 
+//task that runs two more of itself until depth reaches 0
+class SpawningTask : public Task
+{
+public:
+    SpawningTask(Manager& manager, const size_t depth, std::atomic<size_t>& nbPerformed) : mManager(manager), mDepth(depth), mNbPerformed(nbPerformed)
+    {
+
+    }
+
+    virtual ~SpawningTask()
+    {
+
+    }
+
+private:
+    virtual bool performSpecific()
+    {
+        if(mDepth > 0)
+        {
+            mManager.run(std::make_shared<SpawningTask>(mManager, mDepth - 1, mNbPerformed));
+            mManager.run(std::make_shared<SpawningTask>(mManager, mDepth - 1, mNbPerformed));
+        }
+        ++mNbPerformed;
+        return true;
+    }
+
+    Manager& mManager;
+    size_t mDepth;
+    std::atomic<size_t>& mNbPerformed;
+};
+
+//task counting how many of its kind have been destroyed
+class CountedTask : public Task
+{
+public:
+    CountedTask(std::atomic<size_t>& nbDestroyed) : mNbDestroyed(nbDestroyed)
+    {
+
+    }
+
+    virtual ~CountedTask()
+    {
+        ++mNbDestroyed;
+    }
+
+private:
+    virtual bool performSpecific()
+    {
+        return true;
+    }
+
+    std::atomic<size_t>& mNbDestroyed;
+};
+
 TEST(WORKERS_TEST, TEST_TASK)
 {
     {
@@ -228,3 +304,1782 @@ TEST(WORKERS_TEST, MANAGER_TEST)
         //make sure cleanup shuts down correctly
     }
 }
+
+TEST(WORKERS_TEST, WORK_STEALING_DEQUE_TEST)
+{
+    {
+        //owner pops newest first, thieves steal oldest first, grows past initial capacity
+        WorkStealingDeque<size_t*> deque(2);
+        size_t values[10];
+
+        ASSERT_TRUE(deque.empty());
+
+        for(size_t i = 0; i < 10; ++i)
+        {
+            deque.push(&values[i]);
+        }
+
+        ASSERT_EQ(10, deque.size());
+
+        size_t* value = 0;
+        ASSERT_TRUE(deque.pop(value));
+        ASSERT_EQ(&values[9], value);
+        ASSERT_TRUE(deque.steal(value));
+        ASSERT_EQ(&values[0], value);
+        ASSERT_EQ(8, deque.size());
+
+        while(deque.pop(value))
+        {
+
+        }
+
+        ASSERT_TRUE(deque.empty());
+        ASSERT_FALSE(deque.steal(value));
+    }
+
+    {
+        //every value is taken exactly once while thieves race the owner
+        const size_t nbValues = 20000;
+        std::vector<size_t> values(nbValues);
+        WorkStealingDeque<size_t*> deque;
+        std::atomic<bool> done(false);
+        std::vector< std::vector<size_t*> > stolen(2);
+
+        std::vector<std::thread> thieves;
+        for(size_t thiefIdx = 0; thiefIdx < stolen.size(); ++thiefIdx)
+        {
+            thieves.push_back(std::thread([&deque, &done, &stolen, thiefIdx]() {
+                size_t* value = 0;
+                while(!done)
+                {
+                    if(deque.steal(value))
+                    {
+                        stolen[thiefIdx].push_back(value);
+                    }
+                }
+            }));
+        }
+
+        std::vector<size_t*> popped;
+        for(size_t i = 0; i < nbValues; ++i)
+        {
+            deque.push(&values[i]);
+            size_t* value = 0;
+            if(i % 3 == 0 && deque.pop(value))
+            {
+                popped.push_back(value);
+            }
+        }
+        size_t* value = 0;
+        while(deque.pop(value))
+        {
+            popped.push_back(value);
+        }
+
+        done = true;
+        for(std::vector<std::thread>::iterator thief = thieves.begin(); thief != thieves.end(); ++thief)
+        {
+            thief->join();
+        }
+
+        std::set<size_t*> seen(popped.begin(), popped.end());
+        size_t nbTaken = popped.size();
+        for(size_t thiefIdx = 0; thiefIdx < stolen.size(); ++thiefIdx)
+        {
+            seen.insert(stolen[thiefIdx].begin(), stolen[thiefIdx].end());
+            nbTaken += stolen[thiefIdx].size();
+        }
+
+        ASSERT_EQ(nbValues, nbTaken);
+        ASSERT_EQ(nbValues, seen.size());
+    }
+}
+
+TEST(WORKERS_TEST, WORK_STEALING_TEST)
+{
+    {
+        //tasks running tasks end up on worker deques, and are spread through stealing
+        Manager manager(ManagerConfig(4, SchedulingMode::WORK_STEALING));
+        std::atomic<size_t> nbPerformed(0);
+
+        std::shared_ptr<Task> root(new SpawningTask(manager, 10, nbPerformed));
+        std::future<bool> rootFuture = root->getCompletionFuture();
+        manager.run(root);
+
+        ASSERT_TRUE(rootFuture.get());
+
+        while(nbPerformed < 2047)
+        {
+            manager.waitForTasksToComplete();
+            std::this_thread::yield();
+        }
+
+        ASSERT_EQ(2047, nbPerformed);
+    }
+
+    {
+        //tasks from outside the pool still go through the queue
+        std::vector< std::shared_ptr<Task> > tasks;
+        for(size_t i = 0; i < 10; ++i)
+        {
+            tasks.push_back(std::shared_ptr<Task>(new TestTask()));
+        }
+
+        Manager manager(ManagerConfig(2, SchedulingMode::WORK_STEALING));
+
+        for(std::vector< std::shared_ptr<Task> >::const_iterator task = tasks.begin(); task != tasks.end(); ++task)
+        {
+            manager.run((*task));
+        }
+
+        bool tasksCompleted = true;
+
+        for(std::vector< std::shared_ptr<Task> >::const_iterator task = tasks.begin(); task != tasks.end(); ++task)
+        {
+            std::future<bool> taskFuture = (*task)->getCompletionFuture();
+            taskFuture.wait();
+            tasksCompleted &= taskFuture.get();
+        }
+
+        ASSERT_TRUE(tasksCompleted);
+
+        manager.shutdown();
+
+        std::shared_ptr<Task> lateTask(new TestTask());
+        manager.run(lateTask);
+        ASSERT_FALSE(lateTask->getCompletionFuture().get());
+    }
+}
+
+TEST(WORKERS_TEST, BOUNDED_QUEUE_TEST)
+{
+    {
+        //fifo order, rejects pushes when full
+        BoundedQueue<size_t> queue(3);
+
+        ASSERT_EQ(4, queue.capacity());
+        ASSERT_TRUE(queue.empty());
+
+        for(size_t i = 0; i < 4; ++i)
+        {
+            ASSERT_TRUE(queue.tryPush(i));
+        }
+        ASSERT_FALSE(queue.tryPush(4));
+        ASSERT_EQ(4, queue.size());
+
+        size_t value = 0;
+        for(size_t i = 0; i < 4; ++i)
+        {
+            ASSERT_TRUE(queue.tryPop(value));
+            ASSERT_EQ(i, value);
+        }
+        ASSERT_FALSE(queue.tryPop(value));
+    }
+
+    {
+        //many producers and consumers, every value comes out exactly once
+        const size_t nbPerProducer = 10000;
+        const size_t nbProducers = 3;
+        BoundedQueue<size_t> queue(64);
+        std::atomic<size_t> nbPopped(0);
+        std::atomic<size_t> sum(0);
+
+        std::vector<std::thread> threads;
+        for(size_t producerIdx = 0; producerIdx < nbProducers; ++producerIdx)
+        {
+            threads.push_back(std::thread([&queue, producerIdx, nbPerProducer]() {
+                for(size_t i = 0; i < nbPerProducer; ++i)
+                {
+                    while(!queue.tryPush(producerIdx * nbPerProducer + i + 1))
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            }));
+        }
+        for(size_t consumerIdx = 0; consumerIdx < 2; ++consumerIdx)
+        {
+            threads.push_back(std::thread([&queue, &nbPopped, &sum, nbPerProducer, nbProducers]() {
+                size_t value = 0;
+                while(nbPopped < nbPerProducer * nbProducers)
+                {
+                    if(queue.tryPop(value))
+                    {
+                        sum += value;
+                        ++nbPopped;
+                    }
+                    else
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            }));
+        }
+        for(std::vector<std::thread>::iterator thread = threads.begin(); thread != threads.end(); ++thread)
+        {
+            thread->join();
+        }
+
+        const size_t nbValues = nbPerProducer * nbProducers;
+        ASSERT_EQ(nbValues, nbPopped);
+        ASSERT_EQ(nbValues * (nbValues + 1) / 2, sum);
+    }
+}
+
+TEST(WORKERS_TEST, LOCK_FREE_QUEUE_MANAGER_TEST)
+{
+    for(size_t modeIdx = 0; modeIdx < 2; ++modeIdx)
+    {
+        //small queue so producers have to wait for space
+        ManagerConfig config(2, (0 == modeIdx) ? SchedulingMode::FIFO : SchedulingMode::WORK_STEALING);
+        config.queue = QueueMode::LOCK_FREE;
+        config.queueCapacity = 8;
+        Manager manager(config);
+
+        const size_t nbPerProducer = 200;
+        std::vector< std::shared_ptr<Task> > tasks;
+        for(size_t i = 0; i < nbPerProducer * 3; ++i)
+        {
+            tasks.push_back(std::shared_ptr<Task>(new TestTask()));
+        }
+
+        std::vector< std::future<bool> > futures;
+        for(std::vector< std::shared_ptr<Task> >::const_iterator task = tasks.begin(); task != tasks.end(); ++task)
+        {
+            futures.push_back((*task)->getCompletionFuture());
+        }
+
+        std::vector<std::thread> producers;
+        for(size_t producerIdx = 0; producerIdx < 3; ++producerIdx)
+        {
+            producers.push_back(std::thread([&manager, &tasks, producerIdx, nbPerProducer]() {
+                for(size_t i = 0; i < nbPerProducer; ++i)
+                {
+                    manager.run(tasks[producerIdx * nbPerProducer + i]);
+                }
+            }));
+        }
+        for(std::vector<std::thread>::iterator producer = producers.begin(); producer != producers.end(); ++producer)
+        {
+            producer->join();
+        }
+
+        manager.waitForTasksToComplete();
+
+        bool tasksCompleted = true;
+        for(std::vector< std::future<bool> >::iterator future = futures.begin(); future != futures.end(); ++future)
+        {
+            tasksCompleted &= future->get();
+        }
+        ASSERT_TRUE(tasksCompleted);
+
+        manager.shutdown();
+
+        std::shared_ptr<Task> lateTask(new TestTask());
+        manager.run(lateTask);
+        ASSERT_FALSE(lateTask->getCompletionFuture().get());
+    }
+}
+
+TEST(WORKERS_TEST, RUN_BATCH_TEST)
+{
+    std::vector<ManagerConfig> configs(4, ManagerConfig(3));
+    configs[1].batchClaimSize = 8;
+    configs[2].queue = QueueMode::LOCK_FREE;
+    configs[2].batchClaimSize = 4;
+    configs[3].scheduling = SchedulingMode::WORK_STEALING;
+    configs[3].batchClaimSize = 16;
+
+    for(std::vector<ManagerConfig>::const_iterator config = configs.begin(); config != configs.end(); ++config)
+    {
+        Manager manager(*config);
+
+        std::vector< std::shared_ptr<Task> > tasks;
+        std::vector< std::future<bool> > futures;
+        for(size_t i = 0; i < 500; ++i)
+        {
+            tasks.push_back(std::shared_ptr<Task>(new TestTask()));
+            futures.push_back(tasks.back()->getCompletionFuture());
+        }
+
+        //one small batch that fits in the available workers, then one much bigger batch
+        manager.runBatch(&tasks[0], 2);
+        manager.runBatch(&tasks[2], tasks.size() - 2);
+
+        bool tasksCompleted = true;
+        for(std::vector< std::future<bool> >::iterator future = futures.begin(); future != futures.end(); ++future)
+        {
+            tasksCompleted &= future->get();
+        }
+        ASSERT_TRUE(tasksCompleted);
+
+        //null tasks are turned down while workers are idle, without losing a worker, and skipped in batches
+        manager.waitForTasksToComplete();
+        ASSERT_FALSE(manager.run(TaskHandle()));
+        ASSERT_FALSE(manager.tryRun(TaskHandle()));
+        std::vector<TaskHandle> withNull(3);
+        withNull[0] = TaskHandle(new TestTask());
+        withNull[2] = TaskHandle(new TestTask());
+        manager.runBatch(withNull);
+        ASSERT_TRUE(withNull[0]->waitForCompletion());
+        ASSERT_TRUE(withNull[2]->waitForCompletion());
+
+        manager.shutdown();
+
+        std::vector< std::shared_ptr<Task> > lateTasks;
+        lateTasks.push_back(std::shared_ptr<Task>(new TestTask()));
+        lateTasks.push_back(std::shared_ptr<Task>(new TestTask()));
+        manager.runBatch(lateTasks);
+        ASSERT_FALSE(lateTasks[0]->getCompletionFuture().get());
+        ASSERT_FALSE(lateTasks[1]->getCompletionFuture().get());
+    }
+}
+
+TEST(WORKERS_TEST, CONTINUATION_TEST)
+{
+    {
+        //result of each task is handed to the next, a single worker is enough since nothing blocks
+        Manager manager(1);
+        std::atomic<int> nbRun(0);
+
+        std::shared_ptr<Task> last = manager.runThen(std::shared_ptr<Task>(new TestTask()), [&nbRun](bool status) -> bool {
+            ++nbRun;
+            return !status;
+        })->then(manager, [&nbRun](bool status) -> bool {
+            ++nbRun;
+            return !status;
+        });
+
+        for(size_t i = 0; i < 100; ++i)
+        {
+            last = last->then(manager, [&nbRun](bool status) -> bool {
+                ++nbRun;
+                return status;
+            });
+        }
+
+        ASSERT_TRUE(last->getCompletionFuture().get());
+        ASSERT_EQ(102, nbRun);
+    }
+
+    {
+        //continuation added after completion still runs, a failed task passes on false
+        Manager manager(2);
+
+        std::shared_ptr<Task> task(new TestTask());
+        std::future<bool> taskFuture = task->getCompletionFuture();
+        manager.run(task);
+        ASSERT_TRUE(taskFuture.get());
+
+        std::shared_ptr<Task> afterCompletion = task->then(manager, [](bool status) -> bool {
+            return status;
+        });
+        ASSERT_TRUE(afterCompletion->getCompletionFuture().get());
+
+        std::shared_ptr<Task> failing(new ContinuationTask([](bool status) -> bool {
+            return false;
+        }));
+        std::shared_ptr<Task> afterFailure = manager.runThen(failing, [](bool status) -> bool {
+            return !status;
+        });
+        ASSERT_TRUE(afterFailure->getCompletionFuture().get());
+
+        //continuations can be tasks of their own
+        std::shared_ptr<Task> first(new TestTask());
+        std::shared_ptr<TestTask> second(new TestTask());
+        std::future<bool> secondFuture = second->getCompletionFuture();
+        first->then(manager, second);
+        manager.run(first);
+        ASSERT_TRUE(secondFuture.get());
+        ASSERT_TRUE(second->wasPerformed);
+    }
+
+    {
+        //continuation of a task that never runs is told it failed
+        std::shared_ptr<Task> continuation;
+        std::future<bool> future;
+        Manager manager(1);
+        {
+            std::shared_ptr<Task> task(new TestTask());
+            continuation = task->then(manager, [](bool status) -> bool {
+                return !status;
+            });
+            future = continuation->getCompletionFuture();
+        }
+        ASSERT_TRUE(future.get());
+    }
+}
+
+TEST(WORKERS_TEST, TASK_HANDLE_TEST)
+{
+    {
+        //task made with new is deleted along with its last handle
+        std::atomic<size_t> nbDestroyed(0);
+        TaskHandle task(new CountedTask(nbDestroyed));
+        TaskHandle copy = task;
+        TaskHandle moved(std::move(copy));
+
+        ASSERT_FALSE(copy);
+        ASSERT_EQ(task.get(), moved.get());
+
+        task.reset();
+        ASSERT_EQ(0, nbDestroyed);
+        moved.reset();
+        ASSERT_EQ(1, nbDestroyed);
+    }
+
+    {
+        //handles and the manager keep tasks alive until they have run
+        std::atomic<size_t> nbDestroyed(0);
+        Manager manager(2);
+        std::vector<std::future<bool> > futures;
+
+        for(size_t i = 0; i < 100; ++i)
+        {
+            TaskHandle task(new CountedTask(nbDestroyed));
+            futures.push_back(task->getCompletionFuture());
+            manager.run(task);
+        }
+        for(size_t i = 0; i < 100; ++i)
+        {
+            std::shared_ptr<Task> task(new CountedTask(nbDestroyed));
+            futures.push_back(task->getCompletionFuture());
+            manager.run(task);
+        }
+
+        for(std::vector<std::future<bool> >::iterator future = futures.begin(); future != futures.end(); ++future)
+        {
+            ASSERT_TRUE(future->get());
+        }
+        manager.shutdown();
+        ASSERT_EQ(200, nbDestroyed);
+    }
+
+    {
+        //a task owned by shared_ptrs outlives its handles while the shared_ptrs are around
+        std::atomic<size_t> nbDestroyed(0);
+        std::shared_ptr<Task> task(new CountedTask(nbDestroyed));
+        {
+            TaskHandle first(task);
+            TaskHandle second(task);
+        }
+        ASSERT_EQ(0, nbDestroyed);
+
+        TaskHandle handle(task);
+        task.reset();
+        ASSERT_EQ(0, nbDestroyed);
+        handle.reset();
+        ASSERT_EQ(1, nbDestroyed);
+    }
+
+    {
+        //pooled tasks from submit go back to the pool and are handed out again
+        Manager manager(1);
+        std::set<Task*> tasks;
+
+        for(size_t i = 0; i < 1000; ++i)
+        {
+            TaskHandle task = manager.submit([]() {});
+            tasks.insert(task.get());
+            ASSERT_TRUE(task->getCompletionFuture().get());
+        }
+        ASSERT_LT(tasks.size(), 1000u);
+    }
+}
+
+TEST(WORKERS_TEST, COMPLETION_TEST)
+{
+    {
+        //any number of threads can wait, and any number of futures can be asked for
+        TestTask task;
+        std::atomic<size_t> nbSucceeded(0);
+        std::vector<std::thread> waiters;
+        std::future<bool> first = task.getCompletionFuture();
+        std::future<bool> second = task.getCompletionFuture();
+
+        for(size_t i = 0; i < 8; ++i)
+        {
+            waiters.push_back(std::thread([&task, &nbSucceeded]() {
+                if(task.waitForCompletion())
+                {
+                    ++nbSucceeded;
+                }
+            }));
+        }
+
+        ASSERT_FALSE(task.isComplete());
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        task.perform([]()->void{});
+
+        for(std::vector<std::thread>::iterator waiter = waiters.begin(); waiter != waiters.end(); ++waiter)
+        {
+            waiter->join();
+        }
+        ASSERT_EQ(8, nbSucceeded);
+        ASSERT_TRUE(first.get());
+        ASSERT_TRUE(second.get());
+
+        //waiting on a completed task only reads its state
+        ASSERT_TRUE(task.isComplete());
+        ASSERT_TRUE(task.getCompletionStatus());
+        ASSERT_TRUE(task.waitForCompletion());
+        ASSERT_TRUE(task.getCompletionFuture().get());
+    }
+
+    {
+        //fan in on many tasks
+        Manager manager(2);
+        std::vector<TaskHandle> tasks;
+
+        for(size_t i = 0; i < 1000; ++i)
+        {
+            tasks.push_back(manager.submit([i]() -> bool { return 0 == i % 2; }));
+        }
+        for(size_t i = 0; i < tasks.size(); ++i)
+        {
+            ASSERT_EQ(0 == i % 2, tasks[i]->waitForCompletion());
+        }
+    }
+
+    {
+        //waiters of a failed task are told so, and hold the task alive while waiting
+        std::atomic<size_t> nbDestroyed(0);
+        TaskHandle task(new CountedTask(nbDestroyed));
+        TaskHandle waited = task;
+        std::thread waiter([&waited]() {
+            ASSERT_FALSE(waited->waitForCompletion());
+            waited.reset();
+        });
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        task->setCompletionStatus(false);
+        task.reset();
+        waiter.join();
+        ASSERT_EQ(1, nbDestroyed);
+    }
+}
+
+TEST(WORKERS_TEST, PRIORITY_TEST)
+{
+    for(size_t modeIdx = 0; modeIdx < 2; ++modeIdx)
+    {
+        //a single worker kept busy while tasks of every priority queue up behind it
+        ManagerConfig config(1);
+        config.queue = (0 == modeIdx) ? QueueMode::LOCKED : QueueMode::LOCK_FREE;
+        config.agingThreshold = std::chrono::milliseconds(60000);
+        Manager manager(config);
+
+        std::atomic<bool> gate(false);
+        std::vector<Priority> order;
+        std::vector<TaskHandle> tasks;
+        manager.submit([&gate]() {
+            while(!gate)
+            {
+                std::this_thread::yield();
+            }
+        });
+
+        const Priority priorities[] = { Priority::LOW, Priority::NORMAL, Priority::CRITICAL, Priority::HIGH };
+        for(size_t i = 0; i < 40; ++i)
+        {
+            const Priority priority = priorities[i % 4];
+            tasks.push_back(manager.submit([&order, priority]() { order.push_back(priority); }, priority));
+        }
+        gate = true;
+        for(std::vector<TaskHandle>::iterator task = tasks.begin(); task != tasks.end(); ++task)
+        {
+            (*task)->waitForCompletion();
+        }
+
+        //highest band first, each band in the order it was run
+        ASSERT_EQ(40u, order.size());
+        for(size_t i = 1; i < order.size(); ++i)
+        {
+            ASSERT_LE(order[i - 1], order[i]);
+        }
+
+        ASSERT_EQ(10u, manager.getQueueWaitTimes(Priority::CRITICAL).getCount());
+        ASSERT_EQ(10u, manager.getQueueWaitTimes(Priority::LOW).getCount());
+        //the task holding the gate found the worker idle
+        ASSERT_EQ(11u, manager.getQueueWaitTimes(Priority::NORMAL).getCount());
+        ASSERT_GE(manager.getQueueWaitTimes(Priority::LOW).getMax(), manager.getQueueWaitTimes(Priority::CRITICAL).getMax());
+    }
+
+    {
+        //low priority work passed over for longer than the aging threshold goes ahead of higher bands
+        ManagerConfig config(1);
+        config.agingThreshold = std::chrono::milliseconds(1);
+        Manager manager(config);
+
+        std::atomic<bool> gate(false);
+        std::vector<Priority> order;
+        std::vector<TaskHandle> tasks;
+        manager.submit([&gate]() {
+            while(!gate)
+            {
+                std::this_thread::yield();
+            }
+        });
+
+        tasks.push_back(manager.submit([&order]() { order.push_back(Priority::LOW); }, Priority::LOW));
+        for(size_t i = 0; i < 100; ++i)
+        {
+            tasks.push_back(manager.submit([&order]() { order.push_back(Priority::HIGH); }, Priority::HIGH));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        gate = true;
+        for(std::vector<TaskHandle>::iterator task = tasks.begin(); task != tasks.end(); ++task)
+        {
+            (*task)->waitForCompletion();
+        }
+
+        ASSERT_EQ(101u, order.size());
+        ASSERT_EQ(Priority::LOW, order[0]);
+    }
+
+    {
+        //urgent tasks run from a work stealing worker skip its deque
+        ManagerConfig config(1, SchedulingMode::WORK_STEALING);
+        config.agingThreshold = std::chrono::milliseconds(60000);
+        Manager manager(config);
+        std::vector<Priority> order;
+        std::vector<TaskHandle> tasks;
+
+        manager.submit([&manager, &order, &tasks]() {
+            for(size_t i = 0; i < 10; ++i)
+            {
+                tasks.push_back(manager.submit([&order]() { order.push_back(Priority::NORMAL); }));
+            }
+            tasks.push_back(manager.submit([&order]() { order.push_back(Priority::CRITICAL); }, Priority::CRITICAL));
+        })->waitForCompletion();
+        for(std::vector<TaskHandle>::iterator task = tasks.begin(); task != tasks.end(); ++task)
+        {
+            (*task)->waitForCompletion();
+        }
+
+        ASSERT_EQ(11u, order.size());
+        ASSERT_EQ(Priority::CRITICAL, order[0]);
+    }
+}
+
+TEST(WORKERS_TEST, TIMER_WHEEL_TEST)
+{
+    TimerWheel<int> wheel;
+    std::vector<int> expired;
+    ASSERT_TRUE(wheel.empty());
+    ASSERT_EQ(UINT64_MAX, wheel.getNextTick());
+
+    //timers in every level fire on exactly their tick
+    const uint64_t expiries[] = { 1, 63, 64, 65, 4095, 4096, 5000, 300000, 20000000 };
+    const size_t nbExpiries = sizeof(expiries) / sizeof(expiries[0]);
+    for(size_t i = 0; i < nbExpiries; ++i)
+    {
+        wheel.add(expiries[i], static_cast<int>(i));
+    }
+    ASSERT_EQ(nbExpiries, wheel.size());
+    for(size_t i = 0; i < nbExpiries; ++i)
+    {
+        ASSERT_LE(wheel.getNextTick(), expiries[i]);
+        wheel.advance(expiries[i] - 1, expired);
+        ASSERT_TRUE(expired.empty());
+        wheel.advance(expiries[i], expired);
+        ASSERT_EQ(1u, expired.size());
+        ASSERT_EQ(static_cast<int>(i), expired[0]);
+        expired.clear();
+    }
+    ASSERT_TRUE(wheel.empty());
+
+    //cancelled timers never fire, and their ids go stale
+    int value = 0;
+    TimerId first = wheel.add(wheel.getCurrentTick() + 10, 1);
+    TimerId second = wheel.add(wheel.getCurrentTick() + 10, 2);
+    ASSERT_TRUE(wheel.cancel(first, value));
+    ASSERT_EQ(1, value);
+    ASSERT_FALSE(wheel.cancel(first, value));
+    ASSERT_FALSE(wheel.cancel(TimerId(), value));
+    wheel.add(wheel.getCurrentTick() + 10, 3);
+    ASSERT_FALSE(wheel.cancel(first, value));
+    wheel.advance(wheel.getCurrentTick() + 10, expired);
+    ASSERT_EQ(2u, expired.size());
+    ASSERT_FALSE(wheel.cancel(second, value));
+    expired.clear();
+
+    //periodic timers keep firing until cancelled, skipping periods we were too late for
+    TimerId periodic = wheel.add(wheel.getCurrentTick() + 5, 4, 5);
+    for(size_t i = 0; i < 3; ++i)
+    {
+        wheel.advance(wheel.getCurrentTick() + 5, expired);
+    }
+    ASSERT_EQ(3u, expired.size());
+    expired.clear();
+    wheel.advance(wheel.getCurrentTick() + 100, expired);
+    ASSERT_EQ(1u, expired.size());
+    expired.clear();
+    ASSERT_TRUE(wheel.cancel(periodic, value));
+    ASSERT_EQ(4, value);
+    wheel.advance(wheel.getCurrentTick() + 100, expired);
+    ASSERT_TRUE(expired.empty());
+
+    //clearing hands every value back
+    for(int i = 0; i < 100; ++i)
+    {
+        wheel.add(wheel.getCurrentTick() + i * 1000, i);
+    }
+    wheel.clear(expired);
+    ASSERT_EQ(100u, expired.size());
+    ASSERT_TRUE(wheel.empty());
+}
+
+TEST(WORKERS_TEST, TIMER_TEST)
+{
+    Manager manager(2);
+
+    {
+        //delayed tasks never run early
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::shared_ptr<TestTask> task(new TestTask());
+        manager.runAfter(std::chrono::milliseconds(20), task);
+        ASSERT_TRUE(task->waitForCompletion());
+        ASSERT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+
+        std::chrono::steady_clock::time_point time = std::chrono::steady_clock::now() + std::chrono::milliseconds(10);
+        std::shared_ptr<TestTask> timedTask(new TestTask());
+        manager.runAt(time, timedTask, Priority::HIGH);
+        ASSERT_TRUE(timedTask->waitForCompletion());
+        ASSERT_GE(std::chrono::steady_clock::now(), time);
+    }
+
+    {
+        //periodic functions run until cancelled
+        std::atomic<size_t> nbRuns(0);
+        TimerId timer = manager.runEvery(std::chrono::milliseconds(1), [&nbRuns]() { ++nbRuns; });
+        while(nbRuns < 5)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        ASSERT_TRUE(manager.cancelTimer(timer));
+        ASSERT_FALSE(manager.cancelTimer(timer));
+        manager.waitForTasksToComplete();
+
+        //no period, or a negative one, still repeats, every tick
+        const std::chrono::milliseconds periods[] = { std::chrono::milliseconds(0), std::chrono::milliseconds(-5) };
+        for(size_t periodIdx = 0; periodIdx < 2; ++periodIdx)
+        {
+            nbRuns = 0;
+            timer = manager.runEvery(periods[periodIdx], [&nbRuns]() { ++nbRuns; });
+            for(size_t i = 0; i < 2000 && nbRuns < 3; ++i)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            ASSERT_LE(3u, nbRuns);
+            ASSERT_TRUE(manager.cancelTimer(timer));
+            manager.waitForTasksToComplete();
+        }
+    }
+
+    {
+        //cancelling a delayed task fails it
+        std::shared_ptr<TestTask> task(new TestTask());
+        TimerId timer = manager.runAfter(std::chrono::seconds(60), task);
+        ASSERT_TRUE(manager.cancelTimer(timer));
+        ASSERT_FALSE(task->waitForCompletion());
+        ASSERT_FALSE(task->wasPerformed);
+    }
+
+    {
+        //lots of pending timers are cheap to add and cancel
+        std::vector<TimerId> timers;
+        for(size_t i = 0; i < 100000; ++i)
+        {
+            timers.push_back(manager.runAfter(std::chrono::milliseconds(1000 + i), TaskHandle(new TestTask())));
+        }
+        for(std::vector<TimerId>::iterator timer = timers.begin(); timer != timers.end(); ++timer)
+        {
+            ASSERT_TRUE(manager.cancelTimer(*timer));
+        }
+    }
+
+    {
+        //shutting down fails whatever is still waiting for its time
+        Manager other(1);
+        std::shared_ptr<TestTask> task(new TestTask());
+        other.runAfter(std::chrono::seconds(60), task);
+        other.shutdown();
+        ASSERT_FALSE(task->waitForCompletion());
+
+        std::shared_ptr<TestTask> lateTask(new TestTask());
+        other.runAfter(std::chrono::milliseconds(1), lateTask);
+        ASSERT_FALSE(lateTask->waitForCompletion());
+    }
+}
+
+//wait up to a couple of seconds for a condition to become true
+template<typename Condition>
+static bool waitFor(Condition condition)
+{
+    for(size_t i = 0; i < 2000 && !condition(); ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return condition();
+}
+
+TEST(WORKERS_TEST, ELASTIC_TEST)
+{
+    const SchedulingMode schedulings[] = { SchedulingMode::FIFO, SchedulingMode::WORK_STEALING };
+    const QueueMode queues[] = { QueueMode::LOCKED, QueueMode::LOCK_FREE };
+
+    for(size_t schedulingIdx = 0; schedulingIdx < 2; ++schedulingIdx)
+    {
+        for(size_t queueIdx = 0; queueIdx < 2; ++queueIdx)
+        {
+            ManagerConfig config(1, schedulings[schedulingIdx]);
+            config.queue = queues[queueIdx];
+            config.maxWorkers = 4;
+            config.growQueueDepth = 1;
+            config.keepAlive = std::chrono::milliseconds(20);
+            Manager manager(config);
+            ASSERT_EQ(1u, manager.getNbWorkers());
+
+            //blocked tasks piling up in the queue bring in more workers, up to the maximum
+            std::atomic<bool> gate(false);
+            std::atomic<size_t> nbRunning(0);
+            std::vector<TaskHandle> tasks;
+            for(size_t i = 0; i < 8; ++i)
+            {
+                tasks.push_back(manager.submit([&gate, &nbRunning]() {
+                    ++nbRunning;
+                    while(!gate)
+                    {
+                        std::this_thread::yield();
+                    }
+                }));
+            }
+            ASSERT_TRUE(waitFor([&nbRunning]() { return 4 == nbRunning; }));
+            ASSERT_EQ(4u, manager.getNbWorkers());
+
+            gate = true;
+            for(std::vector<TaskHandle>::iterator task = tasks.begin(); task != tasks.end(); ++task)
+            {
+                ASSERT_TRUE((*task)->waitForCompletion());
+            }
+
+            //once idle they retire, down to the minimum
+            ASSERT_TRUE(waitFor([&manager]() { return 1 == manager.getNbWorkers(); }));
+
+            //and the pool keeps working afterwards
+            std::atomic<size_t> nbPerformed(0);
+            for(size_t i = 0; i < 100; ++i)
+            {
+                tasks[i % tasks.size()] = manager.submit([&nbPerformed]() { ++nbPerformed; });
+            }
+            manager.waitForTasksToComplete();
+            ASSERT_TRUE(waitFor([&nbPerformed]() { return 100 == nbPerformed; }));
+        }
+    }
+
+    {
+        //shutting down while growing and retiring
+        ManagerConfig config(1);
+        config.maxWorkers = 8;
+        config.growQueueDepth = 1;
+        config.keepAlive = std::chrono::milliseconds(1);
+        Manager manager(config);
+        for(size_t i = 0; i < 1000; ++i)
+        {
+            manager.submit([]() { std::this_thread::sleep_for(std::chrono::microseconds(10)); });
+        }
+        manager.shutdown();
+        ASSERT_EQ(0u, manager.getNbWorkers());
+    }
+}
+
+TEST(WORKERS_TEST, TOPOLOGY_TEST)
+{
+    std::vector<int> cpus = Topology::parseCpuList("0-3,8,10-11\n");
+    const int expected[] = { 0, 1, 2, 3, 8, 10, 11 };
+    ASSERT_EQ(std::vector<int>(expected, expected + 7), cpus);
+    ASSERT_TRUE(Topology::parseCpuList("").empty());
+    ASSERT_EQ(std::vector<int>(1, 5), Topology::parseCpuList("x,5,3-1"));
+
+    Topology topology;
+    topology.addNode(Topology::parseCpuList("0-1"));
+    topology.addNode(Topology::parseCpuList("2-3"));
+    ASSERT_EQ(2u, topology.getNbNodes());
+    ASSERT_EQ(4u, topology.getNbCpus());
+    ASSERT_EQ(1, topology.getNode(3));
+    ASSERT_EQ(-1, topology.getNode(4));
+
+    //whatever the machine, we can run somewhere
+    Topology machine = Topology::read();
+    ASSERT_GE(machine.getNbNodes(), 1u);
+    ASSERT_GE(machine.getNbCpus(), 1u);
+
+    const SchedulingMode schedulings[] = { SchedulingMode::FIFO, SchedulingMode::WORK_STEALING };
+    for(size_t schedulingIdx = 0; schedulingIdx < 2; ++schedulingIdx)
+    {
+        //workers pinned to a single processor stay on it
+        const int cpu = machine.getCpus(0)[0];
+        ManagerConfig config(2, schedulings[schedulingIdx]);
+        config.placement = WorkerPlacement::CORE;
+        config.cpus.push_back(cpu);
+        Manager manager(config);
+
+        std::atomic<int> ranOn(-2);
+        manager.submit([&ranOn]() { ranOn = Topology::getCurrentCpu(); })->waitForCompletion();
+        if(ranOn >= 0)
+        {
+            ASSERT_EQ(cpu, ranOn);
+        }
+    }
+
+    {
+        //tasks hinted at a node run there
+        ManagerConfig config(2 * machine.getNbNodes());
+        config.placement = WorkerPlacement::NODE;
+        Manager manager(config);
+
+        for(size_t node = 0; node < machine.getNbNodes(); ++node)
+        {
+            std::atomic<int> ranOn(-2);
+            TaskHandle task(CallableTask::create([&ranOn]() { ranOn = Topology::getCurrentCpu(); }));
+            task->setNodeHint(static_cast<int>(node));
+            manager.run(task);
+            task->waitForCompletion();
+            if(ranOn >= 0)
+            {
+                ASSERT_EQ(static_cast<int>(node), machine.getNode(ranOn));
+            }
+        }
+    }
+}
+
+TEST(WORKERS_TEST, WAIT_STRATEGY_TEST)
+{
+    {
+        //spinning workers take handoffs one after another, then stop cleanly
+        Worker worker([](Worker* worker)->void {}, 0, std::function<void (Worker*)>(), WaitStrategy(1000, 4));
+        worker.waitUntilReady();
+        for(size_t i = 0; i < 1000; ++i)
+        {
+            std::shared_ptr<TestTask> task(new TestTask());
+            worker.runTask(task);
+            ASSERT_TRUE(task->waitForCompletion());
+            if(0 == i % 100)
+            {
+                //long enough for the worker to end up asleep
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    }
+
+    {
+        //shutting down while spinning
+        Worker worker([](Worker* worker)->void {}, 0, std::function<void (Worker*)>(), WaitStrategy(1000000, 1000));
+        worker.waitUntilReady();
+        worker.shutdown();
+
+        //tasks handed over once shut down fail
+        std::shared_ptr<TestTask> task(new TestTask());
+        worker.runTask(task);
+        ASSERT_FALSE(task->waitForCompletion());
+    }
+
+    {
+        //a manager of spinning workers runs everything
+        ManagerConfig config(2, SchedulingMode::WORK_STEALING);
+        config.waitStrategy = WaitStrategy(2000, 4);
+        Manager manager(config);
+        std::atomic<size_t> nbPerformed(0);
+        std::shared_ptr<Task> root(new SpawningTask(manager, 10, nbPerformed));
+        manager.run(root);
+        ASSERT_TRUE(waitFor([&nbPerformed]() { return 2047 == nbPerformed; }));
+        manager.waitForTasksToComplete();
+    }
+}
+
+TEST(WORKERS_TEST, PARALLEL_FOR_TEST)
+{
+    const SchedulingMode schedulings[] = { SchedulingMode::FIFO, SchedulingMode::WORK_STEALING };
+    for(size_t schedulingIdx = 0; schedulingIdx < 2; ++schedulingIdx)
+    {
+        Manager manager(ManagerConfig(3, schedulings[schedulingIdx]));
+
+        //every index is visited exactly once, whichever way the range is split
+        const size_t sizes[] = { 1, 2, 3, 7, 100, 100000 };
+        for(size_t sizeIdx = 0; sizeIdx < 6; ++sizeIdx)
+        {
+            const size_t size = sizes[sizeIdx];
+            std::vector< std::atomic<int> > visits(size);
+            for(size_t i = 0; i < size; ++i)
+            {
+                visits[i] = 0;
+            }
+
+            parallel_for(manager, size_t(0), size, [&visits](const size_t i) { ++visits[i]; });
+            parallel_for(manager, size_t(0), size, [&visits](const size_t i) { ++visits[i]; }, static_partitioner());
+            parallel_for(manager, size_t(0), size, [&visits](const size_t i) { ++visits[i]; }, auto_partitioner(16));
+            for(size_t i = 0; i < size; ++i)
+            {
+                ASSERT_EQ(3, visits[i]);
+            }
+        }
+
+        //any integer range, empty ones do nothing
+        std::atomic<int> sum(0);
+        parallel_for(manager, -50, 51, [&sum](const int i) { sum += i; });
+        ASSERT_EQ(0, sum);
+        parallel_for(manager, 10, 10, [&sum](const int i) { sum += 1; });
+        parallel_for(manager, 10, 0, [&sum](const int i) { sum += 1; });
+        ASSERT_EQ(0, sum);
+
+        //uneven work still gets shared out
+        std::atomic<size_t> nbVisited(0);
+        parallel_for(manager, 0, 64, [&nbVisited](const int i) {
+            if(i < 4)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+            ++nbVisited;
+        });
+        ASSERT_EQ(64u, nbVisited);
+
+        //nested loops run from inside tasks, even with every worker taking part
+        std::atomic<size_t> nbInner(0);
+        parallel_for(manager, 0, 8, [&manager, &nbInner](const int i) {
+            parallel_for(manager, 0, 1000, [&nbInner](const int j) { ++nbInner; });
+        });
+        ASSERT_EQ(8000u, nbInner);
+        manager.waitForTasksToComplete();
+    }
+
+    {
+        //once shut down the calling thread does everything itself
+        Manager manager(2);
+        manager.shutdown();
+        std::atomic<size_t> nbVisited(0);
+        parallel_for(manager, 0, 1000, [&nbVisited](const int i) { ++nbVisited; }, static_partitioner());
+        parallel_for(manager, 0, 1000, [&nbVisited](const int i) { ++nbVisited; });
+        ASSERT_EQ(2000u, nbVisited);
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST(WORKERS_TEST, CONCURRENT_VECTOR_TEST)
+{
+    {
+        concurrent_vector<std::string> strings;
+        ASSERT_TRUE(strings.empty());
+        ASSERT_EQ(0u, strings.capacity());
+
+        //elements keep their address however much it grows
+        strings.push_back("first");
+        const std::string* first = &strings[0];
+        for(size_t i = 1; i < 10000; ++i)
+        {
+            concurrent_vector<std::string>::iterator pushed = strings.push_back(std::to_string(i));
+            ASSERT_EQ(std::to_string(i), *pushed);
+        }
+        ASSERT_EQ(10000u, strings.size());
+        ASSERT_GE(strings.capacity(), 10000u);
+        ASSERT_EQ(first, &strings[0]);
+        ASSERT_EQ("first", strings.at(0));
+        ASSERT_EQ("9999", strings.at(9999));
+        ASSERT_THROW(strings.at(10000), std::out_of_range);
+
+        size_t index = 0;
+        for(concurrent_vector<std::string>::const_iterator string = strings.begin(); string != strings.end(); ++string, ++index)
+        {
+            ASSERT_EQ(&strings[index], &(*string));
+        }
+        ASSERT_EQ(10000, strings.end() - strings.begin());
+
+        strings.clear();
+        ASSERT_TRUE(strings.empty());
+        strings.emplace_back(3, 'a');
+        ASSERT_EQ("aaa", strings[0]);
+    }
+
+    {
+        concurrent_vector<int> values(10, 7);
+        ASSERT_EQ(10u, values.size());
+        ASSERT_EQ(7, values[9]);
+        values.reserve(1000);
+        ASSERT_GE(values.capacity(), 1000u);
+        ASSERT_EQ(10u, values.size());
+    }
+
+    {
+        //elements aligned beyond what operator new guarantees get their alignment in every segment
+        struct alignas(128) Line {
+            int value;
+        };
+        concurrent_vector<Line> lines;
+        for(int i = 0; i < 100; ++i)
+        {
+            Line line;
+            line.value = i;
+            ASSERT_EQ(0u, reinterpret_cast<uintptr_t>(&*lines.push_back(line)) % 128);
+        }
+        ASSERT_EQ(99, lines[99].value);
+    }
+
+    {
+        //pushes from every worker at once all land, each in its own slot
+        Manager manager(4);
+        concurrent_vector<size_t> values;
+        parallel_for(manager, size_t(0), size_t(100000), [&values](const size_t i) { values.push_back(i); });
+        ASSERT_EQ(100000u, values.size());
+
+        std::vector<size_t> sorted(values.begin(), values.end());
+        std::sort(sorted.begin(), sorted.end());
+        for(size_t i = 0; i < sorted.size(); ++i)
+        {
+            ASSERT_EQ(i, sorted[i]);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST(WORKERS_TEST, COMBINABLE_TEST)
+{
+    {
+        combinable<int> counts([]() { return 10; });
+        bool exists = true;
+        ASSERT_EQ(10, counts.local(exists));
+        ASSERT_FALSE(exists);
+        counts.local(exists) += 5;
+        ASSERT_TRUE(exists);
+        ASSERT_EQ(15, counts.combine(std::plus<int>()));
+
+        //every thread gets its own value, no matter how many
+        std::vector<std::thread> threads;
+        for(int threadIdx = 0; threadIdx < 8; ++threadIdx)
+        {
+            threads.push_back(std::thread([&counts]() {
+                for(int i = 0; i < 1000; ++i)
+                {
+                    ++counts.local();
+                }
+            }));
+        }
+        for(std::vector<std::thread>::iterator thread = threads.begin(); thread != threads.end(); ++thread)
+        {
+            thread->join();
+        }
+        ASSERT_EQ(15 + 8 * 1010, counts.combine(std::plus<int>()));
+
+        int nbValues = 0;
+        counts.combine_each([&nbValues](const int count) { ++nbValues; });
+        ASSERT_EQ(9, nbValues);
+
+        counts.clear();
+        ASSERT_EQ(0, counts.combine(std::plus<int>()));
+        ASSERT_EQ(10, counts.local());
+    }
+
+    {
+        //histogram built from the manager's tasks
+        Manager manager(4);
+        combinable< std::map<int, int> > histograms;
+        std::vector<TaskHandle> tasks;
+        for(int taskIdx = 0; taskIdx < 1000; ++taskIdx)
+        {
+            tasks.push_back(manager.submit([&histograms, taskIdx]() { ++histograms.local()[taskIdx % 10]; }));
+        }
+        for(std::vector<TaskHandle>::iterator task = tasks.begin(); task != tasks.end(); ++task)
+        {
+            (*task)->waitForCompletion();
+        }
+
+        std::map<int, int> histogram;
+        histograms.combine_each([&histogram](const std::map<int, int>& local) {
+            for(std::map<int, int>::const_iterator bucket = local.begin(); bucket != local.end(); ++bucket)
+            {
+                histogram[bucket->first] += bucket->second;
+            }
+        });
+        ASSERT_EQ(10u, histogram.size());
+        for(std::map<int, int>::const_iterator bucket = histogram.begin(); bucket != histogram.end(); ++bucket)
+        {
+            ASSERT_EQ(100, bucket->second);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST(WORKERS_TEST, PARALLEL_REDUCE_TEST)
+{
+    const SchedulingMode schedulings[] = { SchedulingMode::FIFO, SchedulingMode::WORK_STEALING };
+    for(size_t schedulingIdx = 0; schedulingIdx < 2; ++schedulingIdx)
+    {
+        Manager manager(ManagerConfig(3, schedulings[schedulingIdx]));
+
+        const uint64_t sizes[] = { 1, 2, 7, 100, 100000 };
+        for(size_t sizeIdx = 0; sizeIdx < 5; ++sizeIdx)
+        {
+            const uint64_t size = sizes[sizeIdx];
+            const uint64_t expected = size * (size - 1) / 2;
+            const std::function<uint64_t (uint64_t, uint64_t)> add = [](const uint64_t sum, const uint64_t i) { return sum + i; };
+            ASSERT_EQ(expected, parallel_reduce(manager, uint64_t(0), size, uint64_t(0), add, std::plus<uint64_t>()));
+            ASSERT_EQ(expected, parallel_reduce(manager, uint64_t(0), size, uint64_t(0), add, std::plus<uint64_t>(), static_partitioner()));
+            ASSERT_EQ(expected, parallel_reduce(manager, uint64_t(0), size, uint64_t(0), add, std::plus<uint64_t>(), auto_partitioner(16)));
+        }
+
+        //empty ranges give back the identity
+        ASSERT_EQ(42, parallel_reduce(manager, 5, 5, 42, [](const int sum, const int i) { return sum + i; }, std::plus<int>()));
+
+        //the identity is used once per sub range, so it must not change the result
+        const bool allPositive = parallel_reduce(manager, 1, 1000, true,
+            [](const bool result, const int i) { return result && i > 0; }, std::logical_and<bool>());
+        ASSERT_TRUE(allPositive);
+        const int maximum = parallel_reduce(manager, -500, 500, INT_MIN,
+            [](const int result, const int i) { return std::max(result, (i * 37) % 1000); }, [](const int a, const int b) { return std::max(a, b); });
+        ASSERT_EQ(999, maximum);
+        manager.waitForTasksToComplete();
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST(WORKERS_TEST, TASK_GRAPH_TEST)
+{
+    const SchedulingMode schedulings[] = { SchedulingMode::FIFO, SchedulingMode::WORK_STEALING };
+    for(size_t schedulingIdx = 0; schedulingIdx < 2; ++schedulingIdx)
+    {
+        Manager manager(ManagerConfig(2, schedulings[schedulingIdx]));
+
+        {
+            //diamond, every node sees what its predecessors did, again on every run
+            std::atomic<int> sequence(0);
+            std::vector< std::atomic<int> > order(4);
+            TaskGraph graph;
+            size_t nodes[4];
+            for(size_t nodeIdx = 0; nodeIdx < 4; ++nodeIdx)
+            {
+                nodes[nodeIdx] = graph.addNode([&sequence, &order, nodeIdx]() { order[nodeIdx] = ++sequence; });
+            }
+            graph.addEdge(nodes[0], nodes[1]);
+            graph.addEdge(nodes[0], nodes[2]);
+            graph.addEdge(nodes[1], nodes[3]);
+            graph.addEdge(nodes[2], nodes[3]);
+            ASSERT_EQ(4u, graph.getNbNodes());
+
+            for(int runIdx = 0; runIdx < 100; ++runIdx)
+            {
+                sequence = 0;
+                ASSERT_TRUE(graph.run(manager));
+                ASSERT_TRUE(graph.wait());
+                ASSERT_FALSE(graph.isRunning());
+                ASSERT_EQ(1, order[0]);
+                ASSERT_LT(order[1], order[3]);
+                ASSERT_LT(order[2], order[3]);
+                ASSERT_EQ(4, order[3]);
+            }
+        }
+
+        {
+            //far more nodes waiting on others than there are workers, which would deadlock blocking on futures
+            std::atomic<int> nbRun(0);
+            std::atomic<bool> isReleased(false);
+            TaskGraph graph;
+            const size_t first = graph.addNode([&nbRun, &isReleased]() {
+                ASSERT_TRUE(waitFor([&isReleased]() { return isReleased.load(); }));
+                ++nbRun;
+            });
+            const size_t last = graph.addNode([&nbRun]() { ++nbRun; });
+            size_t previous = first;
+            for(int nodeIdx = 0; nodeIdx < 200; ++nodeIdx)
+            {
+                const size_t node = graph.addNode([&nbRun]() { ++nbRun; });
+                graph.addEdge(first, node);
+                graph.addEdge(previous, node);
+                graph.addEdge(node, last);
+                previous = node;
+            }
+            ASSERT_TRUE(graph.run(manager));
+            //not allowed to start again until finished
+            ASSERT_TRUE(graph.isRunning());
+            ASSERT_FALSE(graph.run(manager));
+            isReleased = true;
+            ASSERT_TRUE(graph.wait());
+            ASSERT_EQ(202, nbRun);
+        }
+
+        {
+            //a failed node skips everything after it, the rest still runs
+            std::atomic<int> nbRun(0);
+            TaskGraph graph;
+            const size_t failing = graph.addNode([]() { return false; });
+            const size_t after = graph.addNode([&nbRun]() { ++nbRun; });
+            const size_t afterAfter = graph.addNode([&nbRun]() { ++nbRun; });
+            const size_t other = graph.addNode([&nbRun]() { ++nbRun; return true; });
+            graph.addEdge(failing, after);
+            graph.addEdge(after, afterAfter);
+            graph.addEdge(other, afterAfter);
+            ASSERT_TRUE(graph.run(manager));
+            ASSERT_FALSE(graph.wait());
+            ASSERT_EQ(1, nbRun);
+        }
+
+        {
+            //cycles are refused, empty graphs finish straight away
+            TaskGraph graph;
+            ASSERT_TRUE(graph.run(manager));
+            ASSERT_TRUE(graph.wait());
+
+            const size_t first = graph.addNode([]() {});
+            const size_t second = graph.addNode([]() {});
+            graph.addEdge(first, second);
+            graph.addEdge(second, first);
+            ASSERT_FALSE(graph.run(manager));
+            ASSERT_FALSE(graph.isRunning());
+        }
+    }
+
+    {
+        //nodes the manager drops once shut down count as failed, waiting does not hang
+        Manager manager(2);
+        manager.shutdown();
+        std::atomic<int> nbRun(0);
+        TaskGraph graph;
+        const size_t first = graph.addNode([&nbRun]() { ++nbRun; });
+        graph.addEdge(first, graph.addNode([&nbRun]() { ++nbRun; }));
+        graph.addNode([&nbRun]() { ++nbRun; });
+        ASSERT_TRUE(graph.run(manager));
+        ASSERT_FALSE(graph.wait());
+        ASSERT_EQ(0, nbRun);
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST(WORKERS_TEST, OVERFLOW_TEST)
+{
+    const QueueMode queues[] = { QueueMode::LOCKED, QueueMode::LOCK_FREE };
+    const OverflowPolicy policies[] = { OverflowPolicy::BLOCK, OverflowPolicy::REJECT, OverflowPolicy::CALLER_RUNS, OverflowPolicy::DROP_OLDEST };
+    for(size_t queueIdx = 0; queueIdx < 2; ++queueIdx)
+    {
+        for(size_t policyIdx = 0; policyIdx < 4; ++policyIdx)
+        {
+            ManagerConfig config(1);
+            config.queue = queues[queueIdx];
+            config.maxQueuedTasks = 2;
+            config.overflowPolicy = policies[policyIdx];
+            Manager manager(config);
+
+            //keep the only worker busy, then fill the queue
+            std::atomic<bool> isStarted(false);
+            std::atomic<bool> isReleased(false);
+            TaskHandle gate = manager.submit([&isStarted, &isReleased]() {
+                isStarted = true;
+                while(!isReleased)
+                {
+                    std::this_thread::yield();
+                }
+            });
+            ASSERT_TRUE(waitFor([&isStarted]() { return isStarted.load(); }));
+            TaskHandle first = manager.submit([]() {});
+            TaskHandle second = manager.submit([]() {});
+
+            //trying never waits and leaves the task alone, whatever the policy
+            std::thread::id ranOn;
+            TaskHandle overflow = CallableTask::create([&ranOn]() { ranOn = std::this_thread::get_id(); });
+            ASSERT_FALSE(manager.tryRun(overflow));
+            ASSERT_FALSE(overflow->isComplete());
+
+            switch(policies[policyIdx])
+            {
+            case OverflowPolicy::BLOCK:
+            {
+                //the timer thread runs an expired timer itself rather than wait, holding up the other timers
+                TaskHandle timed = CallableTask::create([]() {});
+                manager.runAfter(std::chrono::milliseconds(1), timed);
+                ASSERT_TRUE(timed->waitForCompletion());
+
+                std::atomic<bool> isRun(false);
+                std::thread producer([&manager, &overflow, &isRun]() { isRun = manager.run(overflow); });
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                ASSERT_FALSE(isRun);
+                isReleased = true;
+                producer.join();
+                ASSERT_TRUE(isRun);
+                ASSERT_TRUE(overflow->waitForCompletion());
+                break;
+            }
+            case OverflowPolicy::REJECT:
+                ASSERT_FALSE(manager.run(overflow));
+                ASSERT_TRUE(overflow->isComplete());
+                ASSERT_FALSE(overflow->getCompletionStatus());
+                break;
+            case OverflowPolicy::CALLER_RUNS:
+                ASSERT_TRUE(manager.run(overflow));
+                ASSERT_TRUE(overflow->isComplete());
+                ASSERT_TRUE(overflow->getCompletionStatus());
+                ASSERT_EQ(std::this_thread::get_id(), ranOn);
+                ASSERT_EQ(1u, manager.getStats().nbCallerRunTasks);
+                break;
+            case OverflowPolicy::DROP_OLDEST:
+                ASSERT_TRUE(manager.run(overflow));
+                ASSERT_TRUE(first->isComplete());
+                ASSERT_FALSE(first->getCompletionStatus());
+                break;
+            }
+
+            isReleased = true;
+            ASSERT_TRUE(gate->waitForCompletion());
+            ASSERT_TRUE(second->waitForCompletion());
+            overflow->waitForCompletion();
+            if(OverflowPolicy::DROP_OLDEST != policies[policyIdx])
+            {
+                ASSERT_TRUE(first->waitForCompletion());
+            }
+        }
+    }
+
+    {
+        //memory stays bounded with a producer far faster than the pool
+        ManagerConfig config(2);
+        config.maxQueuedTasks = 16;
+        Manager manager(config);
+        std::atomic<size_t> nbRun(0);
+        for(int taskIdx = 0; taskIdx < 10000; ++taskIdx)
+        {
+            ASSERT_TRUE(manager.run(CallableTask::create([&nbRun]() { ++nbRun; })));
+        }
+        ASSERT_TRUE(waitFor([&nbRun]() { return 10000u == nbRun; }));
+
+        //once shut down, nothing is accepted
+        manager.shutdown();
+        TaskHandle task = CallableTask::create([]() {});
+        ASSERT_FALSE(manager.tryRun(task));
+        ASSERT_TRUE(task->isComplete());
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST(WORKERS_TEST, STATS_TEST)
+{
+    Manager manager(2);
+
+    //nothing done yet
+    ManagerStats stats = manager.getStats();
+    ASSERT_EQ(2u, stats.nbWorkers);
+    ASSERT_EQ(2u, stats.workers.size());
+    ASSERT_EQ(0u, stats.runTimes.getCount());
+
+    std::vector<TaskHandle> tasks;
+    for(int taskIdx = 0; taskIdx < 200; ++taskIdx)
+    {
+        tasks.push_back(manager.submit([]() { std::this_thread::sleep_for(std::chrono::microseconds(50)); }));
+    }
+    for(std::vector<TaskHandle>::iterator task = tasks.begin(); task != tasks.end(); ++task)
+    {
+        (*task)->waitForCompletion();
+    }
+
+    //a worker counts a task just after completing it
+    ASSERT_TRUE(waitFor([&manager]() { return 200u == manager.getStats().runTimes.getCount(); }));
+    stats = manager.getStats();
+    uint64_t nbTasks = 0;
+    std::chrono::nanoseconds busyTime(0);
+    for(std::vector<WorkerStats>::const_iterator worker = stats.workers.begin(); worker != stats.workers.end(); ++worker)
+    {
+        nbTasks += worker->nbTasks;
+        busyTime += worker->busyTime;
+        ASSERT_EQ(worker->nbTasks, worker->runTimes.getCount());
+    }
+    ASSERT_EQ(200u, nbTasks);
+    ASSERT_GE(busyTime, std::chrono::nanoseconds(std::chrono::microseconds(200 * 50)));
+    ASSERT_GE(stats.runTimes.getMean(), std::chrono::microseconds(50));
+    ASSERT_EQ(tasks.size(), stats.queueWaitTimes[static_cast<size_t>(Priority::NORMAL)].getCount());
+
+    //gauges follow the queue
+    std::atomic<bool> isReleased(false);
+    for(int taskIdx = 0; taskIdx < 2; ++taskIdx)
+    {
+        manager.submit([&isReleased]() {
+            while(!isReleased)
+            {
+                std::this_thread::yield();
+            }
+        });
+    }
+    manager.submit([]() {}, Priority::HIGH);
+    ASSERT_TRUE(waitFor([&manager]() { return 0u == manager.getStats().nbIdleWorkers; }));
+    stats = manager.getStats();
+    ASSERT_EQ(1u, stats.nbQueuedTasks[static_cast<size_t>(Priority::HIGH)]);
+    ASSERT_EQ(0u, stats.nbQueuedTasks[static_cast<size_t>(Priority::NORMAL)]);
+
+    isReleased = true;
+    manager.waitForTasksToComplete();
+    ASSERT_TRUE(waitFor([&manager]() { return 2u == manager.getStats().nbIdleWorkers; }));
+    ASSERT_GT(manager.getStats().workers[0].idleTime, std::chrono::nanoseconds(0));
+}
+
+//------------------------------------------------------------------------------
+static size_t countOccurrences(const std::string& text, const std::string& pattern)
+{
+    size_t nbOccurrences = 0;
+    for(size_t position = text.find(pattern); std::string::npos != position; position = text.find(pattern, position + pattern.size()))
+    {
+        ++nbOccurrences;
+    }
+    return nbOccurrences;
+}
+
+TEST(WORKERS_TEST, TASK_TRACE_TEST)
+{
+    Manager manager(2);
+
+    TaskTrace::start();
+    ASSERT_TRUE(TaskTrace::isEnabled());
+    std::vector<TaskHandle> tasks;
+    for(int taskIdx = 0; taskIdx < 100; ++taskIdx)
+    {
+        tasks.push_back(manager.submit([]() { std::this_thread::sleep_for(std::chrono::microseconds(10)); }));
+    }
+    for(std::vector<TaskHandle>::iterator task = tasks.begin(); task != tasks.end(); ++task)
+    {
+        (*task)->waitForCompletion();
+    }
+    //a worker records the end just after completing the task, before counting it
+    ASSERT_TRUE(waitFor([&manager]() { return 100u == manager.getStats().runTimes.getCount(); }));
+    TaskTrace::stop();
+
+    //a run per task, each with the time it was queued and handed over to its worker
+    std::ostringstream trace;
+    ASSERT_TRUE(TaskTrace::write(trace));
+    std::string json = trace.str();
+    ASSERT_EQ('[', json[0]);
+    ASSERT_EQ(100u, countOccurrences(json, "\"ph\": \"X\""));
+    ASSERT_EQ(200u, countOccurrences(json, "\"name\": \"queued\""));
+    ASSERT_EQ(200u, countOccurrences(json, "\"name\": \"handoff\""));
+    ASSERT_LE(1u, countOccurrences(json, "\"name\": \"worker "));
+
+    //nothing more once stopped
+    manager.submit([]() {})->waitForCompletion();
+    manager.waitForTasksToComplete();
+    trace.str("");
+    TaskTrace::write(trace);
+    ASSERT_EQ(json, trace.str());
+
+    //starting again forgets the last session
+    TaskTrace::start();
+    TaskTrace::stop();
+    trace.str("");
+    TaskTrace::write(trace);
+    ASSERT_EQ(0u, countOccurrences(trace.str(), "\"ph\""));
+}
+
+TEST(WORKERS_TEST, TASK_GROUP_TEST)
+{
+    Manager manager(ManagerConfig(4, SchedulingMode::WORK_STEALING));
+
+    //wait covers tasks until they are done running, not just until they leave the queue
+    {
+        std::atomic<size_t> nbRun(0);
+        TaskGroup group(manager);
+        for(int taskIdx = 0; taskIdx < 10000; ++taskIdx)
+        {
+            group.submit([&nbRun]() { ++nbRun; });
+        }
+        ASSERT_TRUE(group.wait());
+        ASSERT_EQ(10000u, nbRun);
+        ASSERT_TRUE(group.tryWait());
+        ASSERT_EQ(0u, group.getNbInFlight());
+    }
+
+    //tasks adding more tasks to their own group as they run
+    {
+        std::atomic<size_t> nbRun(0);
+        TaskGroup group(manager);
+        std::function<void (size_t)> spawn = [&group, &nbRun, &spawn](const size_t depth) {
+            ++nbRun;
+            if(depth > 0)
+            {
+                group.submit([&spawn, depth]() { spawn(depth - 1); });
+                group.submit([&spawn, depth]() { spawn(depth - 1); });
+            }
+        };
+        group.submit([&spawn]() { spawn(10); });
+        ASSERT_TRUE(group.wait());
+        ASSERT_EQ(2047u, nbRun);
+    }
+
+    //in flight while running, failures reported once
+    {
+        std::atomic<bool> isReleased(false);
+        TaskGroup group(manager);
+        group.submit([&isReleased]() {
+            while(!isReleased)
+            {
+                std::this_thread::yield();
+            }
+            return false;
+        });
+        ASSERT_FALSE(group.tryWait());
+        ASSERT_EQ(1u, group.getNbInFlight());
+        isReleased = true;
+        ASSERT_FALSE(group.wait());
+        ASSERT_TRUE(group.wait());
+    }
+
+    //tasks have completed by the time the group is done with them
+    {
+        std::vector< std::shared_ptr<TestTask> > tasks;
+        TaskGroup group(manager);
+        for(int taskIdx = 0; taskIdx < 100; ++taskIdx)
+        {
+            tasks.push_back(std::make_shared<TestTask>());
+            ASSERT_TRUE(group.run(tasks.back()));
+        }
+        ASSERT_TRUE(group.wait());
+        for(std::vector< std::shared_ptr<TestTask> >::const_iterator task = tasks.begin(); task != tasks.end(); ++task)
+        {
+            ASSERT_TRUE((*task)->wasPerformed);
+            ASSERT_TRUE((*task)->isComplete());
+        }
+
+        //tasks that already completed are not run again, their status counts
+        std::shared_ptr<TestTask> succeeded = std::make_shared<TestTask>();
+        succeeded->setCompletionStatus(true);
+        ASSERT_TRUE(group.run(succeeded));
+        ASSERT_TRUE(group.wait());
+        ASSERT_FALSE(succeeded->wasPerformed);
+        std::shared_ptr<TestTask> failed = std::make_shared<TestTask>();
+        failed->setCompletionStatus(false);
+        ASSERT_TRUE(group.run(failed));
+        ASSERT_FALSE(group.wait());
+        ASSERT_FALSE(failed->wasPerformed);
+    }
+
+    //a parent waits for the groups nested in it, and sees their failures
+    {
+        std::atomic<bool> isReleased(false);
+        std::atomic<size_t> nbRun(0);
+        TaskGroup parent(manager);
+        TaskGroup child(parent);
+        parent.submit([&nbRun]() { ++nbRun; });
+        child.submit([&isReleased, &nbRun]() {
+            while(!isReleased)
+            {
+                std::this_thread::yield();
+            }
+            ++nbRun;
+            return false;
+        });
+        ASSERT_TRUE(waitFor([&nbRun]() { return 1u == nbRun; }));
+        ASSERT_EQ(1u, parent.getNbInFlight());
+        ASSERT_FALSE(parent.tryWait());
+        isReleased = true;
+        ASSERT_FALSE(parent.wait());
+        ASSERT_EQ(2u, nbRun);
+        ASSERT_TRUE(child.tryWait());
+        ASSERT_FALSE(child.wait());
+    }
+
+    //tasks a shut down manager never runs still finish, as failures
+    Manager stopped(1);
+    stopped.shutdown();
+    TaskGroup group(stopped);
+    std::shared_ptr<TestTask> task = std::make_shared<TestTask>();
+    ASSERT_FALSE(group.run(task));
+    group.submit([]() {});
+    ASSERT_FALSE(group.wait());
+    ASSERT_TRUE(task->isComplete());
+    ASSERT_FALSE(task->wasPerformed);
+
+    //a task that already completed is left as it was, a null one is not counted
+    std::shared_ptr<TestTask> completed = std::make_shared<TestTask>();
+    completed->setCompletionStatus(true);
+    ASSERT_FALSE(group.run(completed));
+    ASSERT_TRUE(completed->getCompletionStatus());
+    ASSERT_FALSE(group.run(TaskHandle()));
+    ASSERT_EQ(0u, group.getNbInFlight());
+    ASSERT_FALSE(group.wait());
+}
+
+//------------------------------------------------------------------------------
+static std::string writeTestFile(const std::string& name, const std::string& content)
+{
+    std::ofstream file(name.c_str(), std::ios::binary);
+    file << content;
+    return name;
+}
+
+//------------------------------------------------------------------------------
+static void testIoEngine(Manager& manager, const IoEngineConfig& config)
+{
+    //more files than the ring holds, some bigger than a single read of the helper threads
+    std::vector<std::string> paths;
+    std::vector<std::string> contents;
+    for(int fileIdx = 0; fileIdx < 100; ++fileIdx)
+    {
+        std::ostringstream name;
+        name << "io_engine_test_" << fileIdx << ".bin";
+        contents.push_back(std::string(static_cast<size_t>(fileIdx) * 3000, static_cast<char>('a' + fileIdx % 26)));
+        paths.push_back(writeTestFile(name.str(), contents.back()));
+    }
+
+    {
+        IoEngine io(manager, config);
+        std::vector<std::string> results(paths.size());
+        std::atomic<size_t> nbSucceeded(0);
+        std::atomic<size_t> nbOnWorker(0);
+        for(size_t fileIdx = 0; fileIdx < paths.size(); ++fileIdx)
+        {
+            std::string* result = &results[fileIdx];
+            io.readFile(paths[fileIdx], [result, &nbSucceeded, &nbOnWorker](bool succeeded, std::vector<char>& data) {
+                result->assign(data.begin(), data.end());
+                nbSucceeded += succeeded ? 1 : 0;
+                nbOnWorker += (0 != Worker::getCurrent()) ? 1 : 0;
+            });
+        }
+        io.wait();
+        ASSERT_EQ(0u, io.getNbInFlight());
+        ASSERT_EQ(paths.size(), nbSucceeded);
+        ASSERT_EQ(paths.size(), nbOnWorker);
+        ASSERT_TRUE(contents == results);
+
+        //a file that is not there fails, and reads issued from a callback are waited on too
+        std::atomic<bool> wasMissing(false);
+        std::atomic<bool> wasEmpty(false);
+        io.readFile("io_engine_test_missing.bin", [&io, &wasMissing, &wasEmpty, &paths](bool succeeded, std::vector<char>& data) {
+            wasMissing = !succeeded && data.empty();
+            io.readFile(paths[0], [&wasEmpty](bool succeeded, std::vector<char>& data) { wasEmpty = succeeded && data.empty(); });
+        });
+        io.wait();
+        ASSERT_TRUE(wasMissing);
+        ASSERT_TRUE(wasEmpty);
+    }
+
+    for(std::vector<std::string>::const_iterator path = paths.begin(); path != paths.end(); ++path)
+    {
+        std::remove(path->c_str());
+    }
+}
+
+TEST(WORKERS_TEST, IO_ENGINE_TEST)
+{
+    Manager manager(2);
+
+    IoEngineConfig config;
+    config.queueDepth = 8;
+    testIoEngine(manager, config);
+
+    config.backend = IoBackend::THREADS;
+    config.nbThreads = 3;
+    testIoEngine(manager, config);
+    ASSERT_EQ(IoBackend::THREADS, IoEngine(manager, config).getBackend());
+
+    //callbacks a shut down manager will not take run where the read completed
+    Manager stopped(1);
+    stopped.shutdown();
+    writeTestFile("io_engine_test_stopped.bin", "content");
+    std::string result;
+    {
+        IoEngine io(stopped, config);
+        io.readFile("io_engine_test_stopped.bin", [&result](bool succeeded, std::vector<char>& data) { result.assign(data.begin(), data.end()); });
+    }
+    ASSERT_EQ("content", result);
+    std::remove("io_engine_test_stopped.bin");
+}
@@ -0,0 +1,93 @@
+#include "FunctionalProgramming.h"
+#include "ResourceArchive.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//Packs the assets of maps into a ResourceArchive, offline, for MapLoader::loadArchive. Usage:
+//  PackResources [--alignment=N] archive map...
+//Every asset a map file lists is packed under the name it is listed as, read relative to the map's directory.
+//Assets listed by several maps are packed once, from the first map listing them.
+//Exits with 1 when a map or asset could not be read or the archive written, 2 on bad arguments
+
+//------------------------------------------------------------------------------
+static int printUsage()
+{
+    std::cerr << "usage: PackResources [--alignment=N] archive map..." << std::endl;
+    return 2;
+}
+
+//------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    size_t alignment = ResourceArchive::DEFAULT_ALIGNMENT;
+    std::vector<std::string> paths;
+    for(int argIdx = 1; argIdx < argc; ++argIdx)
+    {
+        const char* alignmentOption = "--alignment=";
+        if(0 == strncmp(argv[argIdx], alignmentOption, strlen(alignmentOption)))
+        {
+            alignment = static_cast<size_t>(strtoul(argv[argIdx] + strlen(alignmentOption), 0, 10));
+            if(0 == alignment || 0 != (alignment & (alignment - 1)))
+            {
+                std::cerr << "alignment must be a power of 2" << std::endl;
+                return 2;
+            }
+        }
+        else if('-' == argv[argIdx][0])
+        {
+            return printUsage();
+        }
+        else
+        {
+            paths.push_back(argv[argIdx]);
+        }
+    }
+    if(paths.size() < 2)
+    {
+        return printUsage();
+    }
+
+    std::vector<std::string> names;
+    std::vector<std::string> files;
+    std::set<std::string> packed;
+    for(std::vector<std::string>::const_iterator map = paths.begin() + 1; map != paths.end(); ++map)
+    {
+        std::ifstream mapFile(map->c_str(), std::ios::binary);
+        if(!mapFile)
+        {
+            std::cerr << "cannot read map " << *map << std::endl;
+            return 1;
+        }
+        std::ostringstream content;
+        content << mapFile.rdbuf();
+
+        const size_t separator = map->find_last_of("/\\");
+        const std::string directory = (std::string::npos == separator) ? std::string() : map->substr(0, separator + 1);
+        const std::vector<std::string> assets = MapLoader::parseMap(content.str());
+        for(std::vector<std::string>::const_iterator asset = assets.begin(); asset != assets.end(); ++asset)
+        {
+            if(!packed.insert(*asset).second)
+            {
+                continue;
+            }
+            names.push_back(*asset);
+            files.push_back(directory + *asset);
+        }
+    }
+
+    if(!ResourceArchive::pack(paths[0], names, files, alignment))
+    {
+        std::cerr << "cannot pack " << paths[0] << ", check that every asset can be read" << std::endl;
+        return 1;
+    }
+
+    std::cout << "packed " << names.size() << " assets into " << paths[0] << std::endl;
+    return 0;
+}